@@ -19,9 +19,12 @@ int main(int argc, char **argv) {
   core::ref<gfx::context_t> context = core::make_ref<gfx::context_t>(true);
   gfx::base_t base{window, context};
 
-  gfx::handle_image_t image = gfx::helper::load_image_from_path_instant(
-      *context, base._command_pool,
+  gfx::handle_image_t image = gfx::helper::load_image_from_path(
+      *context, *base._staging_ring,
       "../../assets/textures/draw-3583548_1280.png", VK_FORMAT_R8G8B8A8_SRGB);
+  // the dispatch below is submitted outside of a frame, so nothing else
+  // flushes the upload before it
+  base._staging_ring->flush();
   gfx::handle_image_view_t image_view =
       context->create_image_view({.handle_image = image});
 
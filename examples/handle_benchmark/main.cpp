@@ -0,0 +1,65 @@
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+#include "horizon/core/slot_map.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+// creates and destroys handles with random interleaving and reports the cost
+// per operation for every bucket, the numbers should stay flat as the table
+// churns
+
+define_handle(handle_bench_t);
+
+struct bench_data_t {
+  uint64_t payload;
+};
+
+int main(int argc, char **argv) {
+  constexpr uint32_t total_operations = 1'000'000;
+  constexpr uint32_t bucket_size = 100'000;
+
+  core::slot_map_t<handle_bench_t, bench_data_t> map;
+  std::vector<handle_bench_t> live;
+  std::vector<handle_bench_t> dead;
+  live.reserve(total_operations);
+
+  std::mt19937_64 rng{0xc0ffee};
+  std::uniform_int_distribution<uint32_t> coin{0, 99};
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 1; i <= total_operations; i++) {
+    // bias towards creation so the table keeps growing while it churns
+    if (live.empty() || coin(rng) < 55) {
+      live.push_back(map.insert({.payload = i}));
+    } else {
+      std::uniform_int_distribution<size_t> pick{0, live.size() - 1};
+      size_t index = pick(rng);
+      handle_bench_t handle = live[index];
+      live[index] = live.back();
+      live.pop_back();
+      map.erase(handle);
+      if (dead.size() < 1024) dead.push_back(handle);
+    }
+
+    if (i % bucket_size == 0) {
+      auto end = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::nano> elapsed = end - start;
+      horizon_info("ops {:>8} live {:>7} capacity {:>7} {:.2f} ns/op", i,
+                   map.size(), map.capacity(), elapsed.count() / bucket_size);
+      start = std::chrono::high_resolution_clock::now();
+    }
+  }
+
+  // a recycled slot must never accept a handle from a previous generation
+  for (handle_bench_t handle : dead)
+    check(!map.contains(handle), "stale handle {} aliases a live slot",
+          handle.val);
+  for (handle_bench_t handle : live)
+    check(map.contains(handle), "live handle {} was lost", handle.val);
+
+  horizon_info("{} live handles, {} stale handles rejected", live.size(),
+               dead.size());
+  return 0;
+}
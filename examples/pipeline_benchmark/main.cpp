@@ -0,0 +1,99 @@
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+#include "horizon/gfx/context.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// creates the same number of compute pipelines one at a time and then through
+// one batched call, every pipeline uses a distinct shader so neither run is
+// served by the pipeline cache. run with VK_ICD_FILENAMES pointing at lavapipe
+// to measure the cpu side compile alone
+
+static std::string shader_source(uint32_t index) {
+  return R"(
+struct push_constant_t {
+    float *data;
+}
+[vk::push_constant] push_constant_t pc;
+[shader("compute")]
+[numthreads(64, 1, 1)]
+void compute_main(uint3 id : SV_DispatchThreadID) {
+    float x = pc.data[id.x];
+    for (int i = 0; i < 64; i++)
+        x = sin(x) * )" +
+         std::to_string(index + 1) + R"(.0 + cos(x * )" +
+         std::to_string(index + 2) + R"(.0);
+    pc.data[id.x] = x;
+}
+)";
+}
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::high_resolution_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char **argv) {
+  constexpr uint32_t pipeline_count = 200;
+
+  gfx::context_t context{false};
+
+  gfx::config_pipeline_layout_t cpl{};
+  cpl.add_push_constant(sizeof(VkDeviceAddress), VK_SHADER_STAGE_COMPUTE_BIT);
+  gfx::handle_pipeline_layout_t pipeline_layout =
+      context.create_pipeline_layout(cpl);
+
+  // shaders are compiled up front so only pipeline creation is timed
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<core::ticket_t<gfx::handle_shader_t>> shader_tickets;
+  for (uint32_t i = 0; i < 2 * pipeline_count; i++) {
+    gfx::config_shader_t cs{};
+    cs.code_or_path = shader_source(i);
+    cs.is_code = true;
+    cs.name = "pipeline_benchmark_" + std::to_string(i);
+    cs.type = gfx::shader_type_t::e_compute;
+    shader_tickets.push_back(context.create_shader_async(cs));
+  }
+  std::vector<gfx::config_pipeline_t> configs;
+  for (core::ticket_t<gfx::handle_shader_t> &ticket : shader_tickets) {
+    gfx::config_pipeline_t cp{};
+    cp.handle_pipeline_layout = pipeline_layout;
+    cp.add_shader(ticket.get());
+    configs.push_back(cp);
+  }
+  horizon_info("compiled {} shaders in {:.2f} ms", shader_tickets.size(),
+               elapsed_ms(start));
+
+  std::span<const gfx::config_pipeline_t> serial_configs{
+      configs.data(), pipeline_count};
+  std::span<const gfx::config_pipeline_t> batched_configs{
+      configs.data() + pipeline_count, pipeline_count};
+
+  std::vector<gfx::handle_pipeline_t> pipelines;
+  start = std::chrono::high_resolution_clock::now();
+  for (const gfx::config_pipeline_t &config : serial_configs)
+    pipelines.push_back(context.create_compute_pipeline(config));
+  double serial_ms = elapsed_ms(start);
+
+  start = std::chrono::high_resolution_clock::now();
+  std::vector<gfx::handle_pipeline_t> batched_pipelines =
+      context.create_compute_pipelines(batched_configs);
+  double batched_ms = elapsed_ms(start);
+  pipelines.insert(pipelines.end(), batched_pipelines.begin(),
+                   batched_pipelines.end());
+
+  horizon_info("serial  {} pipelines {:.2f} ms", pipeline_count, serial_ms);
+  horizon_info("batched {} pipelines {:.2f} ms on {} threads", pipeline_count,
+               batched_ms, context.thread_pool().thread_count());
+  horizon_info("speedup {:.2f}x", serial_ms / batched_ms);
+
+  for (gfx::handle_pipeline_t pipeline : pipelines)
+    context.destroy_pipeline(pipeline);
+  for (core::ticket_t<gfx::handle_shader_t> &ticket : shader_tickets)
+    context.destroy_shader(ticket.get());
+  context.destroy_pipeline_layout(pipeline_layout);
+  return 0;
+}
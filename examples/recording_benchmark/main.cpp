@@ -0,0 +1,121 @@
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+#include "horizon/gfx/context.hpp"
+#include "horizon/gfx/helper.hpp"
+
+#include <chrono>
+#include <vector>
+
+// records the same draw list into secondary command buffers with a growing
+// number of workers and executes them into an offscreen image, only the
+// recording is timed
+
+static const char *shader_source = R"(
+struct vertex_output_t {
+    float4 position : SV_Position;
+}
+[shader("vertex")]
+vertex_output_t vertex_main(uint vertex_id : SV_VertexID) {
+    vertex_output_t output;
+    float2 uv = float2((vertex_id << 1) & 2, vertex_id & 2);
+    output.position = float4(uv * 2.0 - 1.0, 0.0, 1.0);
+    return output;
+}
+[shader("fragment")]
+float4 fragment_main(vertex_output_t input) : SV_Target {
+    return float4(1.0, 0.0, 1.0, 1.0);
+}
+)";
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::high_resolution_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char **argv) {
+  constexpr size_t draw_count = 100000;
+  constexpr uint32_t width = 64, height = 64;
+  constexpr VkFormat vk_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+  gfx::context_t context{false};
+
+  gfx::config_image_t config_image{};
+  config_image.vk_width = width;
+  config_image.vk_height = height;
+  config_image.vk_depth = 1;
+  config_image.vk_type = VK_IMAGE_TYPE_2D;
+  config_image.vk_format = vk_format;
+  config_image.vk_mips = 1;
+  config_image.vk_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  gfx::handle_image_t image = context.create_image(config_image);
+  gfx::handle_image_view_t image_view =
+      context.create_image_view({.handle_image = image});
+
+  std::vector<gfx::handle_shader_t> shaders = context.create_shader_program(
+      {.code_or_path = shader_source,
+       .is_code = true,
+       .name = "recording_benchmark",
+       .types = {gfx::shader_type_t::e_vertex,
+                 gfx::shader_type_t::e_fragment}});
+  gfx::handle_pipeline_layout_t pipeline_layout =
+      context.create_pipeline_layout({});
+  gfx::config_pipeline_t cp{};
+  cp.handle_pipeline_layout = pipeline_layout;
+  cp.add_color_attachment(vk_format, gfx::default_color_blend_attachment());
+  for (gfx::handle_shader_t shader : shaders)
+    cp.add_shader(shader);
+  gfx::handle_pipeline_t pipeline = context.create_graphics_pipeline(cp);
+
+  auto [viewport, scissor] =
+      gfx::helper::fill_viewport_and_scissor_structs(width, height);
+  gfx::rendering_inheritance_t rendering_inheritance{
+      .vk_color_formats = {vk_format}};
+  auto record = [&](gfx::handle_commandbuffer_t cbuf, size_t begin,
+                    size_t end) {
+    context.cmd_bind_pipeline(cbuf, pipeline);
+    context.cmd_set_viewport_and_scissor(cbuf, viewport, scissor);
+    for (size_t i = begin; i < end; i++)
+      context.cmd_draw(cbuf, 3, 1, 0, i);
+  };
+
+  double single_ms = 0;
+  for (uint32_t worker_count = 1;
+       worker_count <= context.thread_pool().thread_count();
+       worker_count *= 2) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<gfx::handle_commandbuffer_t> secondaries =
+        gfx::helper::record_secondary_commandbuffers(
+            context, rendering_inheritance, draw_count, record, worker_count);
+    double recording_ms = elapsed_ms(start);
+    if (worker_count == 1)
+      single_ms = recording_ms;
+
+    gfx::handle_commandbuffer_t cbuf = context.acquire_commandbuffer();
+    context.begin_commandbuffer(cbuf, true);
+    gfx::helper::cmd_transition_image_layout(
+        context, cbuf, image, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    gfx::rendering_attachment_t rendering_attachment{};
+    rendering_attachment.handle_image_view = image_view;
+    context.cmd_begin_rendering(
+        cbuf, {rendering_attachment}, std::nullopt, scissor, 1,
+        VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT);
+    context.cmd_execute_commands(cbuf, secondaries);
+    context.cmd_end_rendering(cbuf);
+    context.end_commandbuffer(cbuf);
+    context.wait_serial(context.submit({.handle_commandbuffers = {cbuf}}));
+
+    horizon_info("{} draws on {} workers recorded in {:.2f} ms ({:.2f}x)",
+                 draw_count, worker_count, recording_ms,
+                 single_ms / recording_ms);
+  }
+
+  context.destroy_pipeline(pipeline);
+  context.destroy_pipeline_layout(pipeline_layout);
+  for (gfx::handle_shader_t shader : shaders)
+    context.destroy_shader(shader);
+  context.destroy_image_view(image_view);
+  context.destroy_image(image);
+  return 0;
+}
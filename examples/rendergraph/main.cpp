@@ -20,38 +20,37 @@ int main() {
   gfx::helper::imgui_init(
       *window, *context, base->_swapchain,
       context
-          ->get_image(context->get_swapchain(base->_swapchain).handle_images[0])
-          .config.vk_format);
+          ->get_image_config(
+              context->get_swapchain(base->_swapchain).handle_images[0])
+          .vk_format);
 
   // this is an external resource
-  gfx::handle_image_t random = gfx::helper::load_image_from_path_instant(
-      *context, base->_command_pool, "./examples/rendergraph/assets/noise.jpg",
+  // the upload goes out with the first frame's staging flush
+  gfx::handle_image_t random = gfx::helper::load_image_from_path(
+      *context, *base->_staging_ring, "./examples/rendergraph/assets/noise.jpg",
       VK_FORMAT_R8G8B8A8_SRGB);
   gfx::handle_image_view_t random_view =
       context->create_image_view({.handle_image = random});
 
-  gfx::config_descriptor_set_layout_t cdsl{};
-  cdsl.add_layout_binding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                          VK_SHADER_STAGE_ALL);
-  cdsl.add_layout_binding(1, VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_ALL);
+  std::vector<gfx::handle_shader_t> shaders =
+      gfx::helper::create_slang_shader_program(
+          *context, "examples/rendergraph/shaders/example.slang",
+          {gfx::shader_type_t::e_vertex, gfx::shader_type_t::e_fragment});
+  // the image and sampler are only read by the fragment stage, the derived
+  // layout only exposes them there
+  gfx::shader_layout_t layout = context->get_shader_layout(shaders);
   gfx::handle_descriptor_set_layout_t dsl =
-      context->create_descriptor_set_layout(cdsl);
-  gfx::config_pipeline_layout_t cpl{};
-  cpl.add_descriptor_set_layout(dsl);
-  gfx::handle_pipeline_layout_t pl = context->create_pipeline_layout(cpl);
-  gfx::config_pipeline_t        cp{};
-  cp.handle_pipeline_layout = pl;
+      layout.handle_descriptor_set_layouts[0];
+  gfx::config_pipeline_t cp{};
+  cp.handle_pipeline_layout = layout.handle_pipeline_layout;
   cp.add_color_attachment(
       context
-          ->get_image(context->get_swapchain(base->_swapchain).handle_images[0])
-          .config.vk_format,
+          ->get_image_config(
+              context->get_swapchain(base->_swapchain).handle_images[0])
+          .vk_format,
       gfx::default_color_blend_attachment());
-  cp.add_shader(gfx::helper::create_slang_shader(
-      *context, "examples/rendergraph/shaders/example.slang",
-      gfx::shader_type_t::e_vertex));
-  cp.add_shader(gfx::helper::create_slang_shader(
-      *context, "examples/rendergraph/shaders/example.slang",
-      gfx::shader_type_t::e_fragment));
+  for (gfx::handle_shader_t shader : shaders)
+    cp.add_shader(shader);
   gfx::handle_pipeline_t p = context->create_graphics_pipeline(cp);
 
   gfx::handle_descriptor_set_t ds =
@@ -49,14 +49,6 @@
       return val == other;                                                     \
     }                                                                          \
     operator core::handle_t() { return val; }                                  \
-    name &operator++(int) {                                                    \
-      val++;                                                                   \
-      return *this;                                                            \
-    }                                                                          \
-    name &operator++() {                                                       \
-      val++;                                                                   \
-      return *this;                                                            \
-    }                                                                          \
     std::ostream &operator<<(std::ostream &o) {                                \
       o << val;                                                                \
       return o;                                                                \
@@ -65,7 +57,7 @@
 
 namespace core {
 
-using handle_t = uint32_t;
+using handle_t = uint64_t;
 constexpr handle_t null_handle = 0;
 
 template <typename type> using ref = std::shared_ptr<type>;
@@ -83,6 +75,23 @@ constexpr void hash_combine(uint64_t &seed, const type_t &v,
   (hash_combine(seed, rest), ...);
 };
 
+// 64 bit fnv-1a, unlike std::hash the result is stable across runs and
+// platforms so it can key data that outlives the process
+inline uint64_t hash_bytes(const void *data, size_t size,
+                           uint64_t seed = 0xcbf29ce484222325) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    seed ^= bytes[i];
+    seed *= 0x100000001b3;
+  }
+  return seed;
+}
+
+inline uint64_t hash_bytes(std::string_view str,
+                           uint64_t seed = 0xcbf29ce484222325) {
+  return hash_bytes(str.data(), str.size(), seed);
+}
+
 struct binary_reader_t {
   binary_reader_t(const std::filesystem::path &path)
       : _path(path), _file(path, std::ios::binary) {
@@ -98,6 +107,21 @@ struct binary_reader_t {
     _file.read(reinterpret_cast<char *>(&val), sizeof(type_t));
   }
 
+  void read_bytes(void *data, size_t size) {
+    _file.read(reinterpret_cast<char *>(data), size);
+  }
+
+  // false once a read went past the end of the file
+  bool good() { return _file.good(); }
+
+  // bytes left to read, sizes read from the file are checked against this
+  // before anything is allocated for them
+  size_t remaining() {
+    std::streampos position = _file.tellg();
+    if (!_file.good() || position < 0) return 0;
+    return file_size() - static_cast<size_t>(position);
+  }
+
   std::filesystem::path _path;
   std::ifstream _file;
 };
@@ -120,6 +144,11 @@ struct binary_writer_t {
     }
   }
 
+  void write_bytes(const void *data, size_t size) {
+    const char *bytes = reinterpret_cast<const char *>(data);
+    _buffer.insert(_buffer.end(), bytes, bytes + size);
+  }
+
   void flush() {
     _file.write(_buffer.data(), _buffer.size());
     _buffer.clear();
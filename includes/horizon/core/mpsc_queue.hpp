@@ -0,0 +1,59 @@
+#ifndef CORE_MPSC_QUEUE_HPP
+#define CORE_MPSC_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+/*
+ * lock free multi producer single consumer queue
+ * producers push onto an intrusive stack, the consumer takes the whole stack
+ * in one exchange and reverses it, so items come out in push order
+ */
+template <typename T> class mpsc_queue_t {
+public:
+  mpsc_queue_t() = default;
+  ~mpsc_queue_t() { pop_all(); }
+
+  mpsc_queue_t(const mpsc_queue_t &) = delete;
+  mpsc_queue_t &operator=(const mpsc_queue_t &) = delete;
+
+  void push(T value) {
+    node_t *node = new node_t{std::move(value), _head.load()};
+    while (!_head.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+
+  // only one thread may pop at a time
+  std::vector<T> pop_all() {
+    node_t *node = _head.exchange(nullptr, std::memory_order_acquire);
+    std::vector<T> values;
+    while (node) {
+      values.push_back(std::move(node->value));
+      node_t *next = node->next;
+      delete node;
+      node = next;
+    }
+    std::reverse(values.begin(), values.end());
+    return values;
+  }
+
+  bool empty() const { return _head.load() == nullptr; }
+
+private:
+  struct node_t {
+    T value;
+    node_t *next;
+  };
+
+  std::atomic<node_t *> _head = nullptr;
+};
+
+} // namespace core
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef CORE_SLOT_MAP_HPP
+#define CORE_SLOT_MAP_HPP
+
+#include "horizon/core/core.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace core {
+
+// a slot map handle packs the slot index in the low 32 bits and the slot
+// generation in the high 32 bits. a slot is alive while its generation is odd,
+// so a live handle can never compare equal to null_handle
+constexpr handle_t make_handle(uint32_t index, uint32_t generation) {
+  return (static_cast<handle_t>(generation) << 32) | index;
+}
+
+constexpr uint32_t handle_index(handle_t handle) {
+  return static_cast<uint32_t>(handle & 0xffffffff);
+}
+
+constexpr uint32_t handle_generation(handle_t handle) {
+  return static_cast<uint32_t>(handle >> 32);
+}
+
+/*
+ * paged generational table
+ * slots live in fixed size pages of page_size slots, the high bits of the
+ * slot index pick the page and the low bits the slot within it. each page
+ * keeps its hot records (the data touched while recording commands) in one
+ * contiguous array and its cold records (configs, debug names) in a parallel
+ * array, so cold data never pollutes the cache lines of the hot path
+ * dead slots are threaded into an intrusive free list through their slot
+ * metadata, so insert and erase are O(1) regardless of churn. generations only
+ * ever increase, a slot whose generation is about to wrap is retired instead
+ * of being recycled, so a stale handle can never alias a newer resource
+ *
+ * concurrency
+ * storage is split in fixed size pages that are never moved or freed until
+ * the map dies, so references returned by get stay valid across inserts.
+ * insert and erase serialize on a writer mutex. get, get_cold and contains
+ * take no lock, the generation is published with release ordering after the
+ * record is written, so any thread holding a handle sees a complete record.
+ * reading a handle while another thread erases it is a use after free, same
+ * as with any other api. iteration is not synchronized and is meant for
+ * teardown
+ */
+template <typename handle_type_t, typename hot_t,
+          typename cold_t = std::monostate>
+class slot_map_t {
+ public:
+  static constexpr uint32_t invalid_index = 0xffffffff;
+  // last even generation, erasing a slot that reaches it retires the slot
+  static constexpr uint32_t retired_generation = 0xfffffffe;
+  static constexpr uint32_t page_bits          = 8;
+  static constexpr uint32_t page_size          = 1u << page_bits;
+  static constexpr uint32_t max_pages          = 4096;
+
+  struct iterator_t {
+    std::pair<handle_type_t, hot_t &> operator*() const {
+      uint32_t generation =
+          map->slot_at(index).generation.load(std::memory_order_relaxed);
+      return {make_handle(index, generation), map->hot_at(index)};
+    }
+    iterator_t &operator++() {
+      index++;
+      skip_dead();
+      return *this;
+    }
+    bool operator!=(const iterator_t &other) const {
+      return index != other.index;
+    }
+    void skip_dead() {
+      while (index < map->capacity() && !map->is_alive(index)) index++;
+    }
+
+    slot_map_t *map;
+    uint32_t    index;
+  };
+
+  slot_map_t()
+      : _pages(std::make_unique<std::unique_ptr<page_t>[]>(max_pages)) {}
+  slot_map_t(const slot_map_t &)            = delete;
+  slot_map_t &operator=(const slot_map_t &) = delete;
+
+  bool is_alive(uint32_t index) const {
+    return index < capacity() &&
+           (slot_at(index).generation.load(std::memory_order_acquire) & 1);
+  }
+
+  bool contains(handle_type_t handle) const {
+    uint32_t index = handle_index(handle.val);
+    return index < capacity() &&
+           slot_at(index).generation.load(std::memory_order_acquire) ==
+               handle_generation(handle.val) &&
+           (handle_generation(handle.val) & 1);
+  }
+
+  handle_type_t insert(const hot_t &hot, const cold_t &cold = {}) {
+    std::scoped_lock lock{_mutex};
+    return insert_locked(hot, cold);
+  }
+
+  // inserts every hot and cold pair under one lock, handles come back in the
+  // same order
+  std::vector<handle_type_t> insert(std::span<const hot_t>  hots,
+                                    std::span<const cold_t> colds) {
+    horizon_assert(hots.size() == colds.size(),
+                   "{} hot records but {} cold records", hots.size(),
+                   colds.size());
+    std::vector<handle_type_t> handles;
+    handles.reserve(hots.size());
+    std::scoped_lock lock{_mutex};
+    for (size_t i = 0; i < hots.size(); i++)
+      handles.push_back(insert_locked(hots[i], colds[i]));
+    return handles;
+  }
+
+  void erase(handle_type_t handle) {
+    std::scoped_lock lock{_mutex};
+    horizon_assert(contains(handle), "erasing stale or invalid handle {}",
+                   handle.val);
+    uint32_t index = handle_index(handle.val);
+    slot_t  &slot  = slot_at(index);
+    slot.generation.fetch_add(1, std::memory_order_release);
+    hot_at(index)  = {};
+    cold_at(index) = {};
+    _size.fetch_sub(1, std::memory_order_relaxed);
+    if (handle_generation(handle.val) + 1 == retired_generation) return;
+    slot.next_free = _free_head;
+    _free_head     = index;
+  }
+
+  hot_t &get(handle_type_t handle) {
+    horizon_assert(contains(handle), "stale or invalid handle {}", handle.val);
+    return hot_at(handle_index(handle.val));
+  }
+
+  cold_t &get_cold(handle_type_t handle) {
+    horizon_assert(contains(handle), "stale or invalid handle {}", handle.val);
+    return cold_at(handle_index(handle.val));
+  }
+
+  size_t size() const { return _size.load(std::memory_order_relaxed); }
+  uint32_t capacity() const {
+    return _capacity.load(std::memory_order_acquire);
+  }
+
+  iterator_t begin() {
+    iterator_t itr{this, 0};
+    itr.skip_dead();
+    return itr;
+  }
+  iterator_t end() { return {this, capacity()}; }
+
+ private:
+  struct slot_t {
+    std::atomic<uint32_t> generation = 0;
+    // only meaningful while the slot is dead, guarded by _mutex
+    uint32_t next_free = invalid_index;
+  };
+
+  // hot, cold and slot metadata still live in separate arrays inside a page
+  struct page_t {
+    std::array<hot_t, page_size>  hot{};
+    std::array<cold_t, page_size> cold{};
+    std::array<slot_t, page_size> slots{};
+  };
+
+  hot_t &hot_at(uint32_t index) {
+    return _pages[index >> page_bits]->hot[index & (page_size - 1)];
+  }
+  cold_t &cold_at(uint32_t index) {
+    return _pages[index >> page_bits]->cold[index & (page_size - 1)];
+  }
+  slot_t &slot_at(uint32_t index) const {
+    return _pages[index >> page_bits]->slots[index & (page_size - 1)];
+  }
+
+  // caller holds _mutex
+  handle_type_t insert_locked(const hot_t &hot, const cold_t &cold) {
+    uint32_t index;
+    if (_free_head != invalid_index) {
+      index      = _free_head;
+      _free_head = slot_at(index).next_free;
+    } else {
+      index = _capacity.load(std::memory_order_relaxed);
+      check(index < max_pages * page_size, "slot map is full");
+      if ((index & (page_size - 1)) == 0)
+        _pages[index >> page_bits] = std::make_unique<page_t>();
+      _capacity.store(index + 1, std::memory_order_release);
+    }
+    hot_at(index)  = hot;
+    cold_at(index) = cold;
+
+    slot_t  &slot       = slot_at(index);
+    uint32_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+    slot.next_free      = invalid_index;
+    slot.generation.store(generation, std::memory_order_release);
+    _size.fetch_add(1, std::memory_order_relaxed);
+    return make_handle(index, generation);
+  }
+
+  // fixed size page directory, never reallocated so readers can index it
+  // without synchronizing with writers
+  std::unique_ptr<std::unique_ptr<page_t>[]> _pages;
+  std::mutex                                 _mutex;
+  uint32_t                                   _free_head = invalid_index;
+  std::atomic<uint32_t>                      _capacity  = 0;
+  std::atomic<size_t>                        _size      = 0;
+};
+
+}  // namespace core
+
+#endif
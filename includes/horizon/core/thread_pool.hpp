@@ -0,0 +1,65 @@
+#ifndef CORE_THREAD_POOL_HPP
+#define CORE_THREAD_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+// a ticket is the shareable result of work handed to a thread_pool_t
+template <typename T> using ticket_t = std::shared_future<T>;
+
+template <typename T> bool is_ready(const ticket_t<T> &ticket) {
+  return ticket.valid() && ticket.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready;
+}
+
+/*
+ * fixed set of workers draining one fifo queue
+ * the destructor finishes every queued job before joining
+ */
+class thread_pool_t {
+public:
+  // 0 picks one worker per hardware thread
+  thread_pool_t(uint32_t thread_count = 0);
+  ~thread_pool_t();
+
+  thread_pool_t(const thread_pool_t &) = delete;
+  thread_pool_t &operator=(const thread_pool_t &) = delete;
+
+  uint32_t thread_count() const { return _threads.size(); }
+  // true on the pool's own workers, a job that blocks on tickets of the same
+  // pool can deadlock it once every worker waits on jobs queued behind it
+  bool is_worker_thread() const;
+
+  template <typename F> auto submit(F &&f) -> ticket_t<decltype(f())> {
+    using result_t = decltype(f());
+    auto task =
+        std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(f));
+    ticket_t<result_t> ticket = task->get_future().share();
+    push([task]() { (*task)(); });
+    return ticket;
+  }
+
+private:
+  void push(std::function<void()> job);
+  void worker();
+
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  std::deque<std::function<void()>> _jobs;
+  bool _stop = false;
+  std::vector<std::thread> _threads;
+};
+
+} // namespace core
+
+#endif
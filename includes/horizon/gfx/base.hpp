@@ -4,13 +4,17 @@
 #include "horizon/core/core.hpp"
 #include "horizon/core/window.hpp"
 #include "horizon/gfx/context.hpp"
+#include "horizon/gfx/frame_allocator.hpp"
+#include "horizon/gfx/frame_descriptor_allocator.hpp"
 #include "horizon/gfx/rendergraph.hpp"
+#include "horizon/gfx/staging_ring.hpp"
 #include "horizon/gfx/types.hpp"
 
 #define VK_NO_PROTOTYPES
 #include <vulkan/vulkan_core.h>
 
 #include <array>
+#include <map>
 
 namespace gfx {
 
@@ -132,6 +136,17 @@ struct base_t {
                             handle_sampler_t          sampler);
   void set_bindless_storage_image(handle_bindless_storage_image_t handle,
                                   handle_image_view_t             image_view);
+  // the set_bindless_* calls only queue their writes, the queue is flushed
+  // in one vkUpdateDescriptorSets by begin and end, or by this for slots
+  // needed before then. queued views and samplers have to stay alive until
+  // the flush
+  void flush_bindless();
+  // queues rewrites of the bindless image slots whose views the last
+  // defragmentation step recreated
+  void rebind_moved_bindless_images();
+  // what defragment_step moved during this frame's begin, the app refreshes
+  // the device addresses it keeps for moved_buffers from it
+  const defragmentation_step_t &last_defragmentation_step() const;
 
   void render_rendergraph(const rendergraph_t   &rendergraph,
                           handle_commandbuffer_t cmd);
@@ -139,7 +154,8 @@ struct base_t {
   void cmd_bind_descriptor_sets(
       handle_commandbuffer_t handle_commandbuffer,
       handle_pipeline_t handle_pipeline, uint32_t vk_first_set,
-      const std::vector<handle_descriptor_set_t> &handle_descriptor_sets);
+      const std::vector<handle_descriptor_set_t> &handle_descriptor_sets,
+      const std::vector<uint32_t>                &vk_dynamic_offsets = {});
   void cmd_bind_graphics_pipeline(handle_commandbuffer_t handle_commandbuffer,
                                   handle_pipeline_t      handle_pipeline,
                                   uint32_t width, uint32_t height);
@@ -158,31 +174,48 @@ struct base_t {
   handle_swapchain_t        _swapchain;
   handle_command_pool_t     _command_pool;
   handle_commandbuffer_t    _commandbuffers[MAX_FRAMES_IN_FLIGHT];
-  handle_fence_t            _in_flight_fences[MAX_FRAMES_IN_FLIGHT];
+  // serial of the last submission of each frame slot
+  uint64_t                  _frame_serials[MAX_FRAMES_IN_FLIGHT] = {};
   handle_semaphore_t        _image_available_semaphores[MAX_FRAMES_IN_FLIGHT];
   handle_semaphore_t        _render_finished_semaphores[MAX_FRAMES_IN_FLIGHT];
 
+  // uploads recorded during a frame are flushed right before it is submitted
+  core::ref<staging_ring_t>               _staging_ring;
+  // transient per frame data, reset when the frame slot comes around again
+  core::ref<frame_allocator_t>            _frame_allocator;
+  // descriptor sets that only live for one frame, reset the same way
+  core::ref<frame_descriptor_allocator_t> _frame_descriptor_allocator;
+
   handle_descriptor_set_layout_t _bindless_descriptor_set_layout;
   handle_descriptor_set_t        _bindless_descriptor_set;
 
   uint32_t _current_frame = 0;
   uint32_t _next_image    = 0;
 
+  // view and layout last set at each bindless image slot
+  std::vector<std::pair<handle_image_view_t, VkImageLayout>> _bindless_images;
+  // queued bindless writes keyed by binding and slot, so writing a slot
+  // again before the flush replaces the earlier write
+  std::map<std::pair<uint32_t, uint32_t>, image_descriptor_info_t>
+      _pending_bindless_writes;
   handle_bindless_image_t         _image_counter         = 0;
   handle_bindless_sampler_t       _sampler_counter       = 0;
   handle_bindless_storage_image_t _storage_image_counter = 0;
 
   bool _resize = false;
 
-  std::map<handle_managed_buffer_t,
-           internal::managed_buffer_t<MAX_FRAMES_IN_FLIGHT>>
+  core::slot_map_t<handle_managed_buffer_t,
+                   internal::managed_buffer_t<MAX_FRAMES_IN_FLIGHT>>
       _buffers;
-  std::map<handle_managed_descriptor_set_t,
-           internal::managed_descriptor_set_t<MAX_FRAMES_IN_FLIGHT>>
+  core::slot_map_t<handle_managed_descriptor_set_t,
+                   internal::managed_descriptor_set_t<MAX_FRAMES_IN_FLIGHT>>
       _descriptor_sets;
-  std::map<handle_managed_timer_t,
-           internal::managed_timer_t<MAX_FRAMES_IN_FLIGHT>>
+  core::slot_map_t<handle_managed_timer_t,
+                   internal::managed_timer_t<MAX_FRAMES_IN_FLIGHT>>
       _timers;
+
+ private:
+  defragmentation_step_t _defragmentation_step;
 };
 
 template <size_t MAX_FRAMES_IN_FLIGHT>
@@ -0,0 +1,121 @@
+#ifndef GFX_BUFFER_ARENA_HPP
+#define GFX_BUFFER_ARENA_HPP
+
+#include "horizon/core/slot_map.hpp"
+#include "horizon/gfx/context.hpp"
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "horizon/gfx/types.hpp"
+
+namespace gfx {
+
+define_handle(handle_buffer_slice_t);
+
+struct config_buffer_arena_t {
+  VkBufferUsageFlags vk_buffer_usage_flags =
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  // host access flags map every block and fill in buffer_slice_t::p_data
+  VmaAllocationCreateFlags vma_allocation_create_flags;
+  VmaMemoryUsage           vma_memory_usage = default_vma_memory_usage;
+  // slices larger than this get a block of their own size
+  VkDeviceSize             vk_block_size    = 64 * 1024 * 1024;
+  // 0 aligns every slice for use as a storage buffer offset
+  VkDeviceSize             vk_alignment     = 0;
+  std::string              debug_name       = "buffer arena";
+};
+
+// a range of one of the arena's buffers, offsets in copies, binds, barriers
+// and descriptors are relative to handle_buffer
+struct buffer_slice_t {
+  handle_buffer_t handle_buffer;
+  VkDeviceSize    vk_offset;
+  VkDeviceSize    vk_size;
+  VkDeviceAddress vk_device_address;
+  void           *p_data;
+
+  buffer_resource_range_t resource_range() const {
+    return {.size = vk_size, .offset = vk_offset};
+  }
+  buffer_descriptor_info_t descriptor_info() const {
+    return {.handle_buffer = handle_buffer,
+            .vk_offset     = vk_offset,
+            .vk_range      = vk_size};
+  }
+};
+
+namespace internal {
+
+struct buffer_slice_allocation_t {
+  uint32_t             block;
+  VmaVirtualAllocation vma_virtual_allocation;
+};
+
+}  // namespace internal
+
+/*
+ * sub allocates small buffers out of a few large ones
+ * each block is one VkBuffer whose ranges are handed out by a vma virtual
+ * block, vma's tlsf allocator, so a slice costs no vulkan object, no device
+ * memory allocation and no device address query. slices of the same block
+ * share vertex and index buffer binds and descriptors
+ * blocks use dedicated memory, which defragmentation never moves, so device
+ * addresses stay valid. they are kept until the arena is destroyed
+ * allocate and free may be called from any thread, get never locks
+ */
+class buffer_arena_t {
+ public:
+  buffer_arena_t(context_t &context, const config_buffer_arena_t &config = {});
+  ~buffer_arena_t();
+
+  buffer_arena_t(const buffer_arena_t &)            = delete;
+  buffer_arena_t &operator=(const buffer_arena_t &) = delete;
+
+  // 0 uses the arena's alignment
+  handle_buffer_slice_t allocate(VkDeviceSize vk_size,
+                                 VkDeviceSize vk_alignment = 0);
+  // the range is reused once everything recorded so far completed
+  void                  free(handle_buffer_slice_t handle);
+  const buffer_slice_t &get(handle_buffer_slice_t handle);
+  // hands back the freed ranges that are safe to reuse, allocate and free
+  // do this too, call it once per frame when the arena sits idle
+  void                  collect_garbage();
+
+ private:
+  struct block_t {
+    handle_buffer_t handle_buffer;
+    VmaVirtualBlock vma_virtual_block;
+    VkDeviceAddress vk_device_address;
+    uint8_t        *p_data;
+  };
+  struct pending_free_t {
+    uint64_t                            ticket;
+    internal::buffer_slice_allocation_t allocation;
+  };
+
+  // frees the ranges whose last possible use completed
+  void     retire();
+  uint32_t create_block(VkDeviceSize vk_size);
+
+  context_t            &_context;
+  config_buffer_arena_t _config;
+  VkDeviceSize          _vk_alignment;
+  // guards everything below, the slot map is only locked for writing
+  std::mutex                  _mutex;
+  std::vector<block_t>        _blocks;
+  std::vector<pending_free_t> _pending_frees;
+
+  core::slot_map_t<handle_buffer_slice_t, buffer_slice_t,
+                   internal::buffer_slice_allocation_t>
+      _slices;
+};
+
+}  // namespace gfx
+
+#endif
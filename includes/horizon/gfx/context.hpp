@@ -9,15 +9,30 @@
 
 #include "VkBootstrap.h"
 #include "horizon/core/core.hpp"
+#include "horizon/core/mpsc_queue.hpp"
+#include "horizon/core/slot_map.hpp"
+#include "horizon/core/thread_pool.hpp"
+#include "horizon/gfx/descriptor_allocator.hpp"
 #include "horizon/gfx/types.hpp"
 #define VMA_STATIC_VULKAN_FUNCTIONS  0
 #define VMA_DYNAMIC_VULKAN_FUNCTIONS 0
 #define VK_NO_PROTOTYPE
 #include <vk_mem_alloc.h>
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <optional>
+#include <set>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 
 namespace core {
 
@@ -27,20 +42,21 @@ class window_t;
 
 namespace utils {
 
-template <typename handle_t, typename map_t, typename data_t>
-inline handle_t create_and_insert_new_handle(map_t &map, data_t &data) {
-  handle_t handle = map.size() ? map.size() : 1;
-  while (map.contains(handle)) {
-    handle++;
-  }
-  map.insert({handle, data});
-  return handle;
+template <typename handle_t, typename map_t, typename hot_t,
+          typename cold_t = std::monostate>
+inline handle_t create_and_insert_new_handle(map_t &map, const hot_t &hot,
+                                             const cold_t &cold = {}) {
+  return map.insert(hot, cold);
 }
 
 template <typename data_t, typename handle_t, typename map_t>
 inline data_t &assert_and_get_data(handle_t handle, map_t &map) {
-  assert(map.contains(handle));
-  return map[handle];
+  return map.get(handle);
+}
+
+template <typename config_t, typename handle_t, typename map_t>
+inline config_t &assert_and_get_config(handle_t handle, map_t &map) {
+  return map.get_cold(handle);
 }
 
 }  // namespace utils
@@ -49,12 +65,38 @@ namespace gfx {
 
 constexpr VmaMemoryUsage default_vma_memory_usage =
     VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO;
+
+// a vma pool with its own blocks, its memory type is picked for a buffer
+// usage or for an image usage and format, whichever is set. everything
+// created in the pool has to be compatible with that memory type
+struct config_memory_pool_t {
+  VkBufferUsageFlags       vk_buffer_usage_flags;
+  VkImageUsageFlags        vk_image_usage;
+  VkFormat                 vk_format;
+  VmaAllocationCreateFlags vma_allocation_create_flags;
+  VmaMemoryUsage           vma_memory_usage = default_vma_memory_usage;
+  // VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT suits transient data freed in order
+  VmaPoolCreateFlags       vma_pool_create_flags;
+  // 0 lets vma pick, fixed size blocks keep texture pools from growing
+  // unevenly
+  VkDeviceSize             vk_block_size;
+  size_t                   min_block_count;
+  // 0 is unlimited
+  size_t                   max_block_count;
+  std::string              debug_name = "";
+};
+
 struct config_buffer_t {
   VkDeviceSize             vk_size;
   VkBufferUsageFlags       vk_buffer_usage_flags;
   VmaAllocationCreateFlags vma_allocation_create_flags;
   VmaMemoryUsage           vma_memory_usage = default_vma_memory_usage;
-  std::string              debug_name       = "";
+  // null allocates from vma's default pools
+  handle_memory_pool_t     handle_memory_pool = core::null_handle;
+  std::string              debug_name         = "";
+  // adds the transfer usage defragmentation copies with and opts the buffer
+  // in to being moved, see context_t::set_buffer_movable
+  bool                     movable            = false;
 };
 
 struct config_sampler_t {
@@ -94,7 +136,9 @@ struct config_image_t {
   VkImageTiling            vk_tiling         = VK_IMAGE_TILING_OPTIMAL;
   VkImageLayout            vk_initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
   VmaMemoryUsage           vma_memory_usage  = VMA_MEMORY_USAGE_AUTO;
-  std::string              debug_name        = "";
+  // null allocates from vma's default pools
+  handle_memory_pool_t     handle_memory_pool = core::null_handle;
+  std::string              debug_name         = "";
 };
 
 constexpr VkImageViewType vk_auto_image_view_type =
@@ -167,6 +211,43 @@ struct config_shader_t {
   std::string       debug_name = "";
 };
 
+// compiles every listed stage from one source in a single pass, each stage
+// still becomes its own shader with the matching config_shader_t
+struct config_shader_program_t {
+  std::string                code_or_path;
+  bool                       is_code = false;
+  std::string                name;
+  std::vector<shader_type_t> types;
+  shader_language_t          language   = shader_language_t::e_slang;
+  std::string                debug_name = "";
+};
+
+struct shader_parameter_t {
+  std::string      name;
+  uint32_t         binding;
+  uint32_t         space;
+  VkDescriptorType vk_descriptor_type;
+  // 0 for a runtime sized array
+  uint32_t         count = 1;
+};
+
+// what a shader reads, parameters only lists the bindings the entry point
+// actually uses
+struct shader_reflection_t {
+  VkShaderStageFlagBits           vk_shader_stage;
+  std::vector<shader_parameter_t> parameters;
+  uint32_t                        push_constant_size = 0;
+};
+
+struct shader_cache_stats_t {
+  uint32_t memory_hits = 0;
+  uint32_t disk_hits   = 0;
+  uint32_t misses      = 0;
+  // time spent inside slang on misses, and finding or loading entries on hits
+  double compile_time_ms = 0;
+  double lookup_time_ms  = 0;
+};
+
 VkPipelineColorBlendAttachmentState default_color_blend_attachment();
 
 struct config_pipeline_t {
@@ -223,15 +304,29 @@ struct config_fence_t {
 };
 
 struct config_semaphore_t {
-  std::string debug_name = "";
+  // timeline semaphores carry a monotonically increasing 64 bit value
+  bool        is_timeline   = false;
+  uint64_t    initial_value = 0;
+  std::string debug_name    = "";
+};
+
+// compute and transfer fall back to the graphics queue when the device has
+// no separate family for them
+enum class queue_type_t {
+  e_graphics,
+  e_compute,
+  e_transfer,
 };
 
 struct config_command_pool_t {
-  std::string debug_name = "";
+  // command buffers from this pool are submitted to this queue
+  queue_type_t queue_type = queue_type_t::e_graphics;
+  std::string  debug_name = "";
 };
 
 struct config_commandbuffer_t {
   handle_command_pool_t handle_command_pool;
+  VkCommandBufferLevel  vk_level   = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
   std::string           debug_name = "";
 };
 
@@ -241,6 +336,11 @@ struct config_timer_t {
 
 namespace internal {
 
+struct memory_pool_t {
+  VmaPool vma_pool;
+          operator VmaPool() { return vma_pool; }
+};
+
 struct queue_t {
   VkQueue  vk_queue;
   uint32_t vk_index;
@@ -258,97 +358,146 @@ struct swapchain_t {
 struct buffer_t {
   VkBuffer        vk_buffer;
   VmaAllocation   vma_allocation;
-  config_buffer_t config;
   void           *p_data = nullptr;
   VkDeviceAddress vk_device_address;
+  // what the memory stats count for this buffer
+  VkDeviceSize    vk_allocation_size;
+  uint32_t        memory_category;
+  // opted in through config.movable or set_buffer_movable
+  bool            movable = false;
                   operator VkBuffer() { return vk_buffer; }
 };
 
 struct sampler_t {
-  VkSampler        vk_sampler;
-  config_sampler_t config;
-                   operator VkSampler() { return vk_sampler; }
+  VkSampler vk_sampler;
+            operator VkSampler() { return vk_sampler; }
 };
 
 struct image_t {
-  VkImage        vk_image;
-  VmaAllocation  vma_allocation;
-  config_image_t config;
-  void          *p_data         = nullptr;
-  bool           from_swapchain = false;
-                 operator VkImage() { return vk_image; }
+  VkImage            vk_image;
+  VmaAllocation      vma_allocation;
+  VkImageAspectFlags vk_image_aspect;
+  void              *p_data         = nullptr;
+  bool               from_swapchain = false;
+  // what the memory stats count for this image
+  VkDeviceSize       vk_allocation_size;
+  uint32_t           vk_memory_type;
+  uint32_t           memory_category;
+  // opted in through set_image_movable, defragmentation assumes the layout
+  bool               movable = false;
+                     operator VkImage() { return vk_image; }
 };
 
 struct image_view_t {
-  VkImageView         vk_image_view;
-  config_image_view_t config;
-                      operator VkImageView() { return vk_image_view; }
+  VkImageView vk_image_view;
+              operator VkImageView() { return vk_image_view; }
 };
 
 struct descriptor_set_layout_t {
-  VkDescriptorSetLayout          vk_descriptor_set_layout;
-  config_descriptor_set_layout_t config;
+  VkDescriptorSetLayout             vk_descriptor_set_layout;
+  // descriptors a set of this layout takes from its pool, by type
+  std::vector<VkDescriptorPoolSize> vk_pool_sizes;
   operator VkDescriptorSetLayout() { return vk_descriptor_set_layout; }
 };
 
 struct descriptor_set_t {
-  VkDescriptorSet         vk_descriptor_set;
-  config_descriptor_set_t config;
+  VkDescriptorSet                vk_descriptor_set;
+  handle_descriptor_set_layout_t handle_descriptor_set_layout;
+  VkDescriptorPool               vk_descriptor_pool;
+  descriptor_allocator_t        *p_descriptor_allocator;
   operator VkDescriptorSet() { return vk_descriptor_set; }
 };
 
 struct pipeline_layout_t {
-  VkPipelineLayout         vk_pipeline_layout;
-  config_pipeline_layout_t config;
+  VkPipelineLayout vk_pipeline_layout;
   operator VkPipelineLayout() { return vk_pipeline_layout; }
 };
 
 struct shader_t {
-  VkShaderModule  vk_shader;
-  config_shader_t config;
-                  operator VkShaderModule() { return vk_shader; }
+  VkShaderModule      vk_shader;
+  shader_reflection_t reflection;
+                      operator VkShaderModule() { return vk_shader; }
 };
 
 struct pipeline_t {
   VkPipeline          vk_pipeline;
   VkPipelineBindPoint vk_pipeline_bind_point;
-  config_pipeline_t   config;
+  VkPipelineLayout    vk_pipeline_layout;
                       operator VkPipeline() { return vk_pipeline; }
 };
 
 struct fence_t {
-  VkFence        vk_fence;
-  config_fence_t config;
-                 operator VkFence() { return vk_fence; }
+  VkFence  vk_fence;
+  // serial of the last submission that signals this fence
+  uint64_t submit_serial = 0;
+           operator VkFence() { return vk_fence; }
 };
 
 struct semaphore_t {
-  VkSemaphore        vk_semaphore;
-  config_semaphore_t config;
-                     operator VkSemaphore() { return vk_semaphore; }
+  VkSemaphore vk_semaphore;
+              operator VkSemaphore() { return vk_semaphore; }
 };
 
 struct command_pool_t {
-  VkCommandPool         vk_command_pool;
-  config_command_pool_t config;
-                        operator VkCommandPool() { return vk_command_pool; }
+  VkCommandPool vk_command_pool;
+  queue_type_t  queue_type;
+                operator VkCommandPool() { return vk_command_pool; }
 };
 
 struct commandbuffer_t {
-  VkCommandBuffer        vk_commandbuffer;
-  config_commandbuffer_t config;
-                         operator VkCommandBuffer() { return vk_commandbuffer; }
+  VkCommandBuffer                     vk_commandbuffer;
+  handle_command_pool_t               handle_command_pool;
+  // serial of the last submission of this command buffer, 0 until submitted
+  uint64_t                            submit_serial = 0;
+  // retirement ticket of the last begin, 0 once submitted or freed
+  uint64_t                            begin_ticket  = 0;
+  // secondaries executed since the last begin, they share the submit serial
+  std::vector<handle_commandbuffer_t> handle_secondary_commandbuffers;
+                                      operator VkCommandBuffer() {
+    return vk_commandbuffer;
+  }
 };
 
 struct timer_t {
-  VkQueryPool    vk_query_pool;
-  config_timer_t config;
-                 operator VkQueryPool() { return vk_query_pool; }
+  VkQueryPool vk_query_pool;
+              operator VkQueryPool() { return vk_query_pool; }
 };
 
 }  // namespace internal
 
 class context_t;
+class shader_compiler_t;
+struct compiled_shader_t;
+
+struct semaphore_submit_info_t {
+  handle_semaphore_t    handle_semaphore;
+  // ignored for binary semaphores
+  uint64_t              value = 0;
+  VkPipelineStageFlags2 vk_pipeline_stages =
+      VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+};
+
+struct submit_info_t {
+  std::vector<handle_commandbuffer_t>  handle_commandbuffers;
+  std::vector<semaphore_submit_info_t> wait_semaphores;
+  std::vector<semaphore_submit_info_t> signal_semaphores;
+  // optional, submissions are tracked by serial either way
+  handle_fence_t                       handle_fence = core::null_handle;
+};
+
+// a barrier moving a resource between queue families has to be recorded twice,
+// as the release on the source queue and as the acquire on the destination
+// queue. between queues of the same family it is a plain barrier
+struct queue_ownership_transfer_t {
+  queue_type_t src_queue_type = queue_type_t::e_graphics;
+  queue_type_t dst_queue_type = queue_type_t::e_graphics;
+};
+
+// layouts derived from shader reflection, set layouts are indexed by space
+struct shader_layout_t {
+  std::vector<handle_descriptor_set_layout_t> handle_descriptor_set_layouts;
+  handle_pipeline_layout_t handle_pipeline_layout = core::null_handle;
+};
 
 struct buffer_descriptor_info_t {
   handle_buffer_t handle_buffer = core::null_handle;
@@ -384,6 +533,15 @@ struct rendering_attachment_t {
   VkClearValue        clear_value  = {0, 0, 0, 0};
 };
 
+// attachment formats a secondary command buffer recorded for use inside
+// cmd_begin_rendering has to declare up front
+struct rendering_inheritance_t {
+  std::vector<VkFormat> vk_color_formats{};
+  VkFormat              vk_depth_format   = VK_FORMAT_UNDEFINED;
+  VkFormat              vk_stencil_format = VK_FORMAT_UNDEFINED;
+  VkSampleCountFlagBits vk_samples        = VK_SAMPLE_COUNT_1_BIT;
+};
+
 struct buffer_copy_info_t {
   VkDeviceSize vk_src_offset = 0;
   VkDeviceSize vk_dst_offset = 0;
@@ -402,15 +560,144 @@ struct buffer_resource_range_t {
   uint64_t offset = 0;
 };
 
+struct config_defragmentation_t {
+  // null defragments vma's default pools
+  handle_memory_pool_t    handle_memory_pool = core::null_handle;
+  // one of VMA_DEFRAGMENTATION_FLAG_ALGORITHM_*, 0 is the balanced one
+  VmaDefragmentationFlags vma_defragmentation_flags = 0;
+  // bound the copies of a single pass, 0 is unbounded
+  VkDeviceSize            vk_max_bytes_per_pass    = 32 * 1024 * 1024;
+  uint32_t                max_allocations_per_pass = 256;
+};
+
+// resources a defragment_step call moved, their handles stay valid but name
+// new vulkan objects
+struct defragmentation_step_t {
+  // new VkBuffer at a new device address, descriptor sets were rewritten
+  // but device addresses taken before the step have to be fetched again
+  std::vector<handle_buffer_t>     moved_buffers;
+  std::vector<handle_image_t>      moved_images;
+  // views of moved_images, recreated in place
+  std::vector<handle_image_view_t> moved_image_views;
+};
+
+struct memory_counter_t {
+  uint64_t count      = 0;
+  uint64_t bytes      = 0;
+  // the most bytes held at once since the context was created
+  uint64_t peak_bytes = 0;
+};
+
+struct memory_heap_stats_t {
+  VkMemoryHeapFlags vk_memory_heap_flags;
+  // what the driver lets this process use and what it uses, including
+  // memory allocated outside of vma
+  uint64_t          budget;
+  uint64_t          usage;
+  // vma's device memory blocks and the allocations placed in them
+  uint64_t          block_bytes;
+  uint64_t          allocation_bytes;
+  uint32_t          block_count;
+  uint32_t          allocation_count;
+};
+
+struct memory_stats_t {
+  // bytes are actual allocation sizes, memory counts until it is freed, not
+  // until its handle is destroyed
+  memory_counter_t                        buffers;
+  memory_counter_t                        images;
+  // by category, the part of the debug name in front of the first ':', so
+  // "textures:albedo" counts towards "textures"
+  std::map<std::string, memory_counter_t> categories;
+  std::vector<memory_heap_stats_t>        heaps;
+  // totals over every vma block, only filled in by detailed stats
+  std::optional<VmaDetailedStatistics>    vma_detailed_statistics;
+};
+
+/*
+ * concurrency model
+ * - create_*, destroy_*, allocate_* and free_* may be called from any thread.
+ *   every resource table takes a writer lock on insert and erase only
+ * - get_*, get_*_config and every cmd_* read the tables without locking, a
+ *   handle is safe to use from any thread once its create call returned
+ * - a handle must not be used after, or concurrently with, its destroy call
+ * - every vkQueue* call and wait_idle serialize on one queue mutex, external
+ *   code that submits to any queue must hold queue_mutex()
+ * - allocate_descriptor_set takes persistent sets from a growable chain of
+ *   pools, a descriptor_allocator_t that locks its own mutex. sets that only
+ *   live for one frame come from base_t's frame_descriptor_allocator_t, one
+ *   chain per frame in flight, reset as a whole when the frame comes around
+ * - command pools are externally synchronized, a thread recording its own
+ *   commands should allocate from get_thread_command_pool(), which hands out a
+ *   pool private to the calling thread, or take transient command buffers
+ *   from acquire_commandbuffer(), which recycles them per thread
+ * - every thread compiling shaders owns its own slang session, so shader
+ *   compiles on different threads run in parallel
+ * - the *_async variants run the matching create call on the context's
+ *   thread pool and hand back a ticket, core::is_ready(ticket) tells whether
+ *   the handle is available yet without blocking
+ * - submit_async may be called from any thread, start_submission_thread and
+ *   stop_submission_thread must not race each other or submit_async
+ *
+ * submission serials
+ * every submission, whichever queue it goes to, takes the next serial and
+ * signals it on that queue's timeline semaphore, so the serial returned by
+ * submit can be polled with completed_serial or waited on with wait_serial,
+ * no fence round trip needed. a serial only counts as completed once every
+ * submission up to it finished on every queue. a batch of submit infos shares
+ * one serial and costs one vkQueueSubmit2 per run of infos on the same queue
+ *
+ * deferred destruction
+ * destroy_* and free_* retire the handle immediately and queue the vulkan
+ * object under a retirement ticket. begin_commandbuffer takes a ticket too,
+ * so every command buffer that could have recorded the object has a smaller
+ * one. once none of those is still waiting to be submitted, the ticket is
+ * stamped with the serial submitted by then, and the object is released
+ * when that serial completed. a command buffer that was begun has to be
+ * submitted or freed, until then nothing retired after its begin is released.
+ * collect_garbage releases everything that is safe, base_t calls it once per
+ * frame. shader modules are the exception, they are never referenced by the
+ * device and are destroyed immediately
+ *
+ * defragmentation
+ * defragment_step moves buffers and sampled images into other memory while
+ * their handles stay valid, rewriting the hot records in place. the copies
+ * go to the graphics queue and are only ordered after earlier graphics work,
+ * resources last written on another queue have to be idle. mapped buffers
+ * and images that can be rendered or stored to are never moved, other images
+ * only once set_image_movable opted them in
+ */
 class context_t {
  public:
-  context_t(const bool enable_validation);
+  // pipelines are created through a VkPipelineCache, when a path is given it
+  // is seeded from that file and written back on destruction
+  context_t(const bool                   enable_validation,
+            const std::filesystem::path &pipeline_cache_path = {});
   ~context_t();
 
   void wait_idle();
+  void collect_garbage();
+  // every submission bumps the submitted serial, the completed serial is
+  // read off the serial timeline semaphore
+  uint64_t submitted_serial();
+  uint64_t completed_serial();
+  void     wait_serial(uint64_t serial);
+  // same rule as deferred destruction for memory managed outside the
+  // context, whatever went out of use when the ticket was taken may be
+  // reused once is_retired returns true for it
+  uint64_t retirement_ticket();
+  bool     is_retired(uint64_t ticket);
+
+  // merges the cache stored at path into the live cache, later saves go there
+  void set_pipeline_cache_path(const std::filesystem::path &path);
+  bool save_pipeline_cache();
 
   handle_swapchain_t          create_swapchain(const core::window_t &window);
   void                        destroy_swapchain(handle_swapchain_t handle);
+  // reuses the surface and hands the old swapchain to the driver, the old
+  // handle is invalid afterwards
+  handle_swapchain_t recreate_swapchain(handle_swapchain_t    handle,
+                                        const core::window_t &window);
   std::vector<handle_image_t> get_swapchain_images(handle_swapchain_t handle);
   std::vector<handle_image_view_t> get_swapchain_image_views(
       handle_swapchain_t handle);
@@ -421,100 +708,245 @@ class context_t {
                          std::vector<handle_semaphore_t> handle_semaphore);
   internal::swapchain_t &get_swapchain(handle_swapchain_t handle);
 
-  handle_buffer_t     create_buffer(const config_buffer_t &config);
-  void                destroy_buffer(handle_buffer_t handle);
-  void               *map_buffer(handle_buffer_t handle);
-  void                unmap_buffer(handle_buffer_t handle);
-  VkDeviceAddress     get_buffer_device_address(handle_buffer_t handle);
-  internal::buffer_t &get_buffer(handle_buffer_t handle);
-  void                flush_buffer(handle_buffer_t handle);
-  // This iterates over all active handles and returns the final size, shouldnt
-  // be used in performance critical paths
+  handle_memory_pool_t create_memory_pool(const config_memory_pool_t &config);
+  // everything allocated from the pool has to be destroyed first
+  void                 destroy_memory_pool(handle_memory_pool_t handle);
+  internal::memory_pool_t    &get_memory_pool(handle_memory_pool_t handle);
+  const config_memory_pool_t &get_memory_pool_config(
+      handle_memory_pool_t handle);
+
+  handle_buffer_t        create_buffer(const config_buffer_t &config);
+  // creates every buffer with one vma allocation call per group of equal
+  // memory requirements, binds them in bulk and inserts the handles under
+  // one lock, handles come back in config order. vma's dedicated allocation
+  // heuristics are skipped, large buffers should use create_buffer
+  std::vector<handle_buffer_t> create_buffers(
+      std::span<const config_buffer_t> configs);
+  void                   destroy_buffer(handle_buffer_t handle);
+  void                  *map_buffer(handle_buffer_t handle);
+  void                   unmap_buffer(handle_buffer_t handle);
+  VkDeviceAddress        get_buffer_device_address(handle_buffer_t handle);
+  internal::buffer_t    &get_buffer(handle_buffer_t handle);
+  const config_buffer_t &get_buffer_config(handle_buffer_t handle);
+  void                   flush_buffer(handle_buffer_t handle);
+  // bytes of the allocations of every buffer whose memory was not freed yet
   uint64_t get_total_buffer_memory_allocated();
 
-  handle_sampler_t     create_sampler(const config_sampler_t &config);
-  void                 destroy_sampler(handle_sampler_t handle);
-  internal::sampler_t &get_sampler(handle_sampler_t handle);
-
-  handle_image_t     create_image(const config_image_t &config);
-  void               destroy_image(handle_image_t handle);
-  void              *map_image(handle_image_t handle);
-  void               unmap_image(handle_image_t handle);
-  internal::image_t &get_image(handle_image_t handle);
-  void               flush_image(handle_image_t handle);
+  handle_sampler_t        create_sampler(const config_sampler_t &config);
+  void                    destroy_sampler(handle_sampler_t handle);
+  internal::sampler_t    &get_sampler(handle_sampler_t handle);
+  const config_sampler_t &get_sampler_config(handle_sampler_t handle);
+
+  handle_image_t        create_image(const config_image_t &config);
+  // create_buffers for images
+  std::vector<handle_image_t> create_images(
+      std::span<const config_image_t> configs);
+  void                  destroy_image(handle_image_t handle);
+  void                 *map_image(handle_image_t handle);
+  void                  unmap_image(handle_image_t handle);
+  internal::image_t    &get_image(handle_image_t handle);
+  const config_image_t &get_image_config(handle_image_t handle);
+  void                  flush_image(handle_image_t handle);
 
   handle_image_view_t     create_image_view(const config_image_view_t &config);
   void                    destroy_image_view(handle_image_view_t handle);
   internal::image_view_t &get_image_view(handle_image_view_t handle);
+  const config_image_view_t &get_image_view_config(
+      handle_image_view_t handle);
+
+  // counters are kept up to date on create and destroy and heaps come from
+  // vma's budget, cheap enough to poll every frame. detailed also walks
+  // every vma block
+  memory_stats_t get_memory_stats(bool detailed = false);
+  // get_memory_stats as a json object, detailed adds vma's own dump of
+  // every pool and block under "vma"
+  std::string    get_memory_stats_json(bool detailed = false);
+  // has vma fetch fresh heap budgets from the driver, once per frame with a
+  // new frame_index. without VK_EXT_memory_budget the budgets are estimates
+  void           refresh_memory_budget(uint32_t frame_index);
+  bool           has_memory_budget();
+
+  // starts moving allocations out of sparsely used blocks, the moves are
+  // spread over the following defragment_step calls
+  void begin_defragmentation(const config_defragmentation_t &config = {});
+  // advances the defragmentation by at most one pass, meant to be called
+  // once per frame while nothing that uses a movable resource is being
+  // recorded or submitted
+  defragmentation_step_t defragment_step();
+  bool                   is_defragmenting();
+  // an image may only be moved while it rests in shader read only layout,
+  // owned by the graphics queue, with everything that wrote it submitted.
+  // whoever moves it out of that layout again has to opt it out first
+  void                   set_image_movable(handle_image_t handle,
+                                           bool           movable);
+  // same for a buffer, it may only be moved while the device only reads it,
+  // with everything that wrote it submitted. the buffer needs transfer src
+  // and dst usage, config.movable adds both. descriptor sets it is written
+  // into are rewritten once it moved, so it stays in place while any of
+  // them comes from a layout without use_bindless
+  void                   set_buffer_movable(handle_buffer_t handle,
+                                            bool            movable);
 
   handle_descriptor_set_layout_t create_descriptor_set_layout(
       const config_descriptor_set_layout_t &config);
   void destroy_descriptor_set_layout(handle_descriptor_set_layout_t handle);
   internal::descriptor_set_layout_t &get_descriptor_set_layout(
       handle_descriptor_set_layout_t handle);
+  const config_descriptor_set_layout_t &get_descriptor_set_layout_config(
+      handle_descriptor_set_layout_t handle);
 
   handle_descriptor_set_t allocate_descriptor_set(
       const config_descriptor_set_t &config);
+  // allocates from an allocator the caller owns, free_descriptor_set must not
+  // be called on the set. the caller drops the handles with
+  // forget_descriptor_sets before it resets the allocator
+  handle_descriptor_set_t allocate_descriptor_set(
+      const config_descriptor_set_t &config,
+      descriptor_allocator_t        &descriptor_allocator);
   void                    free_descriptor_set(handle_descriptor_set_t handle);
+  void forget_descriptor_sets(std::span<const handle_descriptor_set_t> handles);
+  // destroys a pool of a descriptor_allocator_t once no frame in flight can
+  // use its sets
+  void destroy_descriptor_pool(VkDescriptorPool vk_descriptor_pool);
   update_descriptor_set_t update_descriptor_set(handle_descriptor_set_t handle);
   internal::descriptor_set_t &get_descriptor_set(
       handle_descriptor_set_t handle);
+  const config_descriptor_set_t &get_descriptor_set_config(
+      handle_descriptor_set_t handle);
 
   handle_pipeline_layout_t create_pipeline_layout(
       const config_pipeline_layout_t &config);
   void destroy_pipeline_layout(handle_pipeline_layout_t handle);
   internal::pipeline_layout_t &get_pipeline_layout(
       handle_pipeline_layout_t handle);
+  const config_pipeline_layout_t &get_pipeline_layout_config(
+      handle_pipeline_layout_t handle);
 
-  handle_shader_t     create_shader(const config_shader_t &config);
-  void                destroy_shader(handle_shader_t handle);
-  internal::shader_t &get_shader(handle_shader_t handle);
+  handle_shader_t        create_shader(const config_shader_t &config);
+  // one shader per entry in config.types, in order
+  std::vector<handle_shader_t> create_shader_program(
+      const config_shader_program_t &config);
+  core::ticket_t<handle_shader_t> create_shader_async(
+      const config_shader_t &config);
+  core::ticket_t<std::vector<handle_shader_t>> create_shader_program_async(
+      const config_shader_program_t &config);
+  void                   destroy_shader(handle_shader_t handle);
+  internal::shader_t    &get_shader(handle_shader_t handle);
+  const config_shader_t &get_shader_config(handle_shader_t handle);
+  const shader_reflection_t &get_shader_reflection(handle_shader_t handle);
+  // the tightest layouts covering every given shader, bindings shared between
+  // stages are merged. the layouts are owned by the context and shared by
+  // every call that derives the same layout, do not destroy them
+  shader_layout_t get_shader_layout(std::span<const handle_shader_t> handles);
+  // compiled spirv is cached in memory, and on disk once a directory is set
+  void set_shader_cache_directory(const std::filesystem::path &path);
+  shader_cache_stats_t get_shader_cache_stats();
 
   handle_pipeline_t create_compute_pipeline(const config_pipeline_t &config);
   handle_pipeline_t create_graphics_pipeline(const config_pipeline_t &config);
+  // creates every pipeline in parallel on the thread pool and the calling
+  // thread, handles come back in config order. called from a thread pool job
+  // it creates them one after another on that thread instead
+  std::vector<handle_pipeline_t> create_compute_pipelines(
+      std::span<const config_pipeline_t> configs);
+  std::vector<handle_pipeline_t> create_graphics_pipelines(
+      std::span<const config_pipeline_t> configs);
+  core::ticket_t<handle_pipeline_t> create_compute_pipeline_async(
+      const config_pipeline_t &config);
+  core::ticket_t<handle_pipeline_t> create_graphics_pipeline_async(
+      const config_pipeline_t &config);
   void              destroy_pipeline(handle_pipeline_t handle);
   internal::pipeline_t &get_pipeline(handle_pipeline_t handle);
-
-  handle_fence_t     create_fence(const config_fence_t &config);
-  void               destroy_fence(handle_fence_t handle);
-  void               wait_fence(handle_fence_t handle);
-  void               reset_fence(handle_fence_t handle);
-  internal::fence_t &get_fence(handle_fence_t handle);
-
-  handle_semaphore_t     create_semaphore(const config_semaphore_t &config);
-  void                   destroy_semaphore(handle_semaphore_t handle);
-  internal::semaphore_t &get_semaphore(handle_semaphore_t handle);
+  const config_pipeline_t &get_pipeline_config(handle_pipeline_t handle);
+
+  handle_fence_t        create_fence(const config_fence_t &config);
+  void                  destroy_fence(handle_fence_t handle);
+  void                  wait_fence(handle_fence_t handle);
+  void                  reset_fence(handle_fence_t handle);
+  internal::fence_t    &get_fence(handle_fence_t handle);
+  const config_fence_t &get_fence_config(handle_fence_t handle);
+
+  handle_semaphore_t        create_semaphore(const config_semaphore_t &config);
+  void                      destroy_semaphore(handle_semaphore_t handle);
+  internal::semaphore_t    &get_semaphore(handle_semaphore_t handle);
+  const config_semaphore_t &get_semaphore_config(handle_semaphore_t handle);
+  handle_semaphore_t        create_timeline_semaphore(
+             uint64_t initial_value = 0, const std::string &debug_name = "");
+  // host side access to timeline semaphores
+  uint64_t get_semaphore_value(handle_semaphore_t handle);
+  void     signal_semaphore(handle_semaphore_t handle, uint64_t value);
+  // returns false if the timeout in nanoseconds elapsed first
+  bool     wait_semaphore(handle_semaphore_t handle, uint64_t value,
+                          uint64_t timeout = UINT64_MAX);
 
   handle_command_pool_t create_command_pool(
       const config_command_pool_t &config);
   void                      destroy_command_pool(handle_command_pool_t handle);
   internal::command_pool_t &get_command_pool(handle_command_pool_t handle);
-
+  const config_command_pool_t &get_command_pool_config(
+      handle_command_pool_t handle);
+  // lazily created, owned by the context and destroyed with it
+  handle_command_pool_t get_thread_command_pool(
+      queue_type_t queue_type = queue_type_t::e_graphics);
+
+  // hands out a command buffer from the calling thread's ring for queue_type,
+  // once the ring is warm this allocates nothing. the ring owns the command
+  // buffer, it must be submitted, or executed by a submitted primary, and
+  // never freed. its pool is reset wholesale once everything handed out from
+  // it completed
+  handle_commandbuffer_t acquire_commandbuffer(
+      queue_type_t         queue_type = queue_type_t::e_graphics,
+      VkCommandBufferLevel vk_level   = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
   handle_commandbuffer_t allocate_commandbuffer(
       const config_commandbuffer_t &config);
   void free_commandbuffer(handle_commandbuffer_t handle);
   void begin_commandbuffer(handle_commandbuffer_t handle,
                            bool                   single_use = false);
+  // begins a secondary command buffer that continues a cmd_begin_rendering
+  // with matching attachment formats, no state is inherited from the primary
+  void begin_secondary_commandbuffer(
+      handle_commandbuffer_t         handle,
+      const rendering_inheritance_t &rendering_inheritance,
+      bool                           single_use = false);
   void end_commandbuffer(handle_commandbuffer_t handle);
-  void submit_commandbuffer(
+  // both return the serial of the submission, handle_fence may be null. the
+  // queue is the one the command buffers' pool was created for
+  uint64_t submit(const submit_info_t &info);
+  // submits the infos in order, consecutive infos on the same queue share
+  // one vkQueueSubmit2, split only after infos that carry a fence
+  uint64_t submit(std::span<const submit_info_t> infos);
+  // hands the submission to the submission thread, which batches everything
+  // queued since its last wakeup into one submit. without a running
+  // submission thread the info is submitted on the calling thread
+  core::ticket_t<uint64_t> submit_async(submit_info_t info);
+  void                     start_submission_thread();
+  // submits whatever is still queued before joining
+  void                     stop_submission_thread();
+  uint64_t submit_commandbuffer(
       handle_commandbuffer_t                   handle,
       const std::vector<handle_semaphore_t>   &wait_semaphore_handles,
       const std::vector<VkPipelineStageFlags> &vk_pipeline_stages,
       const std::vector<handle_semaphore_t>   &signal_semaphore_handles,
-      handle_fence_t                           handle_fence);
+      handle_fence_t handle_fence = core::null_handle);
   internal::commandbuffer_t &get_commandbuffer(handle_commandbuffer_t handle);
+  const config_commandbuffer_t &get_commandbuffer_config(
+      handle_commandbuffer_t handle);
 
-  handle_timer_t       create_timer(const config_timer_t &config);
-  void                 destroy_timer(handle_timer_t handle);
-  std::optional<float> timer_get_time(handle_timer_t handle);
-  internal::timer_t   &get_timer(handle_timer_t handle);
+  handle_timer_t        create_timer(const config_timer_t &config);
+  void                  destroy_timer(handle_timer_t handle);
+  std::optional<float>  timer_get_time(handle_timer_t handle);
+  internal::timer_t    &get_timer(handle_timer_t handle);
+  const config_timer_t &get_timer_config(handle_timer_t handle);
 
   void cmd_bind_pipeline(handle_commandbuffer_t handle_commandbuffer,
                          handle_pipeline_t      handle_pipeline);
+  // one dynamic offset per dynamic uniform or storage buffer binding in the
+  // bound sets, in set and then binding order
   void cmd_bind_descriptor_sets(
       handle_commandbuffer_t handle_commandbuffer,
       handle_pipeline_t handle_pipeline, uint32_t vk_first_set,
-      const std::vector<handle_descriptor_set_t> &handle_descriptor_sets);
+      const std::vector<handle_descriptor_set_t> &handle_descriptor_sets,
+      const std::vector<uint32_t>                &vk_dynamic_offsets = {});
   void cmd_push_constants(handle_commandbuffer_t handle_commandbuffer,
                           handle_pipeline_t      handle_pipeline,
                           VkShaderStageFlags     vk_shader_stages,
@@ -532,8 +964,15 @@ class context_t {
       handle_commandbuffer_t                       handle_commandbuffer,
       const std::vector<rendering_attachment_t>   &color_rendering_attachments,
       const std::optional<rendering_attachment_t> &depth_rendering_attachment,
-      const VkRect2D &vk_render_area, uint32_t vk_layer_count = 1);
+      const VkRect2D &vk_render_area, uint32_t vk_layer_count = 1,
+      VkRenderingFlags vk_rendering_flags = 0);
   void cmd_end_rendering(handle_commandbuffer_t handle_commandbuffer);
+  // the rendering must have been begun with
+  // VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT
+  void cmd_execute_commands(
+      handle_commandbuffer_t handle_commandbuffer,
+      const std::vector<handle_commandbuffer_t>
+          &handle_secondary_commandbuffers);
   void cmd_draw(handle_commandbuffer_t handle_commandbuffer,
                 uint32_t vk_vertex_count, uint32_t vk_instance_count,
                 uint32_t vk_first_vertex, uint32_t vk_first_instance);
@@ -548,6 +987,14 @@ class context_t {
                       VkImageLayout                   vk_dst_image_layout,
                       const std::vector<VkImageBlit> &vk_image_blits,
                       VkFilter                        vk_filter);
+  // unlike blits, copies work for block compressed formats and any format
+  // regardless of its blit support
+  void cmd_copy_image(handle_commandbuffer_t          handle_commandbuffer,
+                      handle_image_t                  src_image_handle,
+                      VkImageLayout                   vk_src_image_layout,
+                      handle_image_t                  dst_image_handle,
+                      VkImageLayout                   vk_dst_image_layout,
+                      const std::vector<VkImageCopy> &vk_image_copies);
   void cmd_pipeline_barrier(
       handle_commandbuffer_t                    handle_commandbuffer,
       VkPipelineStageFlags                      vk_src_pipeline_stage_flags,
@@ -561,15 +1008,17 @@ class context_t {
       VkImageLayout vk_old_image_layout, VkImageLayout vk_new_image_layout,
       VkAccessFlags vk_src_access_mask, VkAccessFlags vk_dst_access_mask,
       VkPipelineStageFlags          vk_src_pipeline_stage,
-      VkPipelineStageFlags          vk_dst_pipeline_stage,
-      const image_resource_range_t &image_resource_range = {});
+      VkPipelineStageFlags              vk_dst_pipeline_stage,
+      const image_resource_range_t     &image_resource_range     = {},
+      const queue_ownership_transfer_t &queue_ownership_transfer = {});
   void cmd_buffer_memory_barrier(
       handle_commandbuffer_t handle_commandbuffer,
       handle_buffer_t handle_buffer, VkAccessFlags vk_src_access_mask,
       VkAccessFlags                  vk_dst_access_mask,
       VkPipelineStageFlags           vk_src_pipeline_stage,
-      VkPipelineStageFlags           vk_dst_pipeline_stage,
-      const buffer_resource_range_t &buffer_resource_range = {});
+      VkPipelineStageFlags              vk_dst_pipeline_stage,
+      const buffer_resource_range_t    &buffer_resource_range    = {},
+      const queue_ownership_transfer_t &queue_ownership_transfer = {});
   // maybe expose multiple sub regions
   void cmd_copy_buffer(handle_commandbuffer_t handle_commandbuffer,
                        handle_buffer_t src_handle, handle_buffer_t dst_handle,
@@ -604,42 +1053,268 @@ class context_t {
   vkb::Device         &device();
   internal::queue_t   &graphics_queue();
   internal::queue_t   &present_queue();
-  VkDescriptorPool    &descriptor_pool();
+  internal::queue_t   &compute_queue();
+  internal::queue_t   &transfer_queue();
+  internal::queue_t   &queue(queue_type_t queue_type);
+  // a raw pool of 128 combined image samplers, only meant for imgui
+  VkDescriptorPool    &imgui_descriptor_pool();
+  std::mutex          &queue_mutex();
+  VkPipelineCache     &pipeline_cache();
+  core::thread_pool_t &thread_pool();
 
  private:
   void create_instance();
   void create_device();
   void create_allocator();
-  void create_descriptor_pool();
+  void create_descriptor_allocator();
+  void create_pipeline_cache();
+  void create_queue_timelines();
+  std::pair<uint32_t, uint32_t> queue_family_indices(
+      const queue_ownership_transfer_t &queue_ownership_transfer);
+  handle_swapchain_t build_swapchain(const core::window_t &window,
+                                     VkSurfaceKHR          vk_surface,
+                                     VkSwapchainKHR        vk_old_swapchain);
+  std::vector<handle_pipeline_t> create_pipelines(
+      std::span<const config_pipeline_t> configs,
+      handle_pipeline_t (context_t::*create)(const config_pipeline_t &));
+  handle_descriptor_set_layout_t get_derived_descriptor_set_layout(
+      const config_descriptor_set_layout_t &config);
+  handle_pipeline_layout_t get_derived_pipeline_layout(
+      const config_pipeline_layout_t &config);
+  handle_shader_t    build_shader(const config_shader_t   &config,
+                                  const compiled_shader_t &compiled_shader);
+  // the config with vk_auto_calculate_mip_levels replaced by the mip count
+  config_image_t        resolve_image_config(const config_image_t &config);
+  VkImageViewCreateInfo image_view_create_info(
+      const config_image_view_t &config);
+  // vma allocates memory for the batch create calls without knowing what it
+  // is for, so the memory type vma would pick for the resource is looked up
+  // once per distinct create info and pinned, and resources whose sizes share
+  // a size class are allocated together in pages sized for the largest one
+  template <typename vk_create_info_t>
+  void allocate_memory_pages(
+      std::span<const vk_create_info_t>     vk_create_infos,
+      std::span<const VkMemoryRequirements> vk_memory_requirements,
+      std::span<VmaAllocationCreateInfo>    vma_allocation_create_infos,
+      std::span<VmaAllocation>              vma_allocations,
+      std::span<VmaAllocationInfo>          vma_allocation_infos);
+  bool is_memory_type_host_visible(uint32_t vk_memory_type);
+  // false once vma has nothing left to move
+  bool begin_defragmentation_pass();
+  void swap_defragmented_resources(defragmentation_step_t &step);
+  void forget_descriptor_buffer_writes(handle_descriptor_set_t handle);
+  // buffers written into descriptor sets that cannot be updated after bind,
+  // the caller holds _defragmentation_mutex
+  std::set<handle_buffer_t> descriptor_pinned_buffers();
+  VkResult end_defragmentation_pass();
+  // a resource destroyed during a pass is dropped from it, its memory is
+  // then freed when the pass ends. *p_vk_image receives the destination
+  // image of a move that was not swapped in yet
+  bool abandon_defragmentation_move(VmaAllocation vma_allocation,
+                                    VkImage      *p_vk_image = nullptr);
+  uint32_t memory_category(const std::string &debug_name);
+  void     track_allocation(memory_counter_t &counter, uint32_t memory_category,
+                            VkDeviceSize vk_size);
+  void     untrack_allocation(memory_counter_t &counter,
+                              uint32_t memory_category, VkDeviceSize vk_size);
+  void open_commandbuffer(internal::commandbuffer_t &commandbuffer);
+  void close_commandbuffer(internal::commandbuffer_t &commandbuffer);
+  void defer_destruction(std::function<void()> destroy);
+  // stamps the tickets no unsubmitted command buffer can still precede
+  void stamp_retirement_tickets();
+  // tickets below the returned one are retired
+  uint64_t retired_ticket();
+  void release_deferred_destructions(uint64_t ticket);
+  void submission_thread();
 
  private:
   const bool          _validation;
   vkb::Instance       _vkb_instance;
   vkb::PhysicalDevice _vkb_physical_device;
   vkb::Device         _vkb_device;
+  bool                _vk_memory_budget = false;
   internal::queue_t   _graphics_queue;
   internal::queue_t   _present_queue;
+  internal::queue_t   _compute_queue;
+  internal::queue_t   _transfer_queue;
   VmaAllocator        _vma_allocator;
-  VkDescriptorPool    _vk_descriptor_pool;
-
-  std::map<handle_swapchain_t, internal::swapchain_t>   _swapchains;
-  std::map<handle_buffer_t, internal::buffer_t>         _buffers;
-  std::map<handle_sampler_t, internal::sampler_t>       _samplers;
-  std::map<handle_image_t, internal::image_t>           _images;
-  std::map<handle_image_view_t, internal::image_view_t> _image_views;
-  std::map<handle_descriptor_set_layout_t, internal::descriptor_set_layout_t>
+  // persistent sets come from a growable chain of pools, the raw pool is
+  // only handed to imgui
+  std::unique_ptr<descriptor_allocator_t> _descriptor_allocator;
+  VkDescriptorPool                        _vk_imgui_descriptor_pool;
+
+  std::filesystem::path _pipeline_cache_path;
+  VkPipelineCache       _vk_pipeline_cache;
+
+  std::unique_ptr<shader_compiler_t> _shader_compiler;
+  // runs the *_async create calls, joined first on destruction so no job
+  // outlives the tables it writes to
+  std::unique_ptr<core::thread_pool_t> _thread_pool;
+
+  // layouts handed out by get_shader_layout, keyed by a hash of their config.
+  // the config is kept next to the layout, a hit only counts once it compares
+  // equal
+  std::mutex _derived_layouts_mutex;
+  std::unordered_multimap<
+      uint64_t,
+      std::pair<config_descriptor_set_layout_t, handle_descriptor_set_layout_t>>
+      _derived_descriptor_set_layouts;
+  std::unordered_multimap<
+      uint64_t, std::pair<config_pipeline_layout_t, handle_pipeline_layout_t>>
+      _derived_pipeline_layouts;
+
+  // guards every vkQueue* call and vkDeviceWaitIdle, graphics and present may
+  // be the same VkQueue so a single mutex covers both
+  std::mutex _queue_mutex;
+  std::mutex _thread_command_pools_mutex;
+  // one pool per queue type, indexed by queue_type_t
+  std::unordered_map<std::thread::id, std::array<handle_command_pool_t, 3>>
+      _thread_command_pools;
+  struct commandbuffer_ring_slot_t {
+    handle_command_pool_t               handle_command_pool;
+    std::vector<handle_commandbuffer_t> handle_commandbuffers;
+    // command buffers handed out since the pool was last reset
+    uint32_t                            used = 0;
+  };
+  // slots from oldest to newest, command buffers come out of the back one
+  using commandbuffer_ring_t = std::deque<commandbuffer_ring_slot_t>;
+  // one ring per queue type and level, indexed by
+  // 2 * queue_type_t + (level == secondary), also guarded by
+  // _thread_command_pools_mutex
+  std::unordered_map<std::thread::id, std::array<commandbuffer_ring_t, 6>>
+      _commandbuffer_rings;
+
+  bool is_ring_slot_retired(const commandbuffer_ring_slot_t &slot);
+
+  struct deferred_destruction_t {
+    uint64_t              ticket;
+    std::function<void()> destroy;
+  };
+  // every ticket below ticket is safe once serial completed
+  struct retirement_stamp_t {
+    uint64_t ticket;
+    uint64_t serial;
+  };
+  struct queue_timeline_t {
+    VkSemaphore           vk_semaphore;
+    // serial of the last submission made to this queue
+    std::atomic<uint64_t> last_serial = 0;
+  };
+  // one timeline per distinct VkQueue, queue types that fall back to another
+  // queue share its timeline
+  std::deque<queue_timeline_t> _queue_timelines;
+  uint32_t                     _queue_timeline_indices[3];
+  struct pending_submission_t {
+    submit_info_t          info;
+    std::promise<uint64_t> promise;
+  };
+  core::mpsc_queue_t<pending_submission_t> _pending_submissions;
+  // bumped on every submit_async, the submission thread sleeps on it
+  std::atomic<uint64_t> _submission_signal       = 0;
+  std::atomic<bool>     _submission_thread_stop  = false;
+  std::atomic<bool>     _submission_thread_alive = false;
+  std::thread           _submission_thread;
+
+  struct defragmentation_move_t {
+    handle_buffer_t handle_buffer = core::null_handle;
+    handle_image_t  handle_image  = core::null_handle;
+    // bound to the destination of the move
+    VkBuffer        vk_buffer     = VK_NULL_HANDLE;
+    VkImage         vk_image      = VK_NULL_HANDLE;
+  };
+  enum class defragmentation_stage_t {
+    e_idle,
+    // copies in flight, everything still uses the old resources
+    e_copying,
+    // new resources swapped in, old memory may still be read by work
+    // recorded before the swap
+    e_releasing,
+  };
+  struct defragmentation_t {
+    VmaDefragmentationContext vma_defragmentation_context = VK_NULL_HANDLE;
+    defragmentation_stage_t   stage = defragmentation_stage_t::e_idle;
+    VmaDefragmentationPassMoveInfo vma_pass_move_info{};
+    // parallel to vma_pass_move_info.pMoves
+    std::vector<defragmentation_move_t> moves;
+    uint64_t                            copy_serial = 0;
+    // the pass ends, freeing the memory moved from, once this retired.
+    // nullopt when the pass moved nothing
+    std::optional<uint64_t>             release_ticket;
+  };
+  std::mutex        _defragmentation_mutex;
+  defragmentation_t _defragmentation;
+  // the buffer descriptor last written at each set, binding and array
+  // element, guarded by _defragmentation_mutex. tells which buffers can be
+  // moved and which descriptors to rewrite once they were
+  struct descriptor_buffer_write_t {
+    handle_buffer_t  handle_buffer;
+    VkDescriptorType vk_descriptor_type;
+    VkDeviceSize     vk_offset;
+    VkDeviceSize     vk_range;
+  };
+  std::map<std::tuple<handle_descriptor_set_t, uint32_t, uint32_t>,
+           descriptor_buffer_write_t>
+      _descriptor_buffer_writes;
+
+  // guards every memory counter and the category table
+  std::mutex                                _memory_stats_mutex;
+  memory_counter_t                          _buffer_memory;
+  memory_counter_t                          _image_memory;
+  std::vector<std::string>                  _memory_category_names;
+  std::vector<memory_counter_t>             _memory_categories;
+  std::unordered_map<std::string, uint32_t> _memory_category_indices;
+
+  std::atomic<uint64_t>              _submitted_serial = 0;
+  std::atomic<uint64_t>              _completed_serial = 0;
+  // guards the tickets, the stamps and the deferred destructions
+  std::mutex                         _retirement_mutex;
+  uint64_t                           _next_ticket    = 1;
+  uint64_t                           _retired_ticket = 0;
+  // begin tickets of the command buffers begun but not yet submitted
+  std::multiset<uint64_t>            _open_commandbuffer_tickets;
+  std::deque<retirement_stamp_t>     _retirement_stamps;
+  std::deque<deferred_destruction_t> _deferred_destructions;
+
+  // every table is a dense generational slot map, the hot record (vulkan
+  // handles, allocations) is what the cmd_* paths touch, the config is kept
+  // in the cold side array and only read on creation or through get_*_config
+  core::slot_map_t<handle_swapchain_t, internal::swapchain_t> _swapchains;
+  core::slot_map_t<handle_memory_pool_t, internal::memory_pool_t,
+                   config_memory_pool_t>
+      _memory_pools;
+  core::slot_map_t<handle_buffer_t, internal::buffer_t, config_buffer_t>
+      _buffers;
+  core::slot_map_t<handle_sampler_t, internal::sampler_t, config_sampler_t>
+      _samplers;
+  core::slot_map_t<handle_image_t, internal::image_t, config_image_t> _images;
+  core::slot_map_t<handle_image_view_t, internal::image_view_t,
+                   config_image_view_t>
+      _image_views;
+  core::slot_map_t<handle_descriptor_set_layout_t,
+                   internal::descriptor_set_layout_t,
+                   config_descriptor_set_layout_t>
       _descriptor_set_layouts;
-  std::map<handle_descriptor_set_t, internal::descriptor_set_t>
+  core::slot_map_t<handle_descriptor_set_t, internal::descriptor_set_t,
+                   config_descriptor_set_t>
       _descriptor_sets;
-  std::map<handle_pipeline_layout_t, internal::pipeline_layout_t>
-                                                              _pipeline_layouts;
-  std::map<handle_shader_t, internal::shader_t>               _shaders;
-  std::map<handle_pipeline_t, internal::pipeline_t>           _pipelines;
-  std::map<handle_fence_t, internal::fence_t>                 _fences;
-  std::map<handle_semaphore_t, internal::semaphore_t>         _semaphores;
-  std::map<handle_command_pool_t, internal::command_pool_t>   _command_pools;
-  std::map<handle_commandbuffer_t, internal::commandbuffer_t> _commandbuffers;
-  std::map<handle_timer_t, internal::timer_t>                 _timers;
+  core::slot_map_t<handle_pipeline_layout_t, internal::pipeline_layout_t,
+                   config_pipeline_layout_t>
+      _pipeline_layouts;
+  core::slot_map_t<handle_shader_t, internal::shader_t, config_shader_t>
+      _shaders;
+  core::slot_map_t<handle_pipeline_t, internal::pipeline_t, config_pipeline_t>
+      _pipelines;
+  core::slot_map_t<handle_fence_t, internal::fence_t, config_fence_t> _fences;
+  core::slot_map_t<handle_semaphore_t, internal::semaphore_t,
+                   config_semaphore_t>
+      _semaphores;
+  core::slot_map_t<handle_command_pool_t, internal::command_pool_t,
+                   config_command_pool_t>
+      _command_pools;
+  core::slot_map_t<handle_commandbuffer_t, internal::commandbuffer_t,
+                   config_commandbuffer_t>
+      _commandbuffers;
+  core::slot_map_t<handle_timer_t, internal::timer_t, config_timer_t> _timers;
 };
 
 template <typename T>
@@ -677,6 +1352,7 @@ define_fmt(gfx::handle_semaphore_t);
 define_fmt(gfx::handle_command_pool_t);
 define_fmt(gfx::handle_commandbuffer_t);
 define_fmt(gfx::handle_timer_t);
+define_fmt(gfx::handle_memory_pool_t);
 
 #define define_handle_hash(name)                  \
   template <>                                     \
@@ -703,5 +1379,6 @@ define_handle_hash(gfx::handle_semaphore_t);
 define_handle_hash(gfx::handle_command_pool_t);
 define_handle_hash(gfx::handle_commandbuffer_t);
 define_handle_hash(gfx::handle_timer_t);
+define_handle_hash(gfx::handle_memory_pool_t);
 
 #endif
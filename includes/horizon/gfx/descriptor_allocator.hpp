@@ -0,0 +1,95 @@
+#ifndef GFX_DESCRIPTOR_ALLOCATOR_HPP
+#define GFX_DESCRIPTOR_ALLOCATOR_HPP
+
+#include <volk.h>
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace gfx {
+
+class context_t;
+
+// descriptors of one type a pool holds for each set it is sized for
+struct descriptor_pool_ratio_t {
+  VkDescriptorType vk_descriptor_type;
+  float            ratio;
+};
+
+inline const std::vector<descriptor_pool_ratio_t>
+    default_descriptor_pool_ratios{
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f},
+        {VK_DESCRIPTOR_TYPE_SAMPLER, 1.f},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2.f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+    };
+
+/*
+ * growable chain of right sized descriptor pools
+ * sets come from the newest pool with room left, once every pool is out of
+ * room a pool for 1.5 times as many sets joins the chain, up to
+ * max_sets_per_pool. a set needing more descriptors of a type than the
+ * ratios give a pool is tried in every ready pool without retiring any of
+ * them, and gets a pool big enough for it when none has room
+ * reset hands every pool back at once with vkResetDescriptorPool, which is
+ * how a linear allocator recycles its sets. free is only allowed when the
+ * pools are created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+ * the destructor hands the pools to the context's deferred destruction, so
+ * frames in flight keep their sets
+ * every call may come from any thread
+ */
+class descriptor_allocator_t {
+ public:
+  static constexpr uint32_t max_sets_per_pool = 4096;
+
+  descriptor_allocator_t(context_t                  &context,
+                         VkDescriptorPoolCreateFlags vk_descriptor_pool_flags,
+                         uint32_t                    sets_per_pool,
+                         const std::vector<descriptor_pool_ratio_t> &ratios =
+                             default_descriptor_pool_ratios);
+  ~descriptor_allocator_t();
+
+  descriptor_allocator_t(const descriptor_allocator_t &)            = delete;
+  descriptor_allocator_t &operator=(const descriptor_allocator_t &) = delete;
+
+  // descriptorPool of the allocate info is filled in, vk_set_pool_sizes are
+  // the descriptors the set needs by type. *p_vk_descriptor_pool receives
+  // the pool the set came from
+  VkDescriptorSet allocate(
+      VkDescriptorSetAllocateInfo           vk_descriptor_set_allocate_info,
+      std::span<const VkDescriptorPoolSize> vk_set_pool_sizes,
+      VkDescriptorPool                      *p_vk_descriptor_pool = nullptr);
+  void free(VkDescriptorPool vk_descriptor_pool,
+            VkDescriptorSet  vk_descriptor_set);
+  // every set allocated so far has to be out of use
+  void reset();
+
+ private:
+  VkDescriptorPool create_pool(
+      std::span<const VkDescriptorPoolSize> vk_set_pool_sizes);
+  // whether a set needs no more descriptors of any type than the ratios
+  // give a pool
+  bool fits_pool(std::span<const VkDescriptorPoolSize> vk_set_pool_sizes) const;
+
+  context_t                           &_context;
+  VkDevice                             _vk_device;
+  VkDescriptorPoolCreateFlags          _vk_descriptor_pool_flags;
+  std::vector<descriptor_pool_ratio_t> _ratios;
+  // guards everything below
+  std::mutex                           _mutex;
+  uint32_t                             _sets_per_pool;
+  // pools that may have room left, the last one is tried first
+  std::vector<VkDescriptorPool>        _ready_pools;
+  std::vector<VkDescriptorPool>        _full_pools;
+};
+
+}  // namespace gfx
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef GFX_FRAME_ALLOCATOR_HPP
+#define GFX_FRAME_ALLOCATOR_HPP
+
+#include "horizon/gfx/context.hpp"
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan_core.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "horizon/gfx/types.hpp"
+
+namespace gfx {
+
+struct frame_allocation_t {
+  void           *p_data;
+  VkDeviceAddress vk_device_address;
+  // from the start of buffer(), usable as a dynamic offset
+  uint32_t        vk_offset;
+};
+
+/*
+ * bump allocator for data that only lives for one frame, per draw constants
+ * and the like
+ * one persistently mapped buffer is split into a slice per frame in flight,
+ * allocating is an atomic pointer bump in the current slice, so workers
+ * recording in parallel can allocate too. since every slice lives in the
+ * same buffer a descriptor set written once with a dynamic uniform or
+ * storage buffer binding serves every frame, only the dynamic offset changes
+ */
+class frame_allocator_t {
+ public:
+  frame_allocator_t(context_t &context, uint32_t frame_count,
+                    VkDeviceSize vk_size_per_frame = 4 * 1024 * 1024);
+  ~frame_allocator_t();
+
+  frame_allocator_t(const frame_allocator_t &)            = delete;
+  frame_allocator_t &operator=(const frame_allocator_t &) = delete;
+
+  // empties the frame's slice, everything allocated from it the last time
+  // the frame came around must have completed
+  void begin_frame(uint32_t frame);
+
+  // 0 aligns for use as a uniform or storage buffer offset
+  frame_allocation_t allocate(VkDeviceSize vk_size,
+                              VkDeviceSize vk_alignment = 0);
+  template <typename T>
+  frame_allocation_t push(const T &value) {
+    frame_allocation_t frame_allocation = allocate(sizeof(T));
+    std::memcpy(frame_allocation.p_data, &value, sizeof(T));
+    return frame_allocation;
+  }
+
+  handle_buffer_t buffer();
+
+ private:
+  context_t      &_context;
+  VkDeviceSize    _vk_size_per_frame;
+  VkDeviceSize    _vk_alignment;
+  handle_buffer_t _handle_buffer;
+  uint8_t        *_p_data;
+  VkDeviceAddress _vk_device_address;
+  // offsets of the current slice, allocations bump _offset towards _end
+  std::atomic<VkDeviceSize> _offset = 0;
+  VkDeviceSize              _end    = 0;
+};
+
+}  // namespace gfx
+
+#endif
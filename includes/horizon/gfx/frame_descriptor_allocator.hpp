@@ -0,0 +1,60 @@
+#ifndef GFX_FRAME_DESCRIPTOR_ALLOCATOR_HPP
+#define GFX_FRAME_DESCRIPTOR_ALLOCATOR_HPP
+
+#include "horizon/gfx/context.hpp"
+#include "horizon/gfx/descriptor_allocator.hpp"
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "horizon/gfx/types.hpp"
+
+namespace gfx {
+
+/*
+ * linear allocator for descriptor sets that only live for one frame
+ * every frame in flight owns a growable chain of pools, sets are never freed
+ * one by one, the whole chain is reset with vkResetDescriptorPool when the
+ * frame slot comes around again. the pools stop growing once they fit the
+ * busiest frame, after that allocating never creates a pool
+ * allocate may be called from any thread
+ */
+class frame_descriptor_allocator_t {
+ public:
+  frame_descriptor_allocator_t(context_t &context, uint32_t frame_count,
+                               uint32_t sets_per_pool = 256);
+  ~frame_descriptor_allocator_t();
+
+  frame_descriptor_allocator_t(const frame_descriptor_allocator_t &) = delete;
+  frame_descriptor_allocator_t &operator=(
+      const frame_descriptor_allocator_t &) = delete;
+
+  // hands the frame's sets back, everything using them the last time the
+  // frame came around must have completed
+  void begin_frame(uint32_t frame);
+
+  // the set is valid until the current frame comes around again, it must
+  // not be passed to free_descriptor_set
+  handle_descriptor_set_t allocate(const config_descriptor_set_t &config);
+
+ private:
+  struct frame_t {
+    std::unique_ptr<descriptor_allocator_t> descriptor_allocator;
+    std::vector<handle_descriptor_set_t>    handle_descriptor_sets;
+  };
+
+  context_t           &_context;
+  std::vector<frame_t> _frames;
+  uint32_t             _current_frame = 0;
+  // guards the handle lists
+  std::mutex           _mutex;
+};
+
+}  // namespace gfx
+
+#endif
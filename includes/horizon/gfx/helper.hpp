@@ -2,9 +2,11 @@
 #define GFX_HELPER_HPP
 
 #include "context.hpp"
+#include "horizon/gfx/staging_ring.hpp"
 #include "horizon/gfx/types.hpp"
 
 #include <filesystem>
+#include <functional>
 
 #ifdef HORIZON_INCLUDE_IMGUI
 #define GLFW_INCLUDE_NONE
@@ -26,6 +28,20 @@ begin_single_use_commandbuffer(context_t &context,
 void end_single_use_command_buffer(context_t &context,
                                    handle_commandbuffer_t handle);
 
+// splits [0, count) into one contiguous range per worker and records each
+// range on the context's thread pool into a secondary command buffer taken
+// from that worker's own ring. record gets the command buffer and the range,
+// it has to bind its own pipeline and dynamic state since secondaries inherit
+// none. the command buffers come back in range order, ready for
+// cmd_execute_commands inside a cmd_begin_rendering with
+// VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT. blocks until every
+// range is recorded, so it must not be called from a thread pool worker
+std::vector<handle_commandbuffer_t> record_secondary_commandbuffers(
+    context_t &context, const rendering_inheritance_t &rendering_inheritance,
+    size_t count,
+    const std::function<void(handle_commandbuffer_t, size_t, size_t)> &record,
+    uint32_t worker_count = 0);
+
 VkImageAspectFlags image_aspect_from_format(VkFormat vk_format);
 
 void cmd_transition_image_layout(context_t &context,
@@ -41,15 +57,17 @@ void cmd_generate_image_mip_maps(context_t &context,
                                  VkImageLayout vk_image_layout_old,
                                  VkImageLayout vk_image_layout_new,
                                  VkFilter vk_filter);
-handle_image_t load_image_from_path_instant(
-    context_t &context, handle_command_pool_t handle_command_pool,
-    const std::filesystem::path &path, VkFormat vk_format);
-// TODO: create a image loader or something
-// handle_image_t load_image_from_path(context_t& context, const
-// std::filesystem::path& path, VkFormat vk_format);
+// records the upload into the staging ring without waiting, the image is
+// ready for everything submitted after the ring's next flush
+handle_image_t load_image_from_path(context_t &context,
+                                    staging_ring_t &staging_ring,
+                                    const std::filesystem::path &path,
+                                    VkFormat vk_format);
 
+// creates the buffer and records the upload into the staging ring, the data
+// is visible to everything submitted after the ring's next flush
 handle_buffer_t create_buffer_staged(context_t &context,
-                                     handle_command_pool_t handle_command_pool,
+                                     staging_ring_t &staging_ring,
                                      config_buffer_t config, const void *data,
                                      size_t size);
 
@@ -66,6 +84,10 @@ void imgui_endframe(context_t &context,
 gfx::handle_shader_t create_slang_shader(context_t &context,
                                          const std::filesystem::path &file_path,
                                          shader_type_t type);
+std::vector<gfx::handle_shader_t>
+create_slang_shader_program(context_t &context,
+                            const std::filesystem::path &file_path,
+                            const std::vector<shader_type_t> &types);
 
 } // namespace helper
 
@@ -0,0 +1,166 @@
+#ifndef GFX_RESIDENCY_MANAGER_HPP
+#define GFX_RESIDENCY_MANAGER_HPP
+
+#include "horizon/core/slot_map.hpp"
+#include "horizon/core/thread_pool.hpp"
+#include "horizon/gfx/context.hpp"
+#include "horizon/gfx/staging_ring.hpp"
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "horizon/gfx/types.hpp"
+
+namespace gfx {
+
+define_handle(handle_resident_texture_t);
+
+struct config_residency_manager_t {
+  // usage of every heap is kept under this fraction of its budget
+  float               budget_fraction  = 0.8f;
+  // degraded textures are restored while usage stays under this fraction,
+  // the gap to budget_fraction keeps textures from flipping every frame
+  float               restore_fraction = 0.7f;
+  // mips are dropped until the largest side would go below this
+  uint32_t            min_resident_extent = 64;
+  // textures unused for this many updates may be evicted completely, more
+  // recently used ones only lose mips
+  uint32_t            eviction_idle_frames = 120;
+  // caps the loads a single update starts
+  uint32_t            max_restores_per_update = 4;
+  // what image_view returns for an evicted texture
+  handle_image_view_t fallback_image_view = core::null_handle;
+};
+
+struct config_resident_texture_t {
+  // the full quality image, the manager adds the transfer usages it needs
+  config_image_t config_image;
+  // lower priorities are degraded first
+  uint32_t       priority = 0;
+  // returns the base mip of the full quality image, called on creation and
+  // on every restore, so it has to stay callable for the texture's lifetime.
+  // restores call it on a worker of the context's thread pool
+  std::function<std::vector<uint8_t>()> load;
+};
+
+namespace internal {
+
+struct resident_texture_t {
+  handle_image_t      handle_image      = core::null_handle;
+  handle_image_view_t handle_image_view = core::null_handle;
+  uint32_t            priority;
+  uint64_t            last_used_frame;
+  // top mips missing from the current image, mips when evicted
+  uint32_t            dropped_mips = 0;
+  uint32_t            mips;
+  uint32_t            vk_memory_heap;
+  VkDeviceSize        vk_size;
+  VkDeviceSize        vk_full_size;
+  // data of a restore still loading on the thread pool
+  core::ticket_t<std::vector<uint8_t>> load_ticket;
+};
+
+}  // namespace internal
+
+/*
+ * keeps textures within the memory budget the driver reports for each heap
+ * every update compares heap usage against the budget. over budget, the
+ * least recently used textures of the lowest priority lose their top mips,
+ * copied down on the gpu into a smaller image, and textures idle for long
+ * enough are evicted outright. with room to spare, textures touched since
+ * the last update are loaded again on the context's thread pool and a later
+ * update uploads them at full quality through the staging ring. the gpu
+ * work goes into the ring, so it has to be a graphics ring flushed before
+ * the frame that uses the new views is submitted
+ * image views change whenever a texture is degraded or restored, update
+ * returns the textures whose image_view has to be written again. the old
+ * images are destroyed deferred, so frames in flight keep sampling them
+ * not thread safe
+ */
+class residency_manager_t {
+ public:
+  residency_manager_t(context_t &context, staging_ring_t &staging_ring,
+                      const config_residency_manager_t &config = {});
+  ~residency_manager_t();
+
+  residency_manager_t(const residency_manager_t &)            = delete;
+  residency_manager_t &operator=(const residency_manager_t &) = delete;
+
+  handle_resident_texture_t create_texture(
+      const config_resident_texture_t &config);
+  void destroy_texture(handle_resident_texture_t handle);
+
+  // marks the texture as used by the frame being recorded
+  void                touch(handle_resident_texture_t handle);
+  void                set_priority(handle_resident_texture_t handle,
+                                   uint32_t                  priority);
+  // the resident image's view, the fallback view while evicted
+  handle_image_view_t image_view(handle_resident_texture_t handle);
+  // 0 at full quality
+  uint32_t            dropped_mips(handle_resident_texture_t handle);
+  bool                is_evicted(handle_resident_texture_t handle);
+
+  // checks the budgets and degrades or restores textures, once per frame
+  // before recording. the result holds until the next update
+  const std::vector<handle_resident_texture_t> &update();
+
+ private:
+  // an image replaced during an update, destroyed once the ring batch that
+  // may still read it was flushed
+  struct retired_image_t {
+    uint64_t            batch;
+    handle_image_t      handle_image;
+    handle_image_view_t handle_image_view;
+    uint32_t            vk_memory_heap;
+    VkDeviceSize        vk_size;
+  };
+  // memory of a destroyed image, it still counts towards the budget until
+  // its retirement ticket is retired
+  struct pending_release_t {
+    uint64_t     ticket;
+    uint32_t     vk_memory_heap;
+    VkDeviceSize vk_size;
+  };
+
+  // frees at least vk_excess bytes of the heap if it can
+  void         degrade(uint32_t vk_memory_heap, VkDeviceSize vk_excess);
+  // restores textures of the heap while they fit into vk_room bytes
+  void         restore(uint32_t vk_memory_heap, VkDeviceSize vk_room);
+  // replaces the image with one missing its top dropped_mips mips, returns
+  // the bytes saved
+  VkDeviceSize drop_mips(handle_resident_texture_t handle,
+                         uint32_t                  dropped_mips);
+  // starts the load function on the thread pool
+  void         load(handle_resident_texture_t handle);
+  // uploads the restores whose load function returned
+  void         finish_loads();
+  // recreates the image at full quality from the loaded base mip
+  void         upload(handle_resident_texture_t   handle,
+                      const std::vector<uint8_t> &data);
+  void         replace_image(handle_resident_texture_t handle,
+                             handle_image_t            handle_image,
+                             uint32_t                  dropped_mips);
+  void         retire_image(internal::resident_texture_t &texture);
+  uint32_t     max_dropped_mips(handle_resident_texture_t handle);
+
+  context_t                 &_context;
+  staging_ring_t            &_staging_ring;
+  config_residency_manager_t _config;
+  uint64_t                   _frame = 0;
+
+  std::vector<retired_image_t>           _retired_images;
+  std::vector<pending_release_t>         _pending_releases;
+  std::vector<handle_resident_texture_t> _changed;
+
+  core::slot_map_t<handle_resident_texture_t, internal::resident_texture_t,
+                   config_resident_texture_t>
+      _textures;
+};
+
+}  // namespace gfx
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef GFX_SHADER_COMPILER_HPP
+#define GFX_SHADER_COMPILER_HPP
+
+#include "horizon/gfx/context.hpp"
+
+#include <slang-com-ptr.h>
+#include <slang.h>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace gfx {
+
+struct compiled_shader_t {
+  std::vector<uint32_t> spirv;
+  shader_reflection_t   reflection;
+};
+
+/*
+ * compiles slang shaders to spirv through a content addressed cache
+ * a shader is first keyed by its source, entry point, stage and the compiler
+ * options, that key is then extended with the contents of every module the
+ * shader imported the last time it was compiled, so editing an imported
+ * module invalidates the entry without the source itself changing
+ * results are kept in memory and, once a cache directory is set, on disk
+ * misses are compiled through a long lived slang session per thread, so
+ * modules imported by many shaders are only parsed and checked once per thread
+ * and compiles on different threads run in parallel
+ */
+class shader_compiler_t {
+ public:
+  shader_compiler_t();
+
+  // creates the directory if needed, entries written by another version of
+  // the compiler options are simply never hit
+  void set_cache_directory(const std::filesystem::path &path);
+
+  compiled_shader_t compile(const config_shader_t &config);
+  // returns one compiled shader per entry in config.types, in order
+  std::vector<compiled_shader_t> compile_program(
+      const config_shader_program_t &config);
+  shader_cache_stats_t stats();
+
+ private:
+  std::optional<compiled_shader_t> lookup(uint64_t source_key);
+
+  struct slang_state_t {
+    Slang::ComPtr<slang::IGlobalSession> global_session;
+    Slang::ComPtr<slang::ISession>       session;
+    // content hash of every file the session has loaded a module from
+    std::unordered_map<std::string, uint64_t> session_files;
+    // names of the modules the session holds, it never evicts them
+    std::unordered_set<std::string> session_modules;
+  };
+
+  slang_state_t &get_thread_slang_state();
+  void           create_session(slang_state_t &state);
+  std::vector<compiled_shader_t> compile_slang(
+      const std::string &name, const std::string &code,
+      const std::string &path, const std::vector<shader_type_t> &types,
+      std::vector<std::string>         &dependencies);
+
+  uint64_t source_key(const std::string &name, const std::string &code,
+                      shader_type_t type);
+  uint64_t content_key(uint64_t                        source_key,
+                       const std::vector<std::string> &dependencies);
+  // content hash of the file, only read again once its write time or size
+  // changed. nullopt when the file is missing
+  std::optional<uint64_t> file_hash(const std::string &path);
+
+  std::filesystem::path dependencies_path(uint64_t source_key);
+  std::filesystem::path compiled_shader_path(uint64_t content_key);
+  std::optional<std::vector<std::string>> read_dependencies(
+      uint64_t source_key);
+  void write_dependencies(uint64_t                        source_key,
+                          const std::vector<std::string> &dependencies);
+  std::optional<compiled_shader_t> read_compiled_shader(uint64_t content_key);
+  void write_compiled_shader(uint64_t                 content_key,
+                             const compiled_shader_t &compiled_shader);
+
+  // guards the cache tables, the stats and the cache directory
+  std::mutex            _mutex;
+  std::filesystem::path _cache_directory;
+  std::unordered_map<uint64_t, std::vector<std::string>> _dependencies;
+  std::unordered_map<uint64_t, compiled_shader_t>        _compiled_shaders;
+  shader_cache_stats_t                                   _stats;
+
+  struct file_hash_t {
+    std::filesystem::file_time_type write_time;
+    uintmax_t                       size;
+    uint64_t                        hash;
+  };
+  std::mutex                                   _file_hashes_mutex;
+  std::unordered_map<std::string, file_hash_t> _file_hashes;
+
+  // neither global sessions nor sessions are thread safe, so every compiling
+  // thread owns one of each and compiles never contend
+  std::mutex _slang_states_mutex;
+  std::unordered_map<std::thread::id, std::unique_ptr<slang_state_t>>
+      _slang_states;
+};
+
+}  // namespace gfx
+
+#endif
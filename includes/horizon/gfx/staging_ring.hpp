@@ -0,0 +1,108 @@
+#ifndef GFX_STAGING_RING_HPP
+#define GFX_STAGING_RING_HPP
+
+#include "horizon/gfx/context.hpp"
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "horizon/gfx/types.hpp"
+
+namespace gfx {
+
+struct staging_allocation_t {
+  handle_buffer_t handle_buffer;
+  VkDeviceSize    vk_offset;
+  void           *p_data;
+};
+
+/*
+ * persistently mapped upload buffer shared by many small uploads
+ * every upload takes the next slice of the ring and records its copy into
+ * one pending command buffer, flush submits that command buffer and the
+ * slices it used are handed back once its serial completed. uploads larger
+ * than the whole ring get a dedicated staging buffer instead
+ * copies are made visible to everything submitted to the ring's queue after
+ * the flush, other queues have to wait on timeline() at the flush's batch
+ * not thread safe, use one ring per uploading thread
+ */
+class staging_ring_t {
+ public:
+  // every slice starts at a multiple of this, on top of what stage asks for
+  static constexpr VkDeviceSize min_alignment = 16;
+
+  staging_ring_t(context_t &context, VkDeviceSize vk_size = 64 * 1024 * 1024,
+                 queue_type_t queue_type = queue_type_t::e_graphics);
+  ~staging_ring_t();
+
+  staging_ring_t(const staging_ring_t &)            = delete;
+  staging_ring_t &operator=(const staging_ring_t &) = delete;
+
+  void upload_buffer(handle_buffer_t handle_buffer, const void *data,
+                     VkDeviceSize vk_size, VkDeviceSize vk_dst_offset = 0);
+  // fills the base mip of the first layer, the other mips are generated from
+  // it, the image ends up in vk_final_image_layout. needs a graphics ring.
+  // ending in shader read only layout opts the image in to defragmentation
+  // at the flush
+  void upload_image(handle_image_t handle_image, const void *data,
+                    VkDeviceSize  vk_size,
+                    VkImageLayout vk_final_image_layout =
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  // submits every copy recorded since the last flush and returns the serial
+  // of that submission, or of the previous one if nothing was recorded
+  uint64_t flush();
+
+  // reserves vk_size bytes at a multiple of vk_alignment that stay untouched
+  // until the flush recording their copy completed, may flush on its own
+  // when the ring is full
+  staging_allocation_t   stage(VkDeviceSize vk_size,
+                               VkDeviceSize vk_alignment = min_alignment);
+  // stage for the base mip of the image, aligned for a buffer to image copy
+  // of its format
+  staging_allocation_t   stage_image(handle_image_t handle_image,
+                                     VkDeviceSize   vk_size);
+  // the pending command buffer on the ring's queue, begun on first use
+  handle_commandbuffer_t commandbuffer();
+  // every flush signals this timeline with its batch number, starting at 1
+  handle_semaphore_t     timeline();
+  // batch number the next flush will signal
+  uint64_t               pending_batch();
+
+ private:
+  void retire();
+
+  struct region_t {
+    // ring position the flushed slices end at
+    uint64_t end;
+    uint64_t serial;
+  };
+
+  context_t         &_context;
+  VkDeviceSize       _vk_size;
+  queue_type_t       _queue_type;
+  handle_buffer_t    _handle_buffer;
+  uint8_t           *_p_data;
+  handle_semaphore_t _handle_timeline;
+  uint64_t           _batch = 0;
+  // positions only ever grow, the buffer offset is the position modulo the
+  // size, everything in [_tail, _head) is pending or in flight
+  uint64_t             _head = 0;
+  uint64_t             _tail = 0;
+  std::deque<region_t> _regions;
+  uint64_t             _serial = 0;
+
+  handle_commandbuffer_t       _handle_commandbuffer = core::null_handle;
+  // staging buffers of oversized uploads recorded since the last flush
+  std::vector<handle_buffer_t> _dedicated_buffers;
+  // images the pending uploads leave in shader read only layout, opted in
+  // to defragmentation once submitted
+  std::vector<handle_image_t>  _movable_images;
+};
+
+}  // namespace gfx
+
+#endif
@@ -20,6 +20,7 @@ define_handle(handle_semaphore_t);
 define_handle(handle_command_pool_t);
 define_handle(handle_commandbuffer_t);
 define_handle(handle_timer_t);
+define_handle(handle_memory_pool_t);
 
 } // namespace gfx
 
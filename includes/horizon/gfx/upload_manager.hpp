@@ -0,0 +1,79 @@
+#ifndef GFX_UPLOAD_MANAGER_HPP
+#define GFX_UPLOAD_MANAGER_HPP
+
+#include "horizon/gfx/context.hpp"
+#include "horizon/gfx/staging_ring.hpp"
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+#include "horizon/gfx/types.hpp"
+
+namespace gfx {
+
+// names the transfer batch an upload went out with
+struct upload_token_t {
+  uint64_t batch = 0;
+};
+
+/*
+ * streams buffer and image uploads through the transfer queue without ever
+ * blocking the caller
+ * uploads are staged and recorded right away and go out with the next flush,
+ * each copy ends by releasing its resource to the graphics queue. before the
+ * first use the renderer records the matching acquire with acquire() and
+ * adds the returned wait to that submission. images get their mips
+ * generated there, blits need a graphics queue
+ * uploads and flush may run on a streaming thread while another thread calls
+ * is_ready and acquire
+ */
+class upload_manager_t {
+ public:
+  upload_manager_t(context_t   &context,
+                   VkDeviceSize vk_staging_size = 64 * 1024 * 1024);
+
+  upload_token_t upload_buffer(handle_buffer_t handle_buffer, const void *data,
+                               VkDeviceSize vk_size,
+                               VkDeviceSize vk_dst_offset = 0);
+  // fills the base mip of the first layer, the image reaches
+  // vk_final_image_layout once acquired
+  upload_token_t upload_image(handle_image_t handle_image, const void *data,
+                              VkDeviceSize  vk_size,
+                              VkImageLayout vk_final_image_layout =
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  // submits everything uploaded since the last flush to the transfer queue
+  void flush();
+
+  // the copies of the token's batch finished on the transfer queue
+  bool is_ready(upload_token_t token);
+  // records the graphics side of every upload whose copies finished, and of
+  // every flushed upload up to token, into handle_commandbuffer outside of
+  // any rendering. the returned wait has to be part of the submission of
+  // handle_commandbuffer, it only stalls the gpu for batches still in flight
+  std::optional<semaphore_submit_info_t> acquire(
+      handle_commandbuffer_t handle_commandbuffer, upload_token_t token = {});
+
+ private:
+  struct pending_acquire_t {
+    uint64_t                batch;
+    handle_buffer_t         handle_buffer = core::null_handle;
+    buffer_resource_range_t buffer_resource_range;
+    handle_image_t          handle_image = core::null_handle;
+    VkImageLayout           vk_final_image_layout;
+  };
+
+  context_t &_context;
+  // guards everything below
+  std::mutex                    _mutex;
+  staging_ring_t                _staging_ring;
+  std::deque<pending_acquire_t> _pending_acquires;
+};
+
+}  // namespace gfx
+
+#endif
@@ -0,0 +1,64 @@
+#include "horizon/core/thread_pool.hpp"
+
+#include <algorithm>
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+
+namespace core {
+
+// the pool whose worker the calling thread is, if any
+static thread_local const thread_pool_t *current_thread_pool = nullptr;
+
+thread_pool_t::thread_pool_t(uint32_t thread_count) {
+  horizon_profile();
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  for (uint32_t i = 0; i < thread_count; i++)
+    _threads.emplace_back(&thread_pool_t::worker, this);
+  horizon_trace("created thread pool with {} threads", thread_count);
+}
+
+thread_pool_t::~thread_pool_t() {
+  horizon_profile();
+  {
+    std::scoped_lock lock{_mutex};
+    _stop = true;
+  }
+  _condition.notify_all();
+  for (auto &thread : _threads)
+    thread.join();
+}
+
+void thread_pool_t::push(std::function<void()> job) {
+  horizon_profile();
+  {
+    std::scoped_lock lock{_mutex};
+    check(!_stop, "submitted to a stopped thread pool");
+    _jobs.push_back(std::move(job));
+  }
+  _condition.notify_one();
+}
+
+bool thread_pool_t::is_worker_thread() const {
+  return current_thread_pool == this;
+}
+
+void thread_pool_t::worker() {
+  horizon_profile();
+  current_thread_pool = this;
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock lock{_mutex};
+      _condition.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+      if (_jobs.empty())
+        return;
+      job = std::move(_jobs.front());
+      _jobs.pop_front();
+    }
+    job();
+  }
+}
+
+} // namespace core
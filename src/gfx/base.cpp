@@ -22,11 +22,12 @@ base_t::base_t(core::ref<core::window_t> window, core::ref<context_t> context)
   horizon_profile();
   _swapchain    = _context->create_swapchain(*_window);
   _command_pool = _context->create_command_pool({});
+  _staging_ring = core::make_ref<staging_ring_t>(*_context);
+  _frame_allocator =
+      core::make_ref<frame_allocator_t>(*_context, MAX_FRAMES_IN_FLIGHT);
+  _frame_descriptor_allocator = core::make_ref<frame_descriptor_allocator_t>(
+      *_context, MAX_FRAMES_IN_FLIGHT);
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    _commandbuffers[i] = _context->allocate_commandbuffer(
-        {.handle_command_pool = _command_pool,
-         .debug_name          = "commandbuffer_" + std::to_string(i)});
-    _in_flight_fences[i]           = _context->create_fence({});
     _image_available_semaphores[i] = _context->create_semaphore({});
     _render_finished_semaphores[i] = _context->create_semaphore({});
   }
@@ -55,19 +56,17 @@ base_t::base_t(core::ref<core::window_t> window, core::ref<context_t> context)
 base_t::~base_t() {
   horizon_profile();
   _context->wait_idle();
-  for (auto &[handle, buffer] : _buffers) {
+  for (auto [handle, buffer] : _buffers) {
     for (auto handle_buffer : buffer.handle_buffers) {
       _context->destroy_buffer(handle_buffer);
     }
   }
-  for (auto &[handle, descriptor_set] : _descriptor_sets) {
+  for (auto [handle, descriptor_set] : _descriptor_sets) {
     for (auto handle_descriptor_set : descriptor_set.handle_descriptor_sets) {
       _context->free_descriptor_set(handle_descriptor_set);
     }
   }
   for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    _context->free_commandbuffer(_commandbuffers[i]);
-    _context->destroy_fence(_in_flight_fences[i]);
     _context->destroy_semaphore(_image_available_semaphores[i]);
     _context->destroy_semaphore(_render_finished_semaphores[i]);
   }
@@ -83,13 +82,22 @@ void base_t::begin() {
     resize_swapchain();
     _resize = false;
   }
-  handle_commandbuffer_t cbuf            = _commandbuffers[_current_frame];
-  handle_fence_t         in_flight_fence = _in_flight_fences[_current_frame];
-  handle_semaphore_t     image_available_semaphore =
+  handle_semaphore_t image_available_semaphore =
       _image_available_semaphores[_current_frame];
-  handle_semaphore_t render_finished_semaphore =
-      _render_finished_semaphores[_current_frame];
-  _context->wait_fence(in_flight_fence);
+  // the frame slot is free once its last submission left the timeline
+  _context->wait_serial(_frame_serials[_current_frame]);
+  _frame_allocator->begin_frame(_current_frame);
+  _frame_descriptor_allocator->begin_frame(_current_frame);
+  _context->collect_garbage();
+  _defragmentation_step = {};
+  if (_context->is_defragmenting()) {
+    // uploads recorded since the last frame name the resources as they are
+    // before the step moves them
+    _staging_ring->flush();
+    _defragmentation_step = _context->defragment_step();
+    rebind_moved_bindless_images();
+  }
+  flush_bindless();
   auto swapchain_image = _context->get_swapchain_next_image_index(
       _swapchain, image_available_semaphore, core::null_handle);
   if (!swapchain_image) {
@@ -98,23 +106,31 @@ void base_t::begin() {
   }
   check(swapchain_image, "Failed to get next image");
   _next_image = *swapchain_image;
-  _context->reset_fence(in_flight_fence);
+  // taken from the context's ring only once the frame is sure to be
+  // submitted, the ring recycles it after the frame completed
+  handle_commandbuffer_t cbuf = _context->acquire_commandbuffer();
+  _commandbuffers[_current_frame] = cbuf;
   _context->begin_commandbuffer(cbuf);
 }
 
 void base_t::end() {
   horizon_profile();
-  handle_commandbuffer_t cbuf            = _commandbuffers[_current_frame];
-  handle_fence_t         in_flight_fence = _in_flight_fences[_current_frame];
+  handle_commandbuffer_t cbuf = _commandbuffers[_current_frame];
   handle_semaphore_t     image_available_semaphore =
       _image_available_semaphores[_current_frame];
   handle_semaphore_t render_finished_semaphore =
       _render_finished_semaphores[_current_frame];
   _context->end_commandbuffer(cbuf);
-  _context->submit_commandbuffer(
-      cbuf, {image_available_semaphore},
-      {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT},
-      {render_finished_semaphore}, in_flight_fence);
+  _staging_ring->flush();
+  // slots set while recording are written before the frame reads them
+  flush_bindless();
+  submit_info_t submit_info{.handle_commandbuffers = {cbuf}};
+  submit_info.wait_semaphores.push_back(
+      {.handle_semaphore   = image_available_semaphore,
+       .vk_pipeline_stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT});
+  submit_info.signal_semaphores.push_back(
+      {.handle_semaphore = render_finished_semaphore});
+  _frame_serials[_current_frame] = _context->submit(submit_info);
   if (!_context->present_swapchain(_swapchain, _next_image,
                                    {render_finished_semaphore})) {
     _resize = true;
@@ -125,10 +141,7 @@ void base_t::end() {
 
 void base_t::resize_swapchain() {
   horizon_profile();
-  auto [width, height] = _window->dimensions();
-  _context->wait_idle();
-  _context->destroy_swapchain(_swapchain);
-  _swapchain = _context->create_swapchain(*_window);
+  _swapchain = _context->recreate_swapchain(_swapchain, *_window);
 }
 
 void base_t::begin_swapchain_renderpass() {
@@ -354,21 +367,21 @@ rendering_attachment_t base_t::swapchain_rendering_attachment(
 handle_bindless_image_t base_t::new_bindless_image() {
   horizon_profile();
   handle_bindless_image_t handle = _image_counter;
-  _image_counter++;
+  _image_counter.val++;
   return handle;
 }
 
 handle_bindless_sampler_t base_t::new_bindless_sampler() {
   horizon_profile();
   handle_bindless_sampler_t handle = _sampler_counter;
-  _sampler_counter++;
+  _sampler_counter.val++;
   return handle;
 }
 
 handle_bindless_storage_image_t base_t::new_bindless_storage_image() {
   horizon_profile();
   handle_bindless_storage_image_t handle = _storage_image_counter;
-  _storage_image_counter++;
+  _storage_image_counter.val++;
   return handle;
 }
 
@@ -376,32 +389,60 @@ void base_t::set_bindless_image(handle_bindless_image_t handle,
                                 handle_image_view_t     image_view,
                                 VkImageLayout           vk_image_layout) {
   horizon_profile();
-  _context->update_descriptor_set(_bindless_descriptor_set)
-      .push_image_write(
-          0,
-          {.handle_image_view = image_view, .vk_image_layout = vk_image_layout},
-          static_cast<uint32_t>(handle))
-      .commit();
+  // remembered so the slot can be rewritten when defragmentation moves it
+  if (_bindless_images.size() <= static_cast<uint32_t>(handle))
+    _bindless_images.resize(static_cast<uint32_t>(handle) + 1,
+                            {core::null_handle, VK_IMAGE_LAYOUT_UNDEFINED});
+  _bindless_images[static_cast<uint32_t>(handle)] = {image_view,
+                                                     vk_image_layout};
+  _pending_bindless_writes[{0, static_cast<uint32_t>(handle)}] = {
+      .handle_image_view = image_view, .vk_image_layout = vk_image_layout};
+}
+
+void base_t::rebind_moved_bindless_images() {
+  horizon_profile();
+  if (_defragmentation_step.moved_image_views.empty()) return;
+  std::set<handle_image_view_t> moved_image_views{
+      _defragmentation_step.moved_image_views.begin(),
+      _defragmentation_step.moved_image_views.end()};
+  for (uint32_t i = 0; i < _bindless_images.size(); i++) {
+    auto [image_view, vk_image_layout] = _bindless_images[i];
+    if (!moved_image_views.contains(image_view)) continue;
+    _pending_bindless_writes[{0, i}] = {.handle_image_view = image_view,
+                                        .vk_image_layout   = vk_image_layout};
+  }
+}
+
+const defragmentation_step_t &base_t::last_defragmentation_step() const {
+  return _defragmentation_step;
 }
 
 void base_t::set_bindless_sampler(handle_bindless_sampler_t handle,
                                   handle_sampler_t          sampler) {
   horizon_profile();
-  _context->update_descriptor_set(_bindless_descriptor_set)
-      .push_image_write(1, {.handle_sampler = sampler},
-                        static_cast<uint32_t>(handle))
-      .commit();
+  _pending_bindless_writes[{1, static_cast<uint32_t>(handle)}] = {
+      .handle_sampler = sampler};
 }
 
 void base_t::set_bindless_storage_image(handle_bindless_storage_image_t handle,
                                         handle_image_view_t image_view) {
   horizon_profile();
-  _context->update_descriptor_set(_bindless_descriptor_set)
-      .push_image_write(2,
-                        {.handle_image_view = image_view,
-                         .vk_image_layout   = VK_IMAGE_LAYOUT_GENERAL},
-                        static_cast<uint32_t>(handle))
-      .commit();
+  _pending_bindless_writes[{2, static_cast<uint32_t>(handle)}] = {
+      .handle_image_view = image_view,
+      .vk_image_layout   = VK_IMAGE_LAYOUT_GENERAL};
+}
+
+void base_t::flush_bindless() {
+  horizon_profile();
+  if (_pending_bindless_writes.empty()) return;
+  update_descriptor_set_t update_descriptor_set =
+      _context->update_descriptor_set(_bindless_descriptor_set);
+  for (const auto &[key, info] : _pending_bindless_writes) {
+    auto [binding, array_element] = key;
+    update_descriptor_set.push_image_write(binding, info, array_element);
+  }
+  update_descriptor_set.commit();
+  _pending_bindless_writes.clear();
 }
 
 bool is_same_resource(const resource_t &a, const resource_t &b,
@@ -410,10 +451,11 @@ bool is_same_resource(const resource_t &a, const resource_t &b,
   if (a.type == resource_type_t::e_buffer) {
     if (a.as.buffer.buffer != b.as.buffer.buffer) return false;
     // only need size of a since a == b
-    internal::buffer_t buffer     = context->get_buffer(a.as.buffer.buffer);
-    uint64_t           total_size = buffer.config.vk_size;
-    uint64_t           a_start    = a.as.buffer.buffer_resource_range.offset;
-    uint64_t           a_size     = a.as.buffer.buffer_resource_range.size;
+    const config_buffer_t &config_buffer =
+        context->get_buffer_config(a.as.buffer.buffer);
+    uint64_t total_size = config_buffer.vk_size;
+    uint64_t a_start    = a.as.buffer.buffer_resource_range.offset;
+    uint64_t a_size     = a.as.buffer.buffer_resource_range.size;
     uint64_t a_end = (a_size == VK_WHOLE_SIZE) ? total_size : a_start + a_size;
     uint64_t b_start = b.as.buffer.buffer_resource_range.offset;
     uint64_t b_size  = b.as.buffer.buffer_resource_range.size;
@@ -422,9 +464,10 @@ bool is_same_resource(const resource_t &a, const resource_t &b,
   }
   if (a.type == resource_type_t::e_image) {
     if (a.as.image.image != b.as.image.image) return false;
-    internal::image_t image              = context->get_image(a.as.image.image);
-    uint32_t          total_mip_levels   = image.config.vk_mips;
-    uint32_t          total_array_layers = image.config.vk_array_layers;
+    const config_image_t &config_image =
+        context->get_image_config(a.as.image.image);
+    uint32_t total_mip_levels   = config_image.vk_mips;
+    uint32_t total_array_layers = config_image.vk_array_layers;
     uint32_t a_mip_start = a.as.image.image_resource_range.base_mip_level;
     uint32_t a_mip_count = a.as.image.image_resource_range.level_count;
     uint32_t a_mip_end   = (a_mip_count == VK_REMAINING_MIP_LEVELS)
@@ -642,9 +685,11 @@ void base_t::render_rendergraph(const rendergraph_t   &rendergraph,
 void base_t::cmd_bind_descriptor_sets(
     handle_commandbuffer_t handle_commandbuffer,
     handle_pipeline_t handle_pipeline, uint32_t vk_first_set,
-    const std::vector<handle_descriptor_set_t> &handle_descriptor_sets) {
+    const std::vector<handle_descriptor_set_t> &handle_descriptor_sets,
+    const std::vector<uint32_t>                &vk_dynamic_offsets) {
   _context->cmd_bind_descriptor_sets(handle_commandbuffer, handle_pipeline,
-                                     vk_first_set, handle_descriptor_sets);
+                                     vk_first_set, handle_descriptor_sets,
+                                     vk_dynamic_offsets);
 }
 
 void base_t::cmd_bind_graphics_pipeline(
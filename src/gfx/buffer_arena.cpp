@@ -0,0 +1,148 @@
+#include "horizon/gfx/buffer_arena.hpp"
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+
+#include <algorithm>
+#include <format>
+
+namespace gfx {
+
+buffer_arena_t::buffer_arena_t(context_t                   &context,
+                               const config_buffer_arena_t &config)
+    : _context(context), _config(config) {
+  horizon_profile();
+  _vk_alignment = _config.vk_alignment;
+  if (_vk_alignment == 0)
+    _vk_alignment = std::max<VkDeviceSize>(
+        _context.physical_device()
+            .properties.limits.minStorageBufferOffsetAlignment,
+        16);
+}
+
+buffer_arena_t::~buffer_arena_t() {
+  horizon_profile();
+  for (block_t &block : _blocks) {
+    // live slices are released along with their block
+    vmaClearVirtualBlock(block.vma_virtual_block);
+    vmaDestroyVirtualBlock(block.vma_virtual_block);
+    _context.destroy_buffer(block.handle_buffer);
+  }
+}
+
+handle_buffer_slice_t buffer_arena_t::allocate(VkDeviceSize vk_size,
+                                               VkDeviceSize vk_alignment) {
+  horizon_profile();
+  check(vk_size != 0, "buffer slices cannot be empty");
+  VmaVirtualAllocationCreateInfo vma_virtual_allocation_create_info{};
+  vma_virtual_allocation_create_info.size = vk_size;
+  vma_virtual_allocation_create_info.alignment =
+      vk_alignment != 0 ? vk_alignment : _vk_alignment;
+
+  std::scoped_lock lock{_mutex};
+  retire();
+  internal::buffer_slice_allocation_t allocation{};
+  VkDeviceSize                        vk_offset = 0;
+  bool                                allocated = false;
+  for (uint32_t i = 0; i < _blocks.size() && !allocated; i++) {
+    allocated = vmaVirtualAllocate(_blocks[i].vma_virtual_block,
+                                   &vma_virtual_allocation_create_info,
+                                   &allocation.vma_virtual_allocation,
+                                   &vk_offset) == VK_SUCCESS;
+    allocation.block = i;
+  }
+  if (!allocated) {
+    allocation.block = create_block(std::max(vk_size, _config.vk_block_size));
+    VkResult vk_result = vmaVirtualAllocate(
+        _blocks[allocation.block].vma_virtual_block,
+        &vma_virtual_allocation_create_info,
+        &allocation.vma_virtual_allocation, &vk_offset);
+    check(vk_result == VK_SUCCESS, "Failed to allocate {} bytes from {}",
+          vk_size, _config.debug_name);
+  }
+
+  block_t       &block = _blocks[allocation.block];
+  buffer_slice_t slice{};
+  slice.handle_buffer     = block.handle_buffer;
+  slice.vk_offset         = vk_offset;
+  slice.vk_size           = vk_size;
+  slice.vk_device_address = block.vk_device_address + vk_offset;
+  slice.p_data            = block.p_data ? block.p_data + vk_offset : nullptr;
+  return utils::create_and_insert_new_handle<handle_buffer_slice_t>(
+      _slices, slice, allocation);
+}
+
+void buffer_arena_t::free(handle_buffer_slice_t handle) {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  internal::buffer_slice_allocation_t allocation =
+      utils::assert_and_get_config<internal::buffer_slice_allocation_t>(
+          handle, _slices);
+  _slices.erase(handle);
+  // same rule as deferred destruction, the range is reused once everything
+  // recorded before this call completed
+  _pending_frees.push_back({.ticket     = _context.retirement_ticket(),
+                            .allocation = allocation});
+  retire();
+}
+
+void buffer_arena_t::collect_garbage() {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  retire();
+}
+
+const buffer_slice_t &buffer_arena_t::get(handle_buffer_slice_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<buffer_slice_t>(handle, _slices);
+}
+
+void buffer_arena_t::retire() {
+  horizon_profile();
+  // tickets are taken under the lock, so the frees are in ticket order
+  auto itr = std::find_if(_pending_frees.begin(), _pending_frees.end(),
+                          [&](const pending_free_t &pending_free) {
+                            return !_context.is_retired(pending_free.ticket);
+                          });
+  for (auto pending_free = _pending_frees.begin(); pending_free != itr;
+       pending_free++)
+    vmaVirtualFree(_blocks[pending_free->allocation.block].vma_virtual_block,
+                   pending_free->allocation.vma_virtual_allocation);
+  _pending_frees.erase(_pending_frees.begin(), itr);
+}
+
+uint32_t buffer_arena_t::create_block(VkDeviceSize vk_size) {
+  horizon_profile();
+  config_buffer_t config_buffer{};
+  config_buffer.vk_size               = vk_size;
+  config_buffer.vk_buffer_usage_flags = _config.vk_buffer_usage_flags;
+  // dedicated memory is never moved by defragmentation, so the device
+  // addresses handed out stay valid
+  config_buffer.vma_allocation_create_flags =
+      _config.vma_allocation_create_flags |
+      VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+  config_buffer.vma_memory_usage = _config.vma_memory_usage;
+  config_buffer.debug_name =
+      std::format("{}:{}", _config.debug_name, _blocks.size());
+
+  block_t block{};
+  block.handle_buffer = _context.create_buffer(config_buffer);
+  block.vk_device_address =
+      _context.get_buffer_device_address(block.handle_buffer);
+  block.p_data = nullptr;
+  if (_config.vma_allocation_create_flags &
+      (VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+       VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT))
+    block.p_data = reinterpret_cast<uint8_t *>(
+        _context.map_buffer(block.handle_buffer));
+  VmaVirtualBlockCreateInfo vma_virtual_block_create_info{};
+  vma_virtual_block_create_info.size = vk_size;
+  VkResult vk_result = vmaCreateVirtualBlock(&vma_virtual_block_create_info,
+                                             &block.vma_virtual_block);
+  check(vk_result == VK_SUCCESS, "Failed to create virtual block");
+  horizon_trace("{} grew to {} blocks", _config.debug_name, _blocks.size() + 1);
+  _blocks.push_back(block);
+  return _blocks.size() - 1;
+}
+
+}  // namespace gfx
@@ -7,22 +7,25 @@
 #include "horizon/core/core.hpp"
 #include "horizon/core/logger.hpp"
 #include "horizon/core/window.hpp"
+#include "horizon/gfx/shader_compiler.hpp"
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
-#include <slang-com-helper.h>
-#include <slang-com-ptr.h>
-#include <slang-gfx.h>
-#include <slang.h>
 
 #define VMA_IMPLEMENTATION
 #include <vk_mem_alloc.h>
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <set>
 #include <sstream>
+#include <tuple>
 
 namespace utils {
 
@@ -38,17 +41,177 @@ static VkImageAspectFlags get_image_aspect(VkFormat vk_format) {
   return VK_IMAGE_ASPECT_COLOR_BIT;
 }
 
-inline void diagnose_if_needed(slang::IBlob *diagnostics_blob) {
-  if (diagnostics_blob) {
-    horizon_error("{}", reinterpret_cast<const char *>(
-                            diagnostics_blob->getBufferPointer()));
+// completed serials only ever move forward, whichever thread observed the
+// later one wins
+static void raise_serial(std::atomic<uint64_t> &completed_serial,
+                         uint64_t               serial) {
+  uint64_t current = completed_serial.load();
+  while (current < serial &&
+         !completed_serial.compare_exchange_weak(current, serial)) {
   }
 }
 
-inline void diagnostic_callback_slang(const char *msg, void *user_data) {
-  if (msg) {
-    horizon_error("{}", msg);
+// runtime sized arrays in reflected shaders get this many descriptors, the
+// same as the bindless set in base_t
+static constexpr uint32_t runtime_sized_descriptor_count = 1000;
+
+// command buffers per pool of a command buffer ring, a pool is only reset
+// once all of them completed
+static constexpr uint32_t commandbuffers_per_ring_slot = 16;
+
+// defragmentation moves buffers with a copy
+static constexpr VkBufferUsageFlags movable_buffer_usage_flags =
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+static VkBufferCreateInfo buffer_create_info(
+    const gfx::config_buffer_t &config) {
+  VkBufferCreateInfo vk_buffer_create_info{
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  vk_buffer_create_info.size = config.vk_size;
+  vk_buffer_create_info.usage =
+      config.vk_buffer_usage_flags | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+  if (config.movable) vk_buffer_create_info.usage |= movable_buffer_usage_flags;
+  return vk_buffer_create_info;
+}
+
+// config.vk_mips has to be resolved already
+static VkImageCreateInfo image_create_info(const gfx::config_image_t &config) {
+  VkImageCreateInfo vk_image_create_info{
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+  vk_image_create_info.imageType     = config.vk_type;
+  vk_image_create_info.extent        = {config.vk_width, config.vk_height,
+                                        config.vk_depth};
+  vk_image_create_info.mipLevels     = config.vk_mips;
+  vk_image_create_info.arrayLayers   = config.vk_array_layers;
+  vk_image_create_info.format        = config.vk_format;
+  vk_image_create_info.tiling        = config.vk_tiling;
+  vk_image_create_info.initialLayout = config.vk_initial_layout;
+  vk_image_create_info.usage         = config.vk_usage;
+  vk_image_create_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+  vk_image_create_info.samples       = config.vk_sample_count;
+  vk_image_create_info.flags         = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+  return vk_image_create_info;
+}
+
+// defragmentation only moves images the device never writes outside of
+// uploads, and of those only the ones set_image_movable opted in, since
+// they are known to sit in shader read only layout. attachments and storage
+// images would need their layouts tracked
+static bool is_image_movable(const gfx::config_image_t &config) {
+  constexpr VkImageUsageFlags vk_required_usage =
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+      VK_IMAGE_USAGE_SAMPLED_BIT;
+  constexpr VkImageUsageFlags vk_written_usage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+      VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+      VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+  return (config.vk_usage & vk_required_usage) == vk_required_usage &&
+         !(config.vk_usage & vk_written_usage) &&
+         config.vk_sample_count == VK_SAMPLE_COUNT_1_BIT &&
+         config.vk_tiling == VK_IMAGE_TILING_OPTIMAL;
+}
+
+// allocations carry their handle as user data, so a defragmentation move
+// can be traced back to the buffer or image it belongs to
+static void *allocation_user_data(core::handle_t handle) {
+  return reinterpret_cast<void *>(static_cast<uintptr_t>(handle));
+}
+
+static core::handle_t allocation_handle(void *p_user_data) {
+  return static_cast<core::handle_t>(reinterpret_cast<uintptr_t>(p_user_data));
+}
+
+static std::string json_escape(std::string_view text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      escaped += std::string{'\\', c};
+    else if (static_cast<unsigned char>(c) < 0x20)
+      escaped += std::format("\\u{:04x}", c);
+    else
+      escaped += c;
+  }
+  return escaped;
+}
+
+// returns the cache blob at path, or nothing if it is missing or was written
+// by a different device or driver. some drivers do not survive foreign data
+// so the header is checked here instead of relying on the driver
+static std::vector<uint8_t> read_pipeline_cache(
+    const std::filesystem::path      &path,
+    const VkPhysicalDeviceProperties &vk_physical_device_properties) {
+  horizon_profile();
+  if (path.empty() || !std::filesystem::exists(path)) return {};
+  std::ifstream file{path, std::ios::binary};
+  if (!file.is_open()) {
+    horizon_warn("Failed to open pipeline cache {}", path.string());
+    return {};
+  }
+  std::vector<uint8_t> data(std::filesystem::file_size(path));
+  file.read(reinterpret_cast<char *>(data.data()), data.size());
+
+  VkPipelineCacheHeaderVersionOne vk_header{};
+  if (data.size() < sizeof(vk_header)) {
+    horizon_warn("pipeline cache {} is truncated, ignoring", path.string());
+    return {};
   }
+  std::memcpy(&vk_header, data.data(), sizeof(vk_header));
+  if (vk_header.headerSize < sizeof(vk_header) ||
+      vk_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+      vk_header.vendorID != vk_physical_device_properties.vendorID ||
+      vk_header.deviceID != vk_physical_device_properties.deviceID ||
+      std::memcmp(vk_header.pipelineCacheUUID,
+                  vk_physical_device_properties.pipelineCacheUUID,
+                  VK_UUID_SIZE) != 0) {
+    horizon_warn("pipeline cache {} was written by another device or driver, "
+                 "ignoring",
+                 path.string());
+    return {};
+  }
+  return data;
+}
+
+// derived layouts are cached by a hash of their config, these tell a hash
+// collision apart from a hit
+static bool equal_derived_configs(const config_descriptor_set_layout_t &a,
+                                  const config_descriptor_set_layout_t &b) {
+  return a.use_bindless == b.use_bindless &&
+         std::equal(a.vk_descriptor_set_layout_bindings.begin(),
+                    a.vk_descriptor_set_layout_bindings.end(),
+                    b.vk_descriptor_set_layout_bindings.begin(),
+                    b.vk_descriptor_set_layout_bindings.end(),
+                    [](const VkDescriptorSetLayoutBinding &a,
+                       const VkDescriptorSetLayoutBinding &b) {
+                      return a.binding == b.binding &&
+                             a.descriptorType == b.descriptorType &&
+                             a.descriptorCount == b.descriptorCount &&
+                             a.stageFlags == b.stageFlags &&
+                             a.pImmutableSamplers == b.pImmutableSamplers;
+                    });
+}
+
+static bool equal_derived_configs(const config_pipeline_layout_t &a,
+                                  const config_pipeline_layout_t &b) {
+  return a.handle_descriptor_set_layouts == b.handle_descriptor_set_layouts &&
+         std::equal(a.vk_push_constant_ranges.begin(),
+                    a.vk_push_constant_ranges.end(),
+                    b.vk_push_constant_ranges.begin(),
+                    b.vk_push_constant_ranges.end(),
+                    [](const VkPushConstantRange &a,
+                       const VkPushConstantRange &b) {
+                      return a.stageFlags == b.stageFlags &&
+                             a.offset == b.offset && a.size == b.size;
+                    });
+}
+
+// sizes fall into four classes per power of two, so rounding a resource up to
+// the largest size in its class wastes at most a quarter of it
+static uint32_t memory_size_class(VkDeviceSize size) {
+  if (size <= 4) return static_cast<uint32_t>(size);
+  VkDeviceSize last = size - 1;
+  uint32_t     msb  = std::bit_width(last) - 1;
+  return (msb << 2) | static_cast<uint32_t>((last >> (msb - 2)) & 3);
 }
 
 }  // namespace utils
@@ -256,22 +419,30 @@ update_descriptor_set_t &update_descriptor_set_t::push_buffer_write(
   vk_buffer_info->offset = info.vk_offset;
   vk_buffer_info->range  = info.vk_range;
 
-  internal::descriptor_set_layout_t &descriptor_set_layout =
-      utils::assert_and_get_data<internal::descriptor_set_layout_t>(
-          descriptor_set.config.handle_descriptor_set_layout,
+  config_descriptor_set_layout_t &config_descriptor_set_layout =
+      utils::assert_and_get_config<config_descriptor_set_layout_t>(
+          descriptor_set.handle_descriptor_set_layout,
           context._descriptor_set_layouts);
   auto itr = std::find_if(
-      descriptor_set_layout.config.vk_descriptor_set_layout_bindings.begin(),
-      descriptor_set_layout.config.vk_descriptor_set_layout_bindings.end(),
+      config_descriptor_set_layout.vk_descriptor_set_layout_bindings.begin(),
+      config_descriptor_set_layout.vk_descriptor_set_layout_bindings.end(),
       [binding](const VkDescriptorSetLayoutBinding &layout_binding) {
         return binding == layout_binding.binding;
       });
   assert(itr !=
-         descriptor_set_layout.config.vk_descriptor_set_layout_bindings.end());
+         config_descriptor_set_layout.vk_descriptor_set_layout_bindings.end());
   vk_write.descriptorType  = itr->descriptorType;
   vk_write.pBufferInfo     = vk_buffer_info;
   vk_write.dstArrayElement = array_element;
   vk_writes.push_back(vk_write);
+  {
+    std::scoped_lock lock{context._defragmentation_mutex};
+    context._descriptor_buffer_writes[{handle, binding, array_element}] = {
+        .handle_buffer      = info.handle_buffer,
+        .vk_descriptor_type = itr->descriptorType,
+        .vk_offset          = info.vk_offset,
+        .vk_range           = info.vk_range};
+  }
   return *this;
 }
 
@@ -303,18 +474,18 @@ update_descriptor_set_t &update_descriptor_set_t::push_image_write(
           : VK_NULL_HANDLE;
   vk_image_info->imageLayout = info.vk_image_layout;
 
-  internal::descriptor_set_layout_t &descriptor_set_layout =
-      utils::assert_and_get_data<internal::descriptor_set_layout_t>(
-          descriptor_set.config.handle_descriptor_set_layout,
+  config_descriptor_set_layout_t &config_descriptor_set_layout =
+      utils::assert_and_get_config<config_descriptor_set_layout_t>(
+          descriptor_set.handle_descriptor_set_layout,
           context._descriptor_set_layouts);
   auto itr = std::find_if(
-      descriptor_set_layout.config.vk_descriptor_set_layout_bindings.begin(),
-      descriptor_set_layout.config.vk_descriptor_set_layout_bindings.end(),
+      config_descriptor_set_layout.vk_descriptor_set_layout_bindings.begin(),
+      config_descriptor_set_layout.vk_descriptor_set_layout_bindings.end(),
       [binding](const VkDescriptorSetLayoutBinding &layout_binding) {
         return binding == layout_binding.binding;
       });
   assert(itr !=
-         descriptor_set_layout.config.vk_descriptor_set_layout_bindings.end());
+         config_descriptor_set_layout.vk_descriptor_set_layout_bindings.end());
   vk_write.descriptorType  = itr->descriptorType;
   vk_write.pImageInfo      = vk_image_info;
   vk_write.dstArrayElement = array_element;
@@ -346,89 +517,127 @@ struct volk_initializer_t {
 
 static volk_initializer_t volk_initializer{};
 
-context_t::context_t(const bool enable_validation)
-    : _validation(enable_validation) {
+context_t::context_t(const bool                   enable_validation,
+                     const std::filesystem::path &pipeline_cache_path)
+    : _validation(enable_validation),
+      _pipeline_cache_path(pipeline_cache_path) {
   horizon_profile();
   create_instance();
   create_device();
   create_allocator();
-  create_descriptor_pool();
+  create_descriptor_allocator();
+  create_pipeline_cache();
+  create_queue_timelines();
+  _shader_compiler = std::make_unique<shader_compiler_t>();
+  _thread_pool     = std::make_unique<core::thread_pool_t>();
 }
 
 context_t::~context_t() {
   horizon_profile();
+  stop_submission_thread();
+  _thread_pool.reset();
+  for (auto &[thread_id, commandbuffer_rings] : _commandbuffer_rings)
+    for (commandbuffer_ring_t &commandbuffer_ring : commandbuffer_rings)
+      for (commandbuffer_ring_slot_t &slot : commandbuffer_ring) {
+        for (handle_commandbuffer_t handle : slot.handle_commandbuffers)
+          free_commandbuffer(handle);
+        destroy_command_pool(slot.handle_command_pool);
+      }
+  for (auto &[key, derived] : _derived_pipeline_layouts)
+    destroy_pipeline_layout(derived.second);
+  for (auto &[key, derived] : _derived_descriptor_set_layouts)
+    destroy_descriptor_set_layout(derived.second);
   vkDeviceWaitIdle(_vkb_device);
-  for (auto &[handle, timer] : _timers) {
+  // ended before anything is freed, so every allocation is back to normal
+  if (_defragmentation.vma_defragmentation_context != VK_NULL_HANDLE) {
+    if (_defragmentation.stage != defragmentation_stage_t::e_idle)
+      end_defragmentation_pass();
+    vmaEndDefragmentation(_vma_allocator,
+                          _defragmentation.vma_defragmentation_context,
+                          nullptr);
+  }
+  release_deferred_destructions(std::numeric_limits<uint64_t>::max());
+  // its pools are destroyed deferred as well, after the sets freed into them
+  _descriptor_allocator.reset();
+  release_deferred_destructions(std::numeric_limits<uint64_t>::max());
+  for (auto [handle, timer] : _timers) {
     horizon_trace("forgot to clear command pool with handle: {}", handle);
     vkDestroyQueryPool(_vkb_device, timer, nullptr);
   }
-  for (auto &[handle, commandbuffer] : _commandbuffers) {
+  for (auto [handle, commandbuffer] : _commandbuffers) {
     horizon_trace("forgot to clear commandbuffer with handle: {}", handle);
     vkFreeCommandBuffers(
         _vkb_device,
         utils::assert_and_get_data<internal::command_pool_t>(
-            commandbuffer.config.handle_command_pool, _command_pools),
+            commandbuffer.handle_command_pool, _command_pools),
         1, &commandbuffer.vk_commandbuffer);
   }
-  for (auto &[handle, command_pool] : _command_pools) {
+  for (auto [handle, command_pool] : _command_pools) {
     horizon_trace("forgot to clear command pool with handle: {}", handle);
     vkDestroyCommandPool(_vkb_device, command_pool, nullptr);
   }
-  for (auto &[handle, semaphore] : _semaphores) {
+  for (auto [handle, semaphore] : _semaphores) {
     horizon_trace("forgot to clear semaphore with handle: {}", handle);
     vkDestroySemaphore(_vkb_device, semaphore, nullptr);
   }
-  for (auto &[handle, fence] : _fences) {
+  for (auto [handle, fence] : _fences) {
     horizon_trace("forgot to clear fence with handle: {}", handle);
     vkDestroyFence(_vkb_device, fence, nullptr);
   }
-  for (auto &[handle, pipeline_layout] : _pipeline_layouts) {
+  for (auto [handle, pipeline_layout] : _pipeline_layouts) {
     horizon_trace("forgot to clear pipeline layout with handle: {}", handle);
     vkDestroyPipelineLayout(_vkb_device, pipeline_layout, nullptr);
   }
-  for (auto &[handle, pipeline] : _pipelines) {
+  for (auto [handle, pipeline] : _pipelines) {
     horizon_trace("forgot to clear pipeline with handle: {}", handle);
     vkDestroyPipeline(_vkb_device, pipeline, nullptr);
   }
-  for (auto &[handle, shader] : _shaders) {
+  for (auto [handle, shader] : _shaders) {
     horizon_trace("forgot to clear shader with handle: {}", handle);
     vkDestroyShaderModule(_vkb_device, shader, nullptr);
   }
-  for (auto &[handle, descriptor_set] : _descriptor_sets) {
+  for (auto [handle, descriptor_set] : _descriptor_sets) {
+    // released along with the pools
     horizon_trace("forgot to clear descriptor set with handle: {}", handle);
-    vkFreeDescriptorSets(_vkb_device, _vk_descriptor_pool, 1,
-                         &descriptor_set.vk_descriptor_set);
   }
-  for (auto &[handle, descriptor_set_layout] : _descriptor_set_layouts) {
+  for (auto [handle, descriptor_set_layout] : _descriptor_set_layouts) {
     horizon_trace("forgot to clear descriptor set layout with handle: {}",
                   handle);
     vkDestroyDescriptorSetLayout(_vkb_device, descriptor_set_layout, nullptr);
   }
-  for (auto &[handle, image_view] : _image_views) {
+  for (auto [handle, image_view] : _image_views) {
     horizon_trace("forgot to clear image view with handle: {}", handle);
     vkDestroyImageView(_vkb_device, image_view, nullptr);
   }
-  for (auto &[handle, image] : _images)
+  for (auto [handle, image] : _images)
     if (!image.from_swapchain) {
       horizon_trace("forgot to clear image with handle: {}", handle);
       if (image.p_data) unmap_image(handle);
       vmaDestroyImage(_vma_allocator, image, image.vma_allocation);
     }
-  for (auto &[handle, sampler] : _samplers) {
+  for (auto [handle, sampler] : _samplers) {
     horizon_trace("forgot to clear sampler with handle: {}", handle);
     vkDestroySampler(_vkb_device, sampler, nullptr);
   }
-  for (auto &[handle, buffer] : _buffers) {
+  for (auto [handle, buffer] : _buffers) {
     horizon_trace("forgot to clear buffer with handle: {}", handle);
     if (buffer.p_data) unmap_buffer(handle);
     vmaDestroyBuffer(_vma_allocator, buffer, buffer.vma_allocation);
   }
-  for (auto &[handle, swapchain] : _swapchains) {
+  for (auto [handle, memory_pool] : _memory_pools) {
+    horizon_trace("forgot to clear memory pool with handle: {}", handle);
+    vmaDestroyPool(_vma_allocator, memory_pool);
+  }
+  for (auto [handle, swapchain] : _swapchains) {
     horizon_trace("forgot to clear swapchain with handle: {}", handle);
     vkDestroySwapchainKHR(_vkb_device, swapchain.vk_swapchain, nullptr);
     vkDestroySurfaceKHR(_vkb_instance, swapchain.vk_surface, nullptr);
   }
-  vkDestroyDescriptorPool(_vkb_device, _vk_descriptor_pool, nullptr);
+  if (!_pipeline_cache_path.empty()) save_pipeline_cache();
+  vkDestroyPipelineCache(_vkb_device, _vk_pipeline_cache, nullptr);
+  for (queue_timeline_t &queue_timeline : _queue_timelines)
+    vkDestroySemaphore(_vkb_device, queue_timeline.vk_semaphore, nullptr);
+  vkDestroyDescriptorPool(_vkb_device, _vk_imgui_descriptor_pool, nullptr);
   vmaDestroyAllocator(_vma_allocator);
   vkb::destroy_device(_vkb_device);
   vkb::destroy_instance(_vkb_instance);
@@ -436,7 +645,176 @@ context_t::~context_t() {
 
 void context_t::wait_idle() {
   horizon_profile();
-  vkDeviceWaitIdle(_vkb_device);
+  {
+    std::scoped_lock lock{_queue_mutex};
+    vkDeviceWaitIdle(_vkb_device);
+    _completed_serial = _submitted_serial.load();
+  }
+  // the device is idle, only command buffers still being recorded can
+  // reference what was retired
+  collect_garbage();
+}
+
+void context_t::collect_garbage() {
+  horizon_profile();
+  release_deferred_destructions(retired_ticket());
+}
+
+uint64_t context_t::submitted_serial() { return _submitted_serial.load(); }
+
+uint64_t context_t::completed_serial() {
+  horizon_profile();
+  // submissions after this point get a later serial and cannot matter
+  uint64_t serial = _submitted_serial.load();
+  for (queue_timeline_t &queue_timeline : _queue_timelines) {
+    uint64_t last_serial = queue_timeline.last_serial.load();
+    uint64_t value;
+    VkResult vk_result = vkGetSemaphoreCounterValue(
+        _vkb_device, queue_timeline.vk_semaphore, &value);
+    check(vk_result == VK_SUCCESS, "Failed to get queue timeline value");
+    // serials interleave across queues, a busy queue only vouches for what
+    // it already finished
+    if (value < last_serial) serial = std::min(serial, value);
+  }
+  utils::raise_serial(_completed_serial, serial);
+  return _completed_serial.load();
+}
+
+void context_t::wait_serial(uint64_t serial) {
+  horizon_profile();
+  // a serial not submitted yet cannot be waited on, and later submissions
+  // are not covered by the wait, so only what is submitted now counts
+  serial = std::min(serial, _submitted_serial.load());
+  if (serial <= _completed_serial.load()) return;
+  std::vector<VkSemaphore> vk_semaphores;
+  std::vector<uint64_t>    values;
+  for (queue_timeline_t &queue_timeline : _queue_timelines) {
+    uint64_t last_serial = queue_timeline.last_serial.load();
+    if (last_serial == 0) continue;
+    // reaching the value means every earlier submission on the queue is done
+    vk_semaphores.push_back(queue_timeline.vk_semaphore);
+    values.push_back(std::min(serial, last_serial));
+  }
+  VkSemaphoreWaitInfo vk_semaphore_wait_info{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+  vk_semaphore_wait_info.semaphoreCount = vk_semaphores.size();
+  vk_semaphore_wait_info.pSemaphores    = vk_semaphores.data();
+  vk_semaphore_wait_info.pValues        = values.data();
+  VkResult vk_result =
+      vkWaitSemaphores(_vkb_device, &vk_semaphore_wait_info, UINT64_MAX);
+  check(vk_result == VK_SUCCESS, "Failed to wait for serial {}", serial);
+  utils::raise_serial(_completed_serial, serial);
+}
+
+uint64_t context_t::retirement_ticket() {
+  horizon_profile();
+  std::scoped_lock lock{_retirement_mutex};
+  return _next_ticket++;
+}
+
+bool context_t::is_retired(uint64_t ticket) {
+  horizon_profile();
+  {
+    // cheap for everything older than the last refresh
+    std::scoped_lock lock{_retirement_mutex};
+    if (ticket < _retired_ticket) return true;
+  }
+  return ticket < retired_ticket();
+}
+
+void context_t::defer_destruction(std::function<void()> destroy) {
+  horizon_profile();
+  std::scoped_lock lock{_retirement_mutex};
+  _deferred_destructions.push_back(
+      {.ticket = _next_ticket++, .destroy = std::move(destroy)});
+}
+
+void context_t::stamp_retirement_tickets() {
+  horizon_profile();
+  std::scoped_lock lock{_retirement_mutex};
+  // command buffers begun before any ticket below this one were submitted,
+  // submit publishes their serial before closing them
+  uint64_t ticket = _open_commandbuffer_tickets.empty()
+                        ? _next_ticket
+                        : *_open_commandbuffer_tickets.begin();
+  uint64_t serial = _submitted_serial.load();
+  if (!_retirement_stamps.empty() &&
+      _retirement_stamps.back().ticket >= ticket)
+    return;
+  if (!_retirement_stamps.empty() &&
+      _retirement_stamps.back().serial == serial)
+    _retirement_stamps.back().ticket = ticket;
+  else
+    _retirement_stamps.push_back({.ticket = ticket, .serial = serial});
+}
+
+uint64_t context_t::retired_ticket() {
+  horizon_profile();
+  stamp_retirement_tickets();
+  uint64_t         serial = completed_serial();
+  std::scoped_lock lock{_retirement_mutex};
+  while (!_retirement_stamps.empty() &&
+         _retirement_stamps.front().serial <= serial) {
+    _retired_ticket = _retirement_stamps.front().ticket;
+    _retirement_stamps.pop_front();
+  }
+  return _retired_ticket;
+}
+
+void context_t::release_deferred_destructions(uint64_t ticket) {
+  horizon_profile();
+  std::vector<deferred_destruction_t> ready;
+  {
+    std::scoped_lock lock{_retirement_mutex};
+    // tickets are pushed in increasing order
+    while (!_deferred_destructions.empty() &&
+           _deferred_destructions.front().ticket < ticket) {
+      ready.push_back(std::move(_deferred_destructions.front()));
+      _deferred_destructions.pop_front();
+    }
+  }
+  for (auto &deferred_destruction : ready) deferred_destruction.destroy();
+  if (ready.size())
+    horizon_trace("released {} deferred destructions", ready.size());
+}
+
+uint32_t context_t::memory_category(const std::string &debug_name) {
+  horizon_profile();
+  std::string name = debug_name.substr(0, debug_name.find(':'));
+  if (name.empty()) name = "unnamed";
+  std::scoped_lock lock{_memory_stats_mutex};
+  auto [itr, inserted] =
+      _memory_category_indices.try_emplace(name, _memory_categories.size());
+  if (inserted) {
+    _memory_category_names.push_back(name);
+    _memory_categories.emplace_back();
+  }
+  return itr->second;
+}
+
+void context_t::track_allocation(memory_counter_t &counter,
+                                 uint32_t          memory_category,
+                                 VkDeviceSize      vk_size) {
+  horizon_profile();
+  std::scoped_lock lock{_memory_stats_mutex};
+  for (memory_counter_t *p_counter :
+       {&counter, &_memory_categories[memory_category]}) {
+    p_counter->count++;
+    p_counter->bytes      += vk_size;
+    p_counter->peak_bytes  = std::max(p_counter->peak_bytes, p_counter->bytes);
+  }
+}
+
+void context_t::untrack_allocation(memory_counter_t &counter,
+                                   uint32_t          memory_category,
+                                   VkDeviceSize      vk_size) {
+  horizon_profile();
+  std::scoped_lock lock{_memory_stats_mutex};
+  for (memory_counter_t *p_counter :
+       {&counter, &_memory_categories[memory_category]}) {
+    p_counter->count--;
+    p_counter->bytes -= vk_size;
+  }
 }
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL
@@ -531,10 +909,16 @@ void context_t::create_device() {
       .descriptorBindingVariableDescriptorCount      = VK_TRUE,
       .runtimeDescriptorArray                        = VK_TRUE,
       .scalarBlockLayout                             = VK_TRUE,
+      .timelineSemaphore                             = VK_TRUE,
       .bufferDeviceAddress                           = VK_TRUE,
   };
   vkb_physical_device_selector.set_required_features_12(
       vk_physical_device_vulkan_12_features);
+  VkPhysicalDeviceVulkan13Features vk_physical_device_vulkan_13_features{
+      .synchronization2 = VK_TRUE,
+  };
+  vkb_physical_device_selector.set_required_features_13(
+      vk_physical_device_vulkan_13_features);
 
   vkb_physical_device_selector.prefer_gpu_device_type(
       vkb::PreferredDeviceType::discrete);
@@ -558,6 +942,9 @@ void context_t::create_device() {
     _vkb_physical_device = result.value();
     horizon_trace("{}", _vkb_physical_device.name);
   }
+  // without it vma estimates budgets from its own allocations and heap sizes
+  _vk_memory_budget = _vkb_physical_device.enable_extension_if_present(
+      VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
   vkb::DeviceBuilder vkb_device_builder{_vkb_physical_device};
   {
     auto result = vkb_device_builder.build();
@@ -584,6 +971,26 @@ void context_t::create_device() {
     check(result, "Failed to get present queue index");
     _present_queue.vk_index = result.value();
   }
+  // vk-bootstrap hands out families without graphics support here, devices
+  // like lavapipe only have the one family so everything stays on graphics
+  _compute_queue = _graphics_queue;
+  {
+    auto queue = _vkb_device.get_queue(vkb::QueueType::compute);
+    auto index = _vkb_device.get_queue_index(vkb::QueueType::compute);
+    if (queue && index)
+      _compute_queue = {.vk_queue = queue.value(), .vk_index = index.value()};
+    else
+      horizon_trace("no separate compute queue, using the graphics queue");
+  }
+  _transfer_queue = _graphics_queue;
+  {
+    auto queue = _vkb_device.get_queue(vkb::QueueType::transfer);
+    auto index = _vkb_device.get_queue_index(vkb::QueueType::transfer);
+    if (queue && index)
+      _transfer_queue = {.vk_queue = queue.value(), .vk_index = index.value()};
+    else
+      horizon_trace("no separate transfer queue, using the graphics queue");
+  }
   vkDestroySurfaceKHR(_vkb_instance, vk_temp_surface, nullptr);
   volkLoadDevice(_vkb_device);
 
@@ -623,8 +1030,12 @@ void context_t::create_allocator() {
           vkGetDeviceBufferMemoryRequirements,
       .vkGetDeviceImageMemoryRequirements = vkGetDeviceImageMemoryRequirements,
   };
+  VmaAllocatorCreateFlags vma_allocator_create_flags =
+      VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+  if (_vk_memory_budget)
+    vma_allocator_create_flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
   VmaAllocatorCreateInfo vma_allocator_create_info{
-      .flags            = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+      .flags            = vma_allocator_create_flags,
       .physicalDevice   = _vkb_physical_device,
       .device           = _vkb_device,
       .pVulkanFunctions = &vma_vulkan_functions,
@@ -637,76 +1048,198 @@ void context_t::create_allocator() {
   horizon_trace("created allocator");
 }
 
-void context_t::create_descriptor_pool() {
+void context_t::create_descriptor_allocator() {
   horizon_profile();
-  std::vector<VkDescriptorPoolSize> vk_pool_sizes{};
-  {
-    VkDescriptorPoolSize vk_pool_size{};
-    vk_pool_size.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    vk_pool_size.descriptorCount = 1000000;
-    vk_pool_sizes.push_back(vk_pool_size);
-  }
-  {
-    VkDescriptorPoolSize vk_pool_size{};
-    vk_pool_size.type            = VK_DESCRIPTOR_TYPE_SAMPLER;
-    vk_pool_size.descriptorCount = 1000000;
-    vk_pool_sizes.push_back(vk_pool_size);
-  }
-  {
-    VkDescriptorPoolSize vk_pool_size{};
-    vk_pool_size.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    vk_pool_size.descriptorCount = 1000000;
-    vk_pool_sizes.push_back(vk_pool_size);
-  }
-  {
-    VkDescriptorPoolSize vk_pool_size{};
-    vk_pool_size.type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    vk_pool_size.descriptorCount = 1000000;
-    vk_pool_sizes.push_back(vk_pool_size);
-  }
-  {
-    VkDescriptorPoolSize vk_pool_size{};
-    vk_pool_size.type            = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    vk_pool_size.descriptorCount = 1000000;
-    vk_pool_sizes.push_back(vk_pool_size);
-  }
-  {
-    VkDescriptorPoolSize vk_pool_size{};
-    vk_pool_size.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    vk_pool_size.descriptorCount = 1000000;
-    vk_pool_sizes.push_back(vk_pool_size);
-  }
+  // the bindless layouts use update after bind, so every pool has to allow it
+  _descriptor_allocator = std::make_unique<descriptor_allocator_t>(
+      *this,
+      VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT |
+          VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT,
+      64);
+
+  // kept apart from the allocator, imgui wants a raw pool
+  VkDescriptorPoolSize vk_pool_size{};
+  vk_pool_size.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  vk_pool_size.descriptorCount = 128;
   VkDescriptorPoolCreateInfo vk_descriptor_pool_create_info{};
   vk_descriptor_pool_create_info.sType =
       VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  vk_descriptor_pool_create_info.poolSizeCount = vk_pool_sizes.size();
-  vk_descriptor_pool_create_info.pPoolSizes    = vk_pool_sizes.data();
-  vk_descriptor_pool_create_info.maxSets       = 1000000 * 7;
+  vk_descriptor_pool_create_info.poolSizeCount = 1;
+  vk_descriptor_pool_create_info.pPoolSizes    = &vk_pool_size;
+  vk_descriptor_pool_create_info.maxSets       = 128;
   vk_descriptor_pool_create_info.flags =
-      VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT |
-      VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+      VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
   VkResult vk_result =
       vkCreateDescriptorPool(_vkb_device, &vk_descriptor_pool_create_info,
-                             nullptr, &_vk_descriptor_pool);
+                             nullptr, &_vk_imgui_descriptor_pool);
   check(vk_result == VK_SUCCESS, "Failed to create descriptor pool");
-  horizon_trace("created descriptor pool");
+  horizon_trace("created descriptor allocator");
+}
+
+void context_t::create_pipeline_cache() {
+  horizon_profile();
+  std::vector<uint8_t> data = utils::read_pipeline_cache(
+      _pipeline_cache_path, _vkb_physical_device.properties);
+  VkPipelineCacheCreateInfo vk_pipeline_cache_create_info{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+  vk_pipeline_cache_create_info.initialDataSize = data.size();
+  vk_pipeline_cache_create_info.pInitialData    = data.data();
+  VkResult vk_result =
+      vkCreatePipelineCache(_vkb_device, &vk_pipeline_cache_create_info,
+                            nullptr, &_vk_pipeline_cache);
+  check(vk_result == VK_SUCCESS, "Failed to create pipeline cache");
+  horizon_trace("created pipeline cache with {} bytes of initial data",
+                data.size());
+}
+
+void context_t::create_queue_timelines() {
+  horizon_profile();
+  VkSemaphoreTypeCreateInfo vk_semaphore_type_create_info{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+  vk_semaphore_type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  vk_semaphore_type_create_info.initialValue  = 0;
+  VkSemaphoreCreateInfo vk_semaphore_create_info{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+  vk_semaphore_create_info.pNext = &vk_semaphore_type_create_info;
+
+  std::vector<VkQueue> vk_queues;
+  for (queue_type_t queue_type :
+       {queue_type_t::e_graphics, queue_type_t::e_compute,
+        queue_type_t::e_transfer}) {
+    VkQueue vk_queue = queue(queue_type);
+    auto    itr      = std::find(vk_queues.begin(), vk_queues.end(), vk_queue);
+    if (itr != vk_queues.end()) {
+      _queue_timeline_indices[static_cast<uint32_t>(queue_type)] =
+          itr - vk_queues.begin();
+      continue;
+    }
+    queue_timeline_t &queue_timeline = _queue_timelines.emplace_back();
+    VkResult          vk_result =
+        vkCreateSemaphore(_vkb_device, &vk_semaphore_create_info, nullptr,
+                          &queue_timeline.vk_semaphore);
+    check(vk_result == VK_SUCCESS, "Failed to create queue timeline");
+    _queue_timeline_indices[static_cast<uint32_t>(queue_type)] =
+        vk_queues.size();
+    vk_queues.push_back(vk_queue);
+  }
+  horizon_trace("created {} queue timelines", _queue_timelines.size());
+}
+
+void context_t::set_pipeline_cache_path(const std::filesystem::path &path) {
+  horizon_profile();
+  _pipeline_cache_path = path;
+  std::vector<uint8_t> data = utils::read_pipeline_cache(
+      _pipeline_cache_path, _vkb_physical_device.properties);
+  if (data.empty()) return;
+  // pipelines already in the live cache are kept, the file is merged in
+  VkPipelineCacheCreateInfo vk_pipeline_cache_create_info{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+  vk_pipeline_cache_create_info.initialDataSize = data.size();
+  vk_pipeline_cache_create_info.pInitialData    = data.data();
+  VkPipelineCache vk_pipeline_cache;
+  VkResult        vk_result =
+      vkCreatePipelineCache(_vkb_device, &vk_pipeline_cache_create_info,
+                            nullptr, &vk_pipeline_cache);
+  check(vk_result == VK_SUCCESS, "Failed to create pipeline cache");
+  vk_result = vkMergePipelineCaches(_vkb_device, _vk_pipeline_cache, 1,
+                                    &vk_pipeline_cache);
+  check(vk_result == VK_SUCCESS, "Failed to merge pipeline cache");
+  vkDestroyPipelineCache(_vkb_device, vk_pipeline_cache, nullptr);
+  horizon_trace("merged {} bytes of pipeline cache from {}", data.size(),
+                path.string());
+}
+
+bool context_t::save_pipeline_cache() {
+  horizon_profile();
+  if (_pipeline_cache_path.empty()) {
+    horizon_warn("no pipeline cache path set, not saving pipeline cache");
+    return false;
+  }
+  size_t   size;
+  VkResult vk_result =
+      vkGetPipelineCacheData(_vkb_device, _vk_pipeline_cache, &size, nullptr);
+  check(vk_result == VK_SUCCESS, "Failed to get pipeline cache size");
+  std::vector<uint8_t> data(size);
+  vk_result = vkGetPipelineCacheData(_vkb_device, _vk_pipeline_cache, &size,
+                                     data.data());
+  check(vk_result == VK_SUCCESS, "Failed to get pipeline cache data");
+
+  // write next to the target and rename, a crash mid write must not leave a
+  // truncated cache behind
+  std::filesystem::path temp_path = _pipeline_cache_path;
+  temp_path += ".tmp";
+  {
+    std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      horizon_warn("Failed to open {} for writing", temp_path.string());
+      return false;
+    }
+    file.write(reinterpret_cast<const char *>(data.data()), size);
+    if (!file) {
+      horizon_warn("Failed to write pipeline cache {}", temp_path.string());
+      return false;
+    }
+  }
+  std::error_code error_code;
+  std::filesystem::rename(temp_path, _pipeline_cache_path, error_code);
+  if (error_code) {
+    horizon_warn("Failed to move pipeline cache to {}: {}",
+                 _pipeline_cache_path.string(), error_code.message());
+    return false;
+  }
+  horizon_trace("saved {} bytes of pipeline cache to {}", size,
+                _pipeline_cache_path.string());
+  return true;
 }
 
 handle_swapchain_t context_t::create_swapchain(const core::window_t &window) {
   horizon_profile();
-  internal::swapchain_t swapchain{};
+  VkSurfaceKHR vk_surface;
   {
     VkResult vk_result = glfwCreateWindowSurface(
-        _vkb_instance, window.window(), nullptr, &swapchain.vk_surface);
+        _vkb_instance, window.window(), nullptr, &vk_surface);
     const char *description;
     glfwGetError(&description);
     check(vk_result == VK_SUCCESS, "Failed to create surface: {}", description);
   }
+  return build_swapchain(window, vk_surface, VK_NULL_HANDLE);
+}
+
+handle_swapchain_t context_t::recreate_swapchain(handle_swapchain_t handle,
+                                                 const core::window_t &window) {
+  horizon_profile();
+  internal::swapchain_t swapchain =
+      utils::assert_and_get_data<internal::swapchain_t>(handle, _swapchains);
+  for (auto handle_image_view : swapchain.handle_image_views) {
+    destroy_image_view(handle_image_view);
+  }
+  for (auto handle_image : swapchain.handle_images) {
+    _images.erase(handle_image);
+  }
+  _swapchains.erase(handle);
+  // the surface is handed over to the new swapchain, the old one may still
+  // have frames in flight so it is retired instead of destroyed
+  handle_swapchain_t new_handle =
+      build_swapchain(window, swapchain.vk_surface, swapchain.vk_swapchain);
+  defer_destruction([this, swapchain]() {
+    vkDestroySwapchainKHR(_vkb_device, swapchain.vk_swapchain, nullptr);
+  });
+  horizon_trace("recreated swapchain");
+  return new_handle;
+}
+
+handle_swapchain_t context_t::build_swapchain(
+    const core::window_t &window, VkSurfaceKHR vk_surface,
+    VkSwapchainKHR vk_old_swapchain) {
+  horizon_profile();
+  internal::swapchain_t swapchain{};
+  swapchain.vk_surface = vk_surface;
   {
     vkb::SwapchainBuilder vkb_swapchain_builder{_vkb_device,
                                                 swapchain.vk_surface};
     auto [width, height] = window.dimensions();
     vkb_swapchain_builder.set_desired_extent(width, height);
+    vkb_swapchain_builder.set_old_swapchain(vk_old_swapchain);
     auto result = vkb_swapchain_builder.build();
     check(result, "Failed to create swapchain");
     swapchain.vk_swapchain = result.value();
@@ -729,12 +1262,14 @@ handle_swapchain_t context_t::create_swapchain(const core::window_t &window) {
     config_image.vk_mips           = 1;
     config_image.vk_array_layers   = 1;
     config_image.vk_sample_count   = VK_SAMPLE_COUNT_1_BIT;
-    internal::image_t image{.config = config_image};
-    image.vk_image       = vk_image;
-    image.from_swapchain = true;
+    internal::image_t image{};
+    image.vk_image        = vk_image;
+    image.vk_image_aspect = utils::get_image_aspect(config_image.vk_format);
+    image.from_swapchain  = true;
 
     handle_image_t handle_image =
-        utils::create_and_insert_new_handle<handle_image_t>(_images, image);
+        utils::create_and_insert_new_handle<handle_image_t>(_images, image,
+                                                            config_image);
 
     handle_image_view_t handle_image_view =
         create_image_view({.handle_image = handle_image});
@@ -743,22 +1278,28 @@ handle_swapchain_t context_t::create_swapchain(const core::window_t &window) {
     swapchain.handle_image_views.push_back(handle_image_view);
   }
   handle_swapchain_t handle =
-      utils::create_and_insert_new_handle<handle_swapchain_t>(_swapchains,
-                                                              swapchain);
+      utils::create_and_insert_new_handle<handle_swapchain_t>(
+          _swapchains, swapchain, std::monostate{});
   horizon_trace("created swapchain");
   return handle;
 }
 
 void context_t::destroy_swapchain(handle_swapchain_t handle) {
   horizon_profile();
-  internal::swapchain_t &swapchain =
+  internal::swapchain_t swapchain =
       utils::assert_and_get_data<internal::swapchain_t>(handle, _swapchains);
   for (auto handle_image_view : swapchain.handle_image_views) {
     destroy_image_view(handle_image_view);
   }
-  vkDestroySwapchainKHR(_vkb_device, swapchain.vk_swapchain, nullptr);
-  vkDestroySurfaceKHR(_vkb_instance, swapchain.vk_surface, nullptr);
+  // swapchain images are owned by the swapchain, only their slots go away
+  for (auto handle_image : swapchain.handle_images) {
+    _images.erase(handle_image);
+  }
   _swapchains.erase(handle);
+  defer_destruction([this, swapchain]() {
+    vkDestroySwapchainKHR(_vkb_device, swapchain.vk_swapchain, nullptr);
+    vkDestroySurfaceKHR(_vkb_instance, swapchain.vk_surface, nullptr);
+  });
 }
 
 std::vector<handle_image_t> context_t::get_swapchain_images(
@@ -830,7 +1371,8 @@ bool context_t::present_swapchain(
   vk_present_info.pResults           = &vk_result;
 
   {
-    VkResult vk_result =
+    std::scoped_lock lock{_queue_mutex};
+    VkResult         vk_result =
         vkQueuePresentKHR(_present_queue.vk_queue, &vk_present_info);
     if (vk_result == VK_ERROR_OUT_OF_DATE_KHR) {
       horizon_warn("queue present failed: OUT OF DATE KHR");
@@ -855,25 +1397,111 @@ internal::swapchain_t &context_t::get_swapchain(handle_swapchain_t handle) {
   return utils::assert_and_get_data<internal::swapchain_t>(handle, _swapchains);
 }
 
+handle_memory_pool_t context_t::create_memory_pool(
+    const config_memory_pool_t &config) {
+  horizon_profile();
+  VmaAllocationCreateInfo vma_allocation_create_info{};
+  vma_allocation_create_info.usage = config.vma_memory_usage;
+  vma_allocation_create_info.flags = config.vma_allocation_create_flags;
+
+  // the memory type is whatever vma would pick for a small resource of the
+  // kind the pool is meant for
+  uint32_t vk_memory_type_index;
+  VkResult vk_result;
+  if (config.vk_image_usage != 0) {
+    VkImageCreateInfo vk_image_create_info = utils::image_create_info(
+        {.vk_width  = 1,
+         .vk_height = 1,
+         .vk_depth  = 1,
+         .vk_type   = VK_IMAGE_TYPE_2D,
+         .vk_format = config.vk_format,
+         .vk_usage  = config.vk_image_usage,
+         .vk_mips   = 1});
+    vk_result = vmaFindMemoryTypeIndexForImageInfo(
+        _vma_allocator, &vk_image_create_info, &vma_allocation_create_info,
+        &vk_memory_type_index);
+  } else {
+    VkBufferCreateInfo vk_buffer_create_info = utils::buffer_create_info(
+        {.vk_size               = 1,
+         .vk_buffer_usage_flags = config.vk_buffer_usage_flags});
+    vk_result = vmaFindMemoryTypeIndexForBufferInfo(
+        _vma_allocator, &vk_buffer_create_info, &vma_allocation_create_info,
+        &vk_memory_type_index);
+  }
+  check(vk_result == VK_SUCCESS, "Failed to find memory type for memory pool");
+
+  VmaPoolCreateInfo vma_pool_create_info{};
+  vma_pool_create_info.memoryTypeIndex = vk_memory_type_index;
+  vma_pool_create_info.flags           = config.vma_pool_create_flags;
+  vma_pool_create_info.blockSize       = config.vk_block_size;
+  vma_pool_create_info.minBlockCount   = config.min_block_count;
+  vma_pool_create_info.maxBlockCount   = config.max_block_count;
+
+  internal::memory_pool_t memory_pool{};
+  vk_result = vmaCreatePool(_vma_allocator, &vma_pool_create_info,
+                            &memory_pool.vma_pool);
+  check(vk_result == VK_SUCCESS, "Failed to create memory pool");
+
+  handle_memory_pool_t handle =
+      utils::create_and_insert_new_handle<handle_memory_pool_t>(
+          _memory_pools, memory_pool, config);
+  if (config.debug_name != "") {
+    vmaSetPoolName(_vma_allocator, memory_pool, config.debug_name.data());
+    horizon_trace("created memory pool {}", config.debug_name);
+  } else {
+    horizon_trace("created memory pool");
+  }
+  return handle;
+}
+
+void context_t::destroy_memory_pool(handle_memory_pool_t handle) {
+  horizon_profile();
+  VmaPool vma_pool = utils::assert_and_get_data<internal::memory_pool_t>(
+      handle, _memory_pools);
+  _memory_pools.erase(handle);
+  // queued after the destructions of the resources allocated from it
+  defer_destruction(
+      [this, vma_pool]() { vmaDestroyPool(_vma_allocator, vma_pool); });
+}
+
+internal::memory_pool_t &context_t::get_memory_pool(
+    handle_memory_pool_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::memory_pool_t>(handle,
+                                                             _memory_pools);
+}
+
+const config_memory_pool_t &context_t::get_memory_pool_config(
+    handle_memory_pool_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_memory_pool_t>(handle,
+                                                            _memory_pools);
+}
+
 handle_buffer_t context_t::create_buffer(const config_buffer_t &config) {
   horizon_profile();
   assert(config.vk_size != 0);
-  internal::buffer_t buffer{.config = config};
+  internal::buffer_t buffer{};
 
-  VkBufferCreateInfo vk_buffer_create_info{
-      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-  vk_buffer_create_info.size = config.vk_size;
-  vk_buffer_create_info.usage =
-      config.vk_buffer_usage_flags | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+  VkBufferCreateInfo vk_buffer_create_info = utils::buffer_create_info(config);
 
   VmaAllocationCreateInfo vma_allocation_create_info{};
   vma_allocation_create_info.usage = config.vma_memory_usage;
   vma_allocation_create_info.flags = config.vma_allocation_create_flags;
+  if (config.handle_memory_pool != core::null_handle)
+    vma_allocation_create_info.pool =
+        get_memory_pool(config.handle_memory_pool);
 
-  VkResult vk_result = vmaCreateBuffer(
+  VmaAllocationInfo vma_allocation_info;
+  VkResult          vk_result = vmaCreateBuffer(
       _vma_allocator, &vk_buffer_create_info, &vma_allocation_create_info,
-      &buffer.vk_buffer, &buffer.vma_allocation, nullptr);
+      &buffer.vk_buffer, &buffer.vma_allocation, &vma_allocation_info);
   check(vk_result == VK_SUCCESS, "Failed to create buffer");
+  buffer.vk_allocation_size = vma_allocation_info.size;
+  buffer.memory_category    = memory_category(config.debug_name);
+  buffer.movable            = config.movable;
+  track_allocation(_buffer_memory, buffer.memory_category,
+                   buffer.vk_allocation_size);
 
   VkBufferDeviceAddressInfo vk_buffer_device_address_info{
       .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
@@ -882,30 +1510,221 @@ handle_buffer_t context_t::create_buffer(const config_buffer_t &config) {
       vkGetBufferDeviceAddress(_vkb_device, &vk_buffer_device_address_info);
 
   handle_buffer_t handle =
-      utils::create_and_insert_new_handle<handle_buffer_t>(_buffers, buffer);
+      utils::create_and_insert_new_handle<handle_buffer_t>(
+          _buffers, buffer, config);
+  vmaSetAllocationUserData(_vma_allocator, buffer.vma_allocation,
+                           utils::allocation_user_data(handle));
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_BUFFER;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(buffer.vk_buffer);
-    vk_debug_utils_object_name_info.pObjectName =
-        buffer.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created buffer {}", buffer.config.debug_name);
+    horizon_trace("created buffer {}", config.debug_name);
   } else {
     horizon_trace("created buffer");
   }
   return handle;
 }
 
+std::vector<handle_buffer_t> context_t::create_buffers(
+    std::span<const config_buffer_t> configs) {
+  horizon_profile();
+  size_t                               count = configs.size();
+  std::vector<internal::buffer_t>      buffers(count);
+  std::vector<VkBufferCreateInfo>      vk_buffer_create_infos(count);
+  std::vector<VkMemoryRequirements>    vk_memory_requirements(count);
+  std::vector<VmaAllocationCreateInfo> vma_allocation_create_infos(count);
+  std::vector<VmaAllocation>           vma_allocations(count);
+  std::vector<VmaAllocationInfo>       vma_allocation_infos(count);
+  for (size_t i = 0; i < count; i++) {
+    const config_buffer_t &config = configs[i];
+    check(config.vk_size != 0, "buffer {} is empty", config.debug_name);
+    vk_buffer_create_infos[i] = utils::buffer_create_info(config);
+    VkResult vk_result = vkCreateBuffer(_vkb_device, &vk_buffer_create_infos[i],
+                                        nullptr, &buffers[i].vk_buffer);
+    check(vk_result == VK_SUCCESS, "Failed to create buffer");
+    vkGetBufferMemoryRequirements(_vkb_device, buffers[i].vk_buffer,
+                                  &vk_memory_requirements[i]);
+    vma_allocation_create_infos[i].usage = config.vma_memory_usage;
+    vma_allocation_create_infos[i].flags = config.vma_allocation_create_flags;
+    if (config.handle_memory_pool != core::null_handle)
+      vma_allocation_create_infos[i].pool =
+          get_memory_pool(config.handle_memory_pool);
+  }
+  allocate_memory_pages<VkBufferCreateInfo>(
+      vk_buffer_create_infos, vk_memory_requirements,
+      vma_allocation_create_infos, vma_allocations, vma_allocation_infos);
+
+  // binding and mapping the same memory concurrently is not allowed, vma
+  // binds host visible memory under its block lock. memory that is never
+  // mapped is bound in one call
+  std::vector<VkBindBufferMemoryInfo> vk_bind_buffer_memory_infos;
+  for (size_t i = 0; i < count; i++) {
+    buffers[i].vma_allocation = vma_allocations[i];
+    if (is_memory_type_host_visible(vma_allocation_infos[i].memoryType)) {
+      VkResult vk_result = vmaBindBufferMemory(
+          _vma_allocator, vma_allocations[i], buffers[i].vk_buffer);
+      check(vk_result == VK_SUCCESS, "Failed to bind buffer memory");
+      continue;
+    }
+    VkBindBufferMemoryInfo vk_bind_buffer_memory_info{
+        .sType        = VK_STRUCTURE_TYPE_BIND_BUFFER_MEMORY_INFO,
+        .buffer       = buffers[i].vk_buffer,
+        .memory       = vma_allocation_infos[i].deviceMemory,
+        .memoryOffset = vma_allocation_infos[i].offset};
+    vk_bind_buffer_memory_infos.push_back(vk_bind_buffer_memory_info);
+  }
+  if (!vk_bind_buffer_memory_infos.empty()) {
+    VkResult vk_result =
+        vkBindBufferMemory2(_vkb_device, vk_bind_buffer_memory_infos.size(),
+                            vk_bind_buffer_memory_infos.data());
+    check(vk_result == VK_SUCCESS, "Failed to bind buffer memory");
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    internal::buffer_t &buffer = buffers[i];
+    buffer.vk_allocation_size  = vma_allocation_infos[i].size;
+    buffer.memory_category     = memory_category(configs[i].debug_name);
+    buffer.movable             = configs[i].movable;
+    track_allocation(_buffer_memory, buffer.memory_category,
+                     buffer.vk_allocation_size);
+    VkBufferDeviceAddressInfo vk_buffer_device_address_info{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
+    vk_buffer_device_address_info.buffer = buffer;
+    buffer.vk_device_address =
+        vkGetBufferDeviceAddress(_vkb_device, &vk_buffer_device_address_info);
+  }
+
+  std::vector<handle_buffer_t> handles =
+      _buffers.insert(std::span<const internal::buffer_t>{buffers}, configs);
+  for (size_t i = 0; i < count; i++) {
+    vmaSetAllocationUserData(_vma_allocator, buffers[i].vma_allocation,
+                             utils::allocation_user_data(handles[i]));
+    if (configs[i].debug_name == "") continue;
+    VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
+        VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
+    vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_BUFFER;
+    vk_debug_utils_object_name_info.objectHandle =
+        reinterpret_cast<uint64_t &>(buffers[i].vk_buffer);
+    vk_debug_utils_object_name_info.pObjectName = configs[i].debug_name.data();
+    vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
+  }
+  horizon_trace("created {} buffers", count);
+  return handles;
+}
+
+template <typename vk_create_info_t>
+void context_t::allocate_memory_pages(
+    std::span<const vk_create_info_t>     vk_create_infos,
+    std::span<const VkMemoryRequirements> vk_memory_requirements,
+    std::span<VmaAllocationCreateInfo>    vma_allocation_create_infos,
+    std::span<VmaAllocation>              vma_allocations,
+    std::span<VmaAllocationInfo>          vma_allocation_infos) {
+  horizon_profile();
+  // memory type bits, allocation flags, memory usage and resource usage
+  // decide which memory type vma picks
+  std::map<std::tuple<uint32_t, VmaAllocationCreateFlags, VmaMemoryUsage,
+                      uint32_t>,
+           uint32_t>
+      vk_memory_types;
+  // every page of one vmaAllocateMemoryPages call shares its requirements, so
+  // resources of a similar size are bucketed together and each page is sized
+  // for the largest of them
+  std::map<std::tuple<VmaPool, uint32_t, VmaAllocationCreateFlags, uint32_t>,
+           std::vector<size_t>>
+      groups;
+  for (size_t i = 0; i < vk_create_infos.size(); i++) {
+    VmaAllocationCreateInfo &vma_allocation_create_info =
+        vma_allocation_create_infos[i];
+    // a pool already pins its memory type
+    if (vma_allocation_create_info.pool == VK_NULL_HANDLE) {
+      auto key = std::make_tuple(vk_memory_requirements[i].memoryTypeBits,
+                                 vma_allocation_create_info.flags,
+                                 vma_allocation_create_info.usage,
+                                 vk_create_infos[i].usage);
+      auto itr = vk_memory_types.find(key);
+      if (itr == vk_memory_types.end()) {
+        uint32_t vk_memory_type;
+        VkResult vk_result;
+        if constexpr (std::is_same_v<vk_create_info_t, VkBufferCreateInfo>)
+          vk_result = vmaFindMemoryTypeIndexForBufferInfo(
+              _vma_allocator, &vk_create_infos[i], &vma_allocation_create_info,
+              &vk_memory_type);
+        else
+          vk_result = vmaFindMemoryTypeIndexForImageInfo(
+              _vma_allocator, &vk_create_infos[i], &vma_allocation_create_info,
+              &vk_memory_type);
+        check(vk_result == VK_SUCCESS, "Failed to find a memory type");
+        itr = vk_memory_types.emplace(key, vk_memory_type).first;
+      }
+      vma_allocation_create_info.usage          = VMA_MEMORY_USAGE_UNKNOWN;
+      vma_allocation_create_info.memoryTypeBits = 1u << itr->second;
+    }
+    groups[std::make_tuple(
+               vma_allocation_create_info.pool,
+               vma_allocation_create_info.memoryTypeBits,
+               vma_allocation_create_info.flags,
+               utils::memory_size_class(vk_memory_requirements[i].size))]
+        .push_back(i);
+  }
+
+  std::vector<VmaAllocation>     group_allocations;
+  std::vector<VmaAllocationInfo> group_allocation_infos;
+  for (auto &[key, indices] : groups) {
+    VkMemoryRequirements vk_group_memory_requirements =
+        vk_memory_requirements[indices[0]];
+    for (size_t index : indices) {
+      const VkMemoryRequirements &vk_requirements =
+          vk_memory_requirements[index];
+      vk_group_memory_requirements.size =
+          std::max(vk_group_memory_requirements.size, vk_requirements.size);
+      vk_group_memory_requirements.alignment = std::max(
+          vk_group_memory_requirements.alignment, vk_requirements.alignment);
+      vk_group_memory_requirements.memoryTypeBits &=
+          vk_requirements.memoryTypeBits;
+    }
+    check(vk_group_memory_requirements.memoryTypeBits != 0,
+          "Bucketed resources share no memory type");
+    group_allocations.resize(indices.size());
+    group_allocation_infos.resize(indices.size());
+    VkResult vk_result = vmaAllocateMemoryPages(
+        _vma_allocator, &vk_group_memory_requirements,
+        &vma_allocation_create_infos[indices[0]], indices.size(),
+        group_allocations.data(), group_allocation_infos.data());
+    check(vk_result == VK_SUCCESS, "Failed to allocate memory");
+    for (size_t j = 0; j < indices.size(); j++) {
+      vma_allocations[indices[j]]      = group_allocations[j];
+      vma_allocation_infos[indices[j]] = group_allocation_infos[j];
+    }
+  }
+}
+
+bool context_t::is_memory_type_host_visible(uint32_t vk_memory_type) {
+  return _vkb_physical_device.memory_properties.memoryTypes[vk_memory_type]
+             .propertyFlags &
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
 void context_t::destroy_buffer(handle_buffer_t handle) {
   horizon_profile();
-  internal::buffer_t &buffer =
+  if (utils::assert_and_get_data<internal::buffer_t>(handle, _buffers).p_data)
+    unmap_buffer(handle);
+  internal::buffer_t buffer =
       utils::assert_and_get_data<internal::buffer_t>(handle, _buffers);
-  if (buffer.p_data) unmap_buffer(handle);
-  vmaDestroyBuffer(_vma_allocator, buffer, buffer.vma_allocation);
   _buffers.erase(handle);
+  defer_destruction([this, buffer]() {
+    untrack_allocation(_buffer_memory, buffer.memory_category,
+                       buffer.vk_allocation_size);
+    // memory that is part of a defragmentation pass is freed by the pass
+    if (abandon_defragmentation_move(buffer.vma_allocation))
+      vkDestroyBuffer(_vkb_device, buffer.vk_buffer, nullptr);
+    else
+      vmaDestroyBuffer(_vma_allocator, buffer.vk_buffer,
+                       buffer.vma_allocation);
+  });
 }
 
 void *context_t::map_buffer(handle_buffer_t handle) {
@@ -938,6 +1757,11 @@ internal::buffer_t &context_t::get_buffer(handle_buffer_t handle) {
   return utils::assert_and_get_data<internal::buffer_t>(handle, _buffers);
 }
 
+const config_buffer_t &context_t::get_buffer_config(handle_buffer_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_buffer_t>(handle, _buffers);
+}
+
 void context_t::flush_buffer(handle_buffer_t handle) {
   horizon_profile();
   auto buffer = get_buffer(handle);
@@ -946,17 +1770,14 @@ void context_t::flush_buffer(handle_buffer_t handle) {
 
 uint64_t context_t::get_total_buffer_memory_allocated() {
   horizon_profile();
-  uint64_t allocations = 0;
-  for (auto [handle, buffer] : _buffers) {
-    allocations += buffer.config.vk_size;
-  }
-  return allocations;
+  std::scoped_lock lock{_memory_stats_mutex};
+  return _buffer_memory.bytes;
 }
 
 handle_sampler_t context_t::create_sampler(const config_sampler_t &config) {
   horizon_profile();
 
-  internal::sampler_t sampler{.config = config};
+  internal::sampler_t sampler{};
   VkSamplerCreateInfo vk_sampler_create_info{
       .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
   vk_sampler_create_info.flags;
@@ -982,17 +1803,17 @@ handle_sampler_t context_t::create_sampler(const config_sampler_t &config) {
   check(vk_result == VK_SUCCESS, "Failed to create sampler");
 
   handle_sampler_t handle =
-      utils::create_and_insert_new_handle<handle_sampler_t>(_samplers, sampler);
+      utils::create_and_insert_new_handle<handle_sampler_t>(
+          _samplers, sampler, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_SAMPLER;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(sampler.vk_sampler);
-    vk_debug_utils_object_name_info.pObjectName =
-        sampler.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created sampler {}", sampler.config.debug_name);
+    horizon_trace("created sampler {}", config.debug_name);
   } else {
     horizon_trace("created sampler");
   }
@@ -1001,10 +1822,12 @@ handle_sampler_t context_t::create_sampler(const config_sampler_t &config) {
 
 void context_t::destroy_sampler(handle_sampler_t handle) {
   horizon_profile();
-  internal::sampler_t &sampler =
+  VkSampler vk_sampler =
       utils::assert_and_get_data<internal::sampler_t>(handle, _samplers);
-  vkDestroySampler(_vkb_device, sampler, nullptr);
   _samplers.erase(handle);
+  defer_destruction([this, vk_sampler]() {
+    vkDestroySampler(_vkb_device, vk_sampler, nullptr);
+  });
 }
 
 internal::sampler_t &context_t::get_sampler(handle_sampler_t handle) {
@@ -1012,13 +1835,14 @@ internal::sampler_t &context_t::get_sampler(handle_sampler_t handle) {
   return utils::assert_and_get_data<internal::sampler_t>(handle, _samplers);
 }
 
-handle_image_t context_t::create_image(const config_image_t &config) {
+const config_sampler_t &context_t::get_sampler_config(handle_sampler_t handle) {
   horizon_profile();
-  VkImageCreateInfo vk_image_create_info{
-      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
-  vk_image_create_info.imageType = config.vk_type;
-  vk_image_create_info.extent    = {config.vk_width, config.vk_height,
-                                    config.vk_depth};
+  return utils::assert_and_get_config<config_sampler_t>(handle, _samplers);
+}
+
+config_image_t context_t::resolve_image_config(const config_image_t &config) {
+  horizon_profile();
+  config_image_t config_image = config;
   if (config.vk_mips == vk_auto_calculate_mip_levels) {
     VkImageFormatProperties image_format_properties{};
     vkGetPhysicalDeviceImageFormatProperties(
@@ -1027,61 +1851,166 @@ handle_image_t context_t::create_image(const config_image_t &config) {
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
             VK_IMAGE_USAGE_SAMPLED_BIT,
         0, &image_format_properties);
-    vk_image_create_info.mipLevels =
+    config_image.vk_mips =
         static_cast<uint32_t>(std::floor(std::log2(std::max(
             std::max(config.vk_width, config.vk_height), config.vk_depth)))) +
         1;  // this might be wrong ?
-    vk_image_create_info.mipLevels = std::min(
-        image_format_properties.maxMipLevels, vk_image_create_info.mipLevels);
-  } else {
-    vk_image_create_info.mipLevels = config.vk_mips;
+    config_image.vk_mips =
+        std::min(image_format_properties.maxMipLevels, config_image.vk_mips);
   }
-  vk_image_create_info.arrayLayers   = config.vk_array_layers;
-  vk_image_create_info.format        = config.vk_format;
-  vk_image_create_info.tiling        = config.vk_tiling;
-  vk_image_create_info.initialLayout = config.vk_initial_layout;
-  vk_image_create_info.usage         = config.vk_usage;
-  vk_image_create_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
-  vk_image_create_info.samples       = config.vk_sample_count;
-  vk_image_create_info.flags         = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+  return config_image;
+}
+
+handle_image_t context_t::create_image(const config_image_t &config) {
+  horizon_profile();
+  config_image_t    config_image = resolve_image_config(config);
+  VkImageCreateInfo vk_image_create_info =
+      utils::image_create_info(config_image);
 
-  internal::image_t image{.config = config};
-  image.config.vk_mips = vk_image_create_info.mipLevels;
+  internal::image_t image{};
+  image.vk_image_aspect = utils::get_image_aspect(config.vk_format);
 
   VmaAllocationCreateInfo vma_allocation_create_info{};
   vma_allocation_create_info.usage = config.vma_memory_usage;
   vma_allocation_create_info.flags = config.vma_allocation_create_flags;
+  if (config.handle_memory_pool != core::null_handle)
+    vma_allocation_create_info.pool =
+        get_memory_pool(config.handle_memory_pool);
 
-  VkResult vk_result = vmaCreateImage(
+  VmaAllocationInfo vma_allocation_info;
+  VkResult          vk_result = vmaCreateImage(
       _vma_allocator, &vk_image_create_info, &vma_allocation_create_info,
-      &image.vk_image, &image.vma_allocation, nullptr);
+      &image.vk_image, &image.vma_allocation, &vma_allocation_info);
   check(vk_result == VK_SUCCESS, "Failed to create image");
+  image.vk_allocation_size = vma_allocation_info.size;
+  image.vk_memory_type     = vma_allocation_info.memoryType;
+  image.memory_category    = memory_category(config.debug_name);
+  track_allocation(_image_memory, image.memory_category,
+                   image.vk_allocation_size);
 
   handle_image_t handle =
-      utils::create_and_insert_new_handle<handle_image_t>(_images, image);
+      utils::create_and_insert_new_handle<handle_image_t>(_images, image,
+                                                          config_image);
+  vmaSetAllocationUserData(_vma_allocator, image.vma_allocation,
+                           utils::allocation_user_data(handle));
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_IMAGE;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(image.vk_image);
-    vk_debug_utils_object_name_info.pObjectName =
-        image.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created image {}", image.config.debug_name);
+    horizon_trace("created image {}", config.debug_name);
   } else {
     horizon_trace("created image");
   }
   return handle;
 }
 
+std::vector<handle_image_t> context_t::create_images(
+    std::span<const config_image_t> configs) {
+  horizon_profile();
+  size_t                               count = configs.size();
+  std::vector<internal::image_t>       images(count);
+  std::vector<config_image_t>          config_images(count);
+  std::vector<VkImageCreateInfo>       vk_image_create_infos(count);
+  std::vector<VkMemoryRequirements>    vk_memory_requirements(count);
+  std::vector<VmaAllocationCreateInfo> vma_allocation_create_infos(count);
+  std::vector<VmaAllocation>           vma_allocations(count);
+  std::vector<VmaAllocationInfo>       vma_allocation_infos(count);
+  for (size_t i = 0; i < count; i++) {
+    config_images[i]          = resolve_image_config(configs[i]);
+    vk_image_create_infos[i]  = utils::image_create_info(config_images[i]);
+    images[i].vk_image_aspect = utils::get_image_aspect(configs[i].vk_format);
+    VkResult vk_result = vkCreateImage(_vkb_device, &vk_image_create_infos[i],
+                                       nullptr, &images[i].vk_image);
+    check(vk_result == VK_SUCCESS, "Failed to create image");
+    vkGetImageMemoryRequirements(_vkb_device, images[i].vk_image,
+                                 &vk_memory_requirements[i]);
+    vma_allocation_create_infos[i].usage = configs[i].vma_memory_usage;
+    vma_allocation_create_infos[i].flags =
+        configs[i].vma_allocation_create_flags;
+    if (configs[i].handle_memory_pool != core::null_handle)
+      vma_allocation_create_infos[i].pool =
+          get_memory_pool(configs[i].handle_memory_pool);
+  }
+  allocate_memory_pages<VkImageCreateInfo>(
+      vk_image_create_infos, vk_memory_requirements,
+      vma_allocation_create_infos, vma_allocations, vma_allocation_infos);
+
+  // same split as create_buffers
+  std::vector<VkBindImageMemoryInfo> vk_bind_image_memory_infos;
+  for (size_t i = 0; i < count; i++) {
+    images[i].vma_allocation = vma_allocations[i];
+    if (is_memory_type_host_visible(vma_allocation_infos[i].memoryType)) {
+      VkResult vk_result = vmaBindImageMemory(
+          _vma_allocator, vma_allocations[i], images[i].vk_image);
+      check(vk_result == VK_SUCCESS, "Failed to bind image memory");
+      continue;
+    }
+    VkBindImageMemoryInfo vk_bind_image_memory_info{
+        .sType        = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO,
+        .image        = images[i].vk_image,
+        .memory       = vma_allocation_infos[i].deviceMemory,
+        .memoryOffset = vma_allocation_infos[i].offset};
+    vk_bind_image_memory_infos.push_back(vk_bind_image_memory_info);
+  }
+  if (!vk_bind_image_memory_infos.empty()) {
+    VkResult vk_result =
+        vkBindImageMemory2(_vkb_device, vk_bind_image_memory_infos.size(),
+                           vk_bind_image_memory_infos.data());
+    check(vk_result == VK_SUCCESS, "Failed to bind image memory");
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    internal::image_t &image = images[i];
+    image.vk_allocation_size = vma_allocation_infos[i].size;
+    image.vk_memory_type     = vma_allocation_infos[i].memoryType;
+    image.memory_category    = memory_category(configs[i].debug_name);
+    track_allocation(_image_memory, image.memory_category,
+                     image.vk_allocation_size);
+  }
+
+  std::vector<handle_image_t> handles =
+      _images.insert(std::span<const internal::image_t>{images},
+                     std::span<const config_image_t>{config_images});
+  for (size_t i = 0; i < count; i++) {
+    vmaSetAllocationUserData(_vma_allocator, images[i].vma_allocation,
+                             utils::allocation_user_data(handles[i]));
+    if (configs[i].debug_name == "") continue;
+    VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
+        VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
+    vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_IMAGE;
+    vk_debug_utils_object_name_info.objectHandle =
+        reinterpret_cast<uint64_t &>(images[i].vk_image);
+    vk_debug_utils_object_name_info.pObjectName = configs[i].debug_name.data();
+    vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
+  }
+  horizon_trace("created {} images", count);
+  return handles;
+}
+
 void context_t::destroy_image(handle_image_t handle) {
   horizon_profile();
-  internal::image_t &image =
+  if (utils::assert_and_get_data<internal::image_t>(handle, _images).p_data)
+    unmap_image(handle);
+  internal::image_t image =
       utils::assert_and_get_data<internal::image_t>(handle, _images);
-  if (image.p_data) unmap_image(handle);
-  vmaDestroyImage(_vma_allocator, image, image.vma_allocation);
   _images.erase(handle);
+  defer_destruction([this, image]() {
+    untrack_allocation(_image_memory, image.memory_category,
+                       image.vk_allocation_size);
+    // memory that is part of a defragmentation pass is freed by the pass,
+    // along with the destination of the move if it was not swapped in yet
+    VkImage vk_pending_image = VK_NULL_HANDLE;
+    if (abandon_defragmentation_move(image.vma_allocation, &vk_pending_image)) {
+      vkDestroyImage(_vkb_device, image.vk_image, nullptr);
+      vkDestroyImage(_vkb_device, vk_pending_image, nullptr);
+    } else {
+      vmaDestroyImage(_vma_allocator, image.vk_image, image.vma_allocation);
+    }
+  });
 }
 
 void *context_t::map_image(handle_image_t handle) {
@@ -1107,27 +2036,32 @@ internal::image_t &context_t::get_image(handle_image_t handle) {
   return utils::assert_and_get_data<internal::image_t>(handle, _images);
 }
 
+const config_image_t &context_t::get_image_config(handle_image_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_image_t>(handle, _images);
+}
+
 void context_t::flush_image(handle_image_t handle) {
   horizon_profile();
   auto image = get_image(handle);
   vmaFlushAllocation(_vma_allocator, image.vma_allocation, 0, VK_WHOLE_SIZE);
 }
 
-handle_image_view_t context_t::create_image_view(
+VkImageViewCreateInfo context_t::image_view_create_info(
     const config_image_view_t &config) {
   horizon_profile();
   internal::image_t &image = utils::assert_and_get_data<internal::image_t>(
       config.handle_image, _images);
-
-  internal::image_view_t image_view{.config = config};
+  config_image_t &config_image = utils::assert_and_get_config<config_image_t>(
+      config.handle_image, _images);
 
   VkImageViewType vk_image_view_type;
   if (config.vk_image_view_type == vk_auto_image_view_type) {
-    if (image.config.vk_type == VkImageType::VK_IMAGE_TYPE_1D)
+    if (config_image.vk_type == VkImageType::VK_IMAGE_TYPE_1D)
       vk_image_view_type = VkImageViewType::VK_IMAGE_VIEW_TYPE_1D;
-    if (image.config.vk_type == VkImageType::VK_IMAGE_TYPE_2D)
+    if (config_image.vk_type == VkImageType::VK_IMAGE_TYPE_2D)
       vk_image_view_type = VkImageViewType::VK_IMAGE_VIEW_TYPE_2D;
-    if (image.config.vk_type == VkImageType::VK_IMAGE_TYPE_3D)
+    if (config_image.vk_type == VkImageType::VK_IMAGE_TYPE_3D)
       vk_image_view_type = VkImageViewType::VK_IMAGE_VIEW_TYPE_3D;
   } else {
     vk_image_view_type = config.vk_image_view_type;
@@ -1138,41 +2072,48 @@ handle_image_view_t context_t::create_image_view(
   vk_image_view_create_info.image    = image;
   vk_image_view_create_info.viewType = vk_image_view_type;
   vk_image_view_create_info.format   = config.vk_format == vk_auto_image_format
-                                           ? image.config.vk_format
+                                           ? config_image.vk_format
                                            : config.vk_format;
-  vk_image_view_create_info.subresourceRange.aspectMask =
-      utils::get_image_aspect(image.config.vk_format);
+  vk_image_view_create_info.subresourceRange.aspectMask = image.vk_image_aspect;
   vk_image_view_create_info.subresourceRange.baseMipLevel =
       config.vk_base_mip_level;  // default base mip is 0 automatically, and for
                                  // custom it already has the value
   vk_image_view_create_info.subresourceRange.levelCount =
-      config.vk_mips == vk_auto_mips ? image.config.vk_mips : config.vk_mips;
+      config.vk_mips == vk_auto_mips ? config_image.vk_mips : config.vk_mips;
   vk_image_view_create_info.subresourceRange.baseArrayLayer =
       config
           .vk_base_array_layer;  // default base array layer is 0 automatically,
                                  // and for custom it already has the value
   vk_image_view_create_info.subresourceRange.layerCount =
-      config.vk_layers == vk_auto_layers ? image.config.vk_array_layers
+      config.vk_layers == vk_auto_layers ? config_image.vk_array_layers
                                          : config.vk_layers;
+  return vk_image_view_create_info;
+}
 
-  VkResult vk_result =
+handle_image_view_t context_t::create_image_view(
+    const config_image_view_t &config) {
+  horizon_profile();
+  internal::image_view_t image_view{};
+
+  VkImageViewCreateInfo vk_image_view_create_info =
+      image_view_create_info(config);
+  VkResult              vk_result =
       vkCreateImageView(_vkb_device, &vk_image_view_create_info, nullptr,
                         &image_view.vk_image_view);
   check(vk_result == VK_SUCCESS, "Failed to create image view");
 
   handle_image_view_t handle =
-      utils::create_and_insert_new_handle<handle_image_view_t>(_image_views,
-                                                               image_view);
+      utils::create_and_insert_new_handle<handle_image_view_t>(
+          _image_views, image_view, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_IMAGE_VIEW;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(image_view.vk_image_view);
-    vk_debug_utils_object_name_info.pObjectName =
-        image_view.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created image view {}", image_view.config.debug_name);
+    horizon_trace("created image view {}", config.debug_name);
   } else {
     horizon_trace("created image view");
   }
@@ -1181,10 +2122,12 @@ handle_image_view_t context_t::create_image_view(
 
 void context_t::destroy_image_view(handle_image_view_t handle) {
   horizon_profile();
-  internal::image_view_t &image_view =
+  VkImageView vk_image_view =
       utils::assert_and_get_data<internal::image_view_t>(handle, _image_views);
-  vkDestroyImageView(_vkb_device, image_view, nullptr);
   _image_views.erase(handle);
+  defer_destruction([this, vk_image_view]() {
+    vkDestroyImageView(_vkb_device, vk_image_view, nullptr);
+  });
 }
 
 internal::image_view_t &context_t::get_image_view(handle_image_view_t handle) {
@@ -1193,10 +2136,520 @@ internal::image_view_t &context_t::get_image_view(handle_image_view_t handle) {
                                                             _image_views);
 }
 
+const config_image_view_t &context_t::get_image_view_config(
+    handle_image_view_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_image_view_t>(handle,
+                                                           _image_views);
+}
+
+memory_stats_t context_t::get_memory_stats(bool detailed) {
+  horizon_profile();
+  memory_stats_t memory_stats{};
+  {
+    std::scoped_lock lock{_memory_stats_mutex};
+    memory_stats.buffers = _buffer_memory;
+    memory_stats.images  = _image_memory;
+    for (uint32_t i = 0; i < _memory_categories.size(); i++)
+      memory_stats.categories[_memory_category_names[i]] =
+          _memory_categories[i];
+  }
+
+  const VkPhysicalDeviceMemoryProperties *p_vk_memory_properties;
+  vmaGetMemoryProperties(_vma_allocator, &p_vk_memory_properties);
+  std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> vma_budgets;
+  vmaGetHeapBudgets(_vma_allocator, vma_budgets.data());
+  for (uint32_t i = 0; i < p_vk_memory_properties->memoryHeapCount; i++) {
+    const VmaBudget &vma_budget = vma_budgets[i];
+    memory_stats.heaps.push_back(
+        {.vk_memory_heap_flags =
+             p_vk_memory_properties->memoryHeaps[i].flags,
+         .budget           = vma_budget.budget,
+         .usage            = vma_budget.usage,
+         .block_bytes      = vma_budget.statistics.blockBytes,
+         .allocation_bytes = vma_budget.statistics.allocationBytes,
+         .block_count      = vma_budget.statistics.blockCount,
+         .allocation_count = vma_budget.statistics.allocationCount});
+  }
+
+  if (detailed) {
+    VmaTotalStatistics vma_total_statistics;
+    vmaCalculateStatistics(_vma_allocator, &vma_total_statistics);
+    memory_stats.vma_detailed_statistics = vma_total_statistics.total;
+  }
+  return memory_stats;
+}
+
+std::string context_t::get_memory_stats_json(bool detailed) {
+  horizon_profile();
+  memory_stats_t memory_stats = get_memory_stats(detailed);
+  auto counter_json = [](const memory_counter_t &counter) {
+    return std::format(R"({{"count":{},"bytes":{},"peak_bytes":{}}})",
+                       counter.count, counter.bytes, counter.peak_bytes);
+  };
+  std::string json =
+      std::format(R"({{"buffers":{},"images":{},"categories":{{)",
+                  counter_json(memory_stats.buffers),
+                  counter_json(memory_stats.images));
+  bool first = true;
+  for (auto &[name, counter] : memory_stats.categories) {
+    json += std::format(R"({}"{}":{})", first ? "" : ",",
+                        utils::json_escape(name), counter_json(counter));
+    first = false;
+  }
+  json += R"(},"heaps":[)";
+  for (uint32_t i = 0; i < memory_stats.heaps.size(); i++) {
+    const memory_heap_stats_t &heap = memory_stats.heaps[i];
+    json += std::format(
+        R"({}{{"device_local":{},"budget":{},"usage":{},"block_bytes":{},)"
+        R"("allocation_bytes":{},"block_count":{},"allocation_count":{}}})",
+        i ? "," : "",
+        (heap.vk_memory_heap_flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+        heap.budget, heap.usage, heap.block_bytes, heap.allocation_bytes,
+        heap.block_count, heap.allocation_count);
+  }
+  json += "]";
+  if (memory_stats.vma_detailed_statistics) {
+    const VmaDetailedStatistics &vma_detailed_statistics =
+        *memory_stats.vma_detailed_statistics;
+    json += std::format(
+        R"(,"total":{{"block_bytes":{},"allocation_bytes":{},)"
+        R"("unused_range_count":{},"allocation_size_max":{},)"
+        R"("unused_range_size_max":{}}})",
+        vma_detailed_statistics.statistics.blockBytes,
+        vma_detailed_statistics.statistics.allocationBytes,
+        vma_detailed_statistics.unusedRangeCount,
+        vma_detailed_statistics.allocationSizeMax,
+        vma_detailed_statistics.unusedRangeSizeMax);
+    char *p_vma_stats;
+    vmaBuildStatsString(_vma_allocator, &p_vma_stats, VK_TRUE);
+    json += std::format(R"(,"vma":{})", p_vma_stats);
+    vmaFreeStatsString(_vma_allocator, p_vma_stats);
+  }
+  json += "}";
+  return json;
+}
+
+void context_t::refresh_memory_budget(uint32_t frame_index) {
+  horizon_profile();
+  vmaSetCurrentFrameIndex(_vma_allocator, frame_index);
+}
+
+bool context_t::has_memory_budget() { return _vk_memory_budget; }
+
+void context_t::begin_defragmentation(const config_defragmentation_t &config) {
+  horizon_profile();
+  std::scoped_lock lock{_defragmentation_mutex};
+  check(_defragmentation.vma_defragmentation_context == VK_NULL_HANDLE,
+        "defragmentation already in progress");
+  VmaDefragmentationInfo vma_defragmentation_info{};
+  vma_defragmentation_info.flags = config.vma_defragmentation_flags;
+  if (config.handle_memory_pool != core::null_handle)
+    vma_defragmentation_info.pool =
+        get_memory_pool(config.handle_memory_pool);
+  vma_defragmentation_info.maxBytesPerPass = config.vk_max_bytes_per_pass;
+  vma_defragmentation_info.maxAllocationsPerPass =
+      config.max_allocations_per_pass;
+  VkResult vk_result =
+      vmaBeginDefragmentation(_vma_allocator, &vma_defragmentation_info,
+                              &_defragmentation.vma_defragmentation_context);
+  if (vk_result != VK_SUCCESS) {
+    // pools using the linear algorithm cannot be defragmented
+    horizon_warn("Failed to begin defragmentation");
+    _defragmentation.vma_defragmentation_context = VK_NULL_HANDLE;
+    return;
+  }
+  horizon_trace("began defragmentation");
+}
+
+/*
+ * a pass goes through three steps, each once the previous one is safe
+ * - copying, every movable allocation vma wants moved gets a new buffer or
+ *   image bound to its destination and a copy on the graphics queue
+ * - releasing, movable resources are only read by the device, so they are
+ *   swapped in once the copies completed and frames in between keep reading
+ *   the old ones. views are recreated and buffer descriptors rewritten, the
+ *   old handles are destroyed by retirement ticket
+ * - the pass ends once every command buffer recorded before the swap
+ *   retired, vma then frees the old memory
+ */
+defragmentation_step_t context_t::defragment_step() {
+  horizon_profile();
+  std::scoped_lock       lock{_defragmentation_mutex};
+  defragmentation_step_t step{};
+  if (_defragmentation.vma_defragmentation_context == VK_NULL_HANDLE)
+    return step;
+  if (_defragmentation.stage == defragmentation_stage_t::e_copying) {
+    if (completed_serial() < _defragmentation.copy_serial) return step;
+    swap_defragmented_resources(step);
+  }
+  bool has_moves = true;
+  if (_defragmentation.stage == defragmentation_stage_t::e_releasing) {
+    if (_defragmentation.release_ticket &&
+        !is_retired(*_defragmentation.release_ticket))
+      return step;
+    has_moves = end_defragmentation_pass() == VK_INCOMPLETE;
+  }
+  if (has_moves) has_moves = begin_defragmentation_pass();
+  if (!has_moves) {
+    VmaDefragmentationStats vma_defragmentation_stats{};
+    vmaEndDefragmentation(_vma_allocator,
+                          _defragmentation.vma_defragmentation_context,
+                          &vma_defragmentation_stats);
+    _defragmentation.vma_defragmentation_context = VK_NULL_HANDLE;
+    horizon_trace("defragmentation moved {} bytes and freed {} bytes",
+                  vma_defragmentation_stats.bytesMoved,
+                  vma_defragmentation_stats.bytesFreed);
+  }
+  return step;
+}
+
+void context_t::set_image_movable(handle_image_t handle, bool movable) {
+  horizon_profile();
+  // defragment_step reads the flag while picking moves
+  std::scoped_lock lock{_defragmentation_mutex};
+  utils::assert_and_get_data<internal::image_t>(handle, _images).movable =
+      movable;
+}
+
+void context_t::set_buffer_movable(handle_buffer_t handle, bool movable) {
+  horizon_profile();
+  const config_buffer_t &config =
+      utils::assert_and_get_config<config_buffer_t>(handle, _buffers);
+  VkBufferUsageFlags vk_usage = utils::buffer_create_info(config).usage;
+  check(!movable || (vk_usage & utils::movable_buffer_usage_flags) ==
+                        utils::movable_buffer_usage_flags,
+        "buffer {} needs transfer src and dst usage to be movable", handle);
+  // defragment_step reads the flag while picking moves
+  std::scoped_lock lock{_defragmentation_mutex};
+  utils::assert_and_get_data<internal::buffer_t>(handle, _buffers).movable =
+      movable;
+}
+
+bool context_t::is_defragmenting() {
+  horizon_profile();
+  std::scoped_lock lock{_defragmentation_mutex};
+  return _defragmentation.vma_defragmentation_context != VK_NULL_HANDLE;
+}
+
+bool context_t::begin_defragmentation_pass() {
+  horizon_profile();
+  VmaDefragmentationPassMoveInfo &vma_pass_move_info =
+      _defragmentation.vma_pass_move_info;
+  VkResult vk_result = vmaBeginDefragmentationPass(
+      _vma_allocator, _defragmentation.vma_defragmentation_context,
+      &vma_pass_move_info);
+  // success means there is nothing left to move
+  if (vk_result == VK_SUCCESS) return false;
+  check(vk_result == VK_INCOMPLETE, "Failed to begin defragmentation pass");
+  _defragmentation.moves.assign(vma_pass_move_info.moveCount, {});
+
+  std::set<handle_buffer_t> pinned_buffers = descriptor_pinned_buffers();
+
+  std::vector<VkImageMemoryBarrier> vk_pre_copy_barriers;
+  std::vector<VkImageMemoryBarrier> vk_post_copy_barriers;
+  uint32_t                          copies = 0;
+  for (uint32_t i = 0; i < vma_pass_move_info.moveCount; i++) {
+    VmaDefragmentationMove &vma_move = vma_pass_move_info.pMoves[i];
+    defragmentation_move_t &move     = _defragmentation.moves[i];
+    // left in place unless one of the cases below can copy it
+    vma_move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+    VmaAllocationInfo vma_allocation_info;
+    vmaGetAllocationInfo(_vma_allocator, vma_move.srcAllocation,
+                         &vma_allocation_info);
+    core::handle_t handle =
+        utils::allocation_handle(vma_allocation_info.pUserData);
+    // a handle already destroyed, or one reused since, is left in place
+    if (_buffers.contains(handle) &&
+        _buffers.get(handle).vma_allocation == vma_move.srcAllocation) {
+      // mapped buffers may be written through their old pointer any time
+      if (_buffers.get(handle).p_data || !_buffers.get(handle).movable ||
+          pinned_buffers.contains(handle))
+        continue;
+      VkBufferCreateInfo vk_buffer_create_info =
+          utils::buffer_create_info(_buffers.get_cold(handle));
+      vk_result = vkCreateBuffer(_vkb_device, &vk_buffer_create_info, nullptr,
+                                 &move.vk_buffer);
+      check(vk_result == VK_SUCCESS, "Failed to create buffer");
+      vk_result = vmaBindBufferMemory(_vma_allocator, vma_move.dstTmpAllocation,
+                                      move.vk_buffer);
+      check(vk_result == VK_SUCCESS, "Failed to bind buffer memory");
+      move.handle_buffer = handle;
+    } else if (_images.contains(handle) &&
+               _images.get(handle).vma_allocation == vma_move.srcAllocation) {
+      const config_image_t &config_image = _images.get_cold(handle);
+      if (_images.get(handle).p_data || !_images.get(handle).movable ||
+          !utils::is_image_movable(config_image))
+        continue;
+      VkImageCreateInfo vk_image_create_info =
+          utils::image_create_info(config_image);
+      vk_image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      vk_result = vkCreateImage(_vkb_device, &vk_image_create_info, nullptr,
+                                &move.vk_image);
+      check(vk_result == VK_SUCCESS, "Failed to create image");
+      vk_result = vmaBindImageMemory(_vma_allocator, vma_move.dstTmpAllocation,
+                                     move.vk_image);
+      check(vk_result == VK_SUCCESS, "Failed to bind image memory");
+      move.handle_image = handle;
+
+      VkImageMemoryBarrier vk_barrier{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+      vk_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      vk_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      vk_barrier.subresourceRange = {_images.get(handle).vk_image_aspect, 0,
+                                     VK_REMAINING_MIP_LEVELS, 0,
+                                     VK_REMAINING_ARRAY_LAYERS};
+      // the old image goes back to shader reads once copied from, frames
+      // keep sampling it until the new one is swapped in
+      vk_barrier.image         = _images.get(handle);
+      vk_barrier.oldLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      vk_barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      vk_barrier.srcAccessMask = 0;
+      vk_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      vk_pre_copy_barriers.push_back(vk_barrier);
+      std::swap(vk_barrier.oldLayout, vk_barrier.newLayout);
+      vk_barrier.srcAccessMask = 0;
+      vk_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      vk_post_copy_barriers.push_back(vk_barrier);
+      vk_barrier.image         = move.vk_image;
+      vk_barrier.oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+      vk_barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      vk_barrier.srcAccessMask = 0;
+      vk_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      vk_pre_copy_barriers.push_back(vk_barrier);
+      vk_barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      vk_barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      vk_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      vk_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      vk_post_copy_barriers.push_back(vk_barrier);
+    } else {
+      continue;
+    }
+    vma_move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_COPY;
+    copies++;
+  }
+
+  if (copies == 0) {
+    // nothing vma picked can be moved, the pass ends on the next step
+    _defragmentation.stage          = defragmentation_stage_t::e_releasing;
+    _defragmentation.release_ticket = std::nullopt;
+    return true;
+  }
+
+  handle_commandbuffer_t handle_commandbuffer = acquire_commandbuffer();
+  begin_commandbuffer(handle_commandbuffer, true);
+  VkCommandBuffer vk_commandbuffer = get_commandbuffer(handle_commandbuffer);
+  // earlier work on the queue may still write what is about to be copied
+  VkMemoryBarrier vk_memory_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  vk_memory_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+  vk_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(vk_commandbuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                       &vk_memory_barrier, 0, nullptr,
+                       vk_pre_copy_barriers.size(),
+                       vk_pre_copy_barriers.data());
+  for (defragmentation_move_t &move : _defragmentation.moves) {
+    if (move.vk_buffer != VK_NULL_HANDLE) {
+      VkBufferCopy vk_buffer_copy{
+          .srcOffset = 0,
+          .dstOffset = 0,
+          .size      = _buffers.get_cold(move.handle_buffer).vk_size};
+      vkCmdCopyBuffer(vk_commandbuffer, _buffers.get(move.handle_buffer),
+                      move.vk_buffer, 1, &vk_buffer_copy);
+    } else if (move.vk_image != VK_NULL_HANDLE) {
+      internal::image_t    &image        = _images.get(move.handle_image);
+      const config_image_t &config_image = _images.get_cold(move.handle_image);
+      std::vector<VkImageCopy> vk_image_copies;
+      for (uint32_t mip = 0; mip < config_image.vk_mips; mip++) {
+        VkImageSubresourceLayers vk_subresource{
+            image.vk_image_aspect, mip, 0, config_image.vk_array_layers};
+        vk_image_copies.push_back(
+            {.srcSubresource = vk_subresource,
+             .srcOffset      = {0, 0, 0},
+             .dstSubresource = vk_subresource,
+             .dstOffset      = {0, 0, 0},
+             .extent         = {std::max(config_image.vk_width >> mip, 1u),
+                                std::max(config_image.vk_height >> mip, 1u),
+                                std::max(config_image.vk_depth >> mip, 1u)}});
+      }
+      vkCmdCopyImage(vk_commandbuffer, image,
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, move.vk_image,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     vk_image_copies.size(), vk_image_copies.data());
+    }
+  }
+  // later submissions are in the second scope, they see the copies
+  vk_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vk_memory_barrier.dstAccessMask =
+      VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+  vkCmdPipelineBarrier(vk_commandbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1,
+                       &vk_memory_barrier, 0, nullptr,
+                       vk_post_copy_barriers.size(),
+                       vk_post_copy_barriers.data());
+  end_commandbuffer(handle_commandbuffer);
+  _defragmentation.copy_serial =
+      submit({.handle_commandbuffers = {handle_commandbuffer}});
+  _defragmentation.stage = defragmentation_stage_t::e_copying;
+  horizon_trace("defragmentation pass copies {} allocations", copies);
+  return true;
+}
+
+void context_t::swap_defragmented_resources(defragmentation_step_t &step) {
+  horizon_profile();
+  std::set<handle_buffer_t> pinned_buffers = descriptor_pinned_buffers();
+  std::set<handle_buffer_t> moved_buffers;
+  for (size_t i = 0; i < _defragmentation.moves.size(); i++) {
+    defragmentation_move_t &move = _defragmentation.moves[i];
+    // destroyed since, the pass cleans up after it
+    if (move.vk_buffer == VK_NULL_HANDLE ||
+        !_buffers.contains(move.handle_buffer))
+      continue;
+    // written into a set that cannot be rewritten while the copy ran, the
+    // buffer stays where it is and the copy is thrown away
+    if (pinned_buffers.contains(move.handle_buffer)) {
+      _defragmentation.vma_pass_move_info.pMoves[i].operation =
+          VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+      vkDestroyBuffer(_vkb_device, move.vk_buffer, nullptr);
+      move.vk_buffer = VK_NULL_HANDLE;
+      continue;
+    }
+    internal::buffer_t &buffer        = _buffers.get(move.handle_buffer);
+    VkBuffer            vk_old_buffer = buffer.vk_buffer;
+    buffer.vk_buffer                  = move.vk_buffer;
+    move.vk_buffer                    = VK_NULL_HANDLE;
+    VkBufferDeviceAddressInfo vk_buffer_device_address_info{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
+    vk_buffer_device_address_info.buffer = buffer;
+    buffer.vk_device_address =
+        vkGetBufferDeviceAddress(_vkb_device, &vk_buffer_device_address_info);
+    // only the VkBuffer, its memory is freed when the pass ends
+    defer_destruction([this, vk_old_buffer]() {
+      vkDestroyBuffer(_vkb_device, vk_old_buffer, nullptr);
+    });
+    moved_buffers.insert(move.handle_buffer);
+    step.moved_buffers.push_back(move.handle_buffer);
+  }
+  // every set still holding a moved buffer comes from an update after bind
+  // layout, so work in flight does not mind the rewrite
+  std::vector<VkDescriptorBufferInfo> vk_buffer_infos;
+  std::vector<VkWriteDescriptorSet>   vk_writes;
+  for (auto &[key, write] : _descriptor_buffer_writes) {
+    auto [handle_descriptor_set, binding, array_element] = key;
+    if (!moved_buffers.contains(write.handle_buffer) ||
+        !_descriptor_sets.contains(handle_descriptor_set))
+      continue;
+    vk_buffer_infos.push_back({.buffer = _buffers.get(write.handle_buffer),
+                               .offset = write.vk_offset,
+                               .range  = write.vk_range});
+    VkWriteDescriptorSet vk_write{.sType =
+                                      VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    vk_write.dstSet          = _descriptor_sets.get(handle_descriptor_set);
+    vk_write.dstBinding      = binding;
+    vk_write.dstArrayElement = array_element;
+    vk_write.descriptorCount = 1;
+    vk_write.descriptorType  = write.vk_descriptor_type;
+    vk_writes.push_back(vk_write);
+  }
+  // pointers are taken once vk_buffer_infos stopped growing
+  for (size_t i = 0; i < vk_writes.size(); i++)
+    vk_writes[i].pBufferInfo = &vk_buffer_infos[i];
+  if (!vk_writes.empty())
+    vkUpdateDescriptorSets(_vkb_device, vk_writes.size(), vk_writes.data(), 0,
+                           nullptr);
+
+  std::set<handle_image_t> moved_images;
+  for (defragmentation_move_t &move : _defragmentation.moves) {
+    // destroyed since, the pass cleans up after it
+    if (move.vk_image == VK_NULL_HANDLE || !_images.contains(move.handle_image))
+      continue;
+    internal::image_t &image        = _images.get(move.handle_image);
+    VkImage            vk_old_image = image.vk_image;
+    image.vk_image                  = move.vk_image;
+    move.vk_image                   = VK_NULL_HANDLE;
+    defer_destruction([this, vk_old_image]() {
+      vkDestroyImage(_vkb_device, vk_old_image, nullptr);
+    });
+    moved_images.insert(move.handle_image);
+    step.moved_images.push_back(move.handle_image);
+  }
+  for (auto [handle, image_view] : _image_views) {
+    const config_image_view_t &config = _image_views.get_cold(handle);
+    if (!moved_images.contains(config.handle_image)) continue;
+    defer_destruction([this, vk_image_view = image_view.vk_image_view]() {
+      vkDestroyImageView(_vkb_device, vk_image_view, nullptr);
+    });
+    VkImageViewCreateInfo vk_image_view_create_info =
+        image_view_create_info(config);
+    VkResult              vk_result =
+        vkCreateImageView(_vkb_device, &vk_image_view_create_info, nullptr,
+                          &image_view.vk_image_view);
+    check(vk_result == VK_SUCCESS, "Failed to create image view");
+    step.moved_image_views.push_back(handle);
+  }
+  // command buffers recorded up to now may still read the old resources
+  _defragmentation.stage          = defragmentation_stage_t::e_releasing;
+  _defragmentation.release_ticket = retirement_ticket();
+}
+
+std::set<handle_buffer_t> context_t::descriptor_pinned_buffers() {
+  horizon_profile();
+  // a set from a layout without use_bindless cannot be rewritten while a
+  // frame may still use it, so the buffers in it have to stay in place
+  std::set<handle_buffer_t> pinned_buffers;
+  for (auto &[key, write] : _descriptor_buffer_writes) {
+    handle_descriptor_set_t handle_descriptor_set = std::get<0>(key);
+    if (!_descriptor_sets.contains(handle_descriptor_set)) continue;
+    handle_descriptor_set_layout_t handle_descriptor_set_layout =
+        _descriptor_sets.get(handle_descriptor_set)
+            .handle_descriptor_set_layout;
+    if (!_descriptor_set_layouts.contains(handle_descriptor_set_layout) ||
+        !_descriptor_set_layouts.get_cold(handle_descriptor_set_layout)
+             .use_bindless)
+      pinned_buffers.insert(write.handle_buffer);
+  }
+  return pinned_buffers;
+}
+
+VkResult context_t::end_defragmentation_pass() {
+  horizon_profile();
+  VkResult vk_result = vmaEndDefragmentationPass(
+      _vma_allocator, _defragmentation.vma_defragmentation_context,
+      &_defragmentation.vma_pass_move_info);
+  // destinations of resources destroyed before they could be swapped in
+  for (defragmentation_move_t &move : _defragmentation.moves) {
+    if (move.vk_buffer != VK_NULL_HANDLE)
+      vkDestroyBuffer(_vkb_device, move.vk_buffer, nullptr);
+    if (move.vk_image != VK_NULL_HANDLE)
+      vkDestroyImage(_vkb_device, move.vk_image, nullptr);
+  }
+  _defragmentation.moves.clear();
+  _defragmentation.stage = defragmentation_stage_t::e_idle;
+  return vk_result;
+}
+
+bool context_t::abandon_defragmentation_move(VmaAllocation vma_allocation,
+                                             VkImage      *p_vk_image) {
+  horizon_profile();
+  std::scoped_lock lock{_defragmentation_mutex};
+  for (size_t i = 0; i < _defragmentation.moves.size(); i++) {
+    VmaDefragmentationMove &vma_move =
+        _defragmentation.vma_pass_move_info.pMoves[i];
+    if (vma_move.srcAllocation != vma_allocation) continue;
+    vma_move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+    if (p_vk_image) {
+      *p_vk_image                        = _defragmentation.moves[i].vk_image;
+      _defragmentation.moves[i].vk_image = VK_NULL_HANDLE;
+    }
+    return true;
+  }
+  return false;
+}
+
 handle_descriptor_set_layout_t context_t::create_descriptor_set_layout(
     const config_descriptor_set_layout_t &config) {
   horizon_profile();
-  internal::descriptor_set_layout_t descriptor_set_layout{.config = config};
+  internal::descriptor_set_layout_t descriptor_set_layout{};
 
   std::vector<VkDescriptorBindingFlags> vk_descriptor_binding_flags;
   VkDescriptorSetLayoutBindingFlagsCreateInfoEXT
@@ -1233,9 +2686,27 @@ handle_descriptor_set_layout_t context_t::create_descriptor_set_layout(
       &descriptor_set_layout.vk_descriptor_set_layout);
   check(vk_result == VK_SUCCESS, "Failed to create descriptor set layout");
 
+  for (const VkDescriptorSetLayoutBinding &vk_descriptor_set_layout_binding :
+       config.vk_descriptor_set_layout_bindings) {
+    auto itr = std::find_if(
+        descriptor_set_layout.vk_pool_sizes.begin(),
+        descriptor_set_layout.vk_pool_sizes.end(),
+        [&](const VkDescriptorPoolSize &vk_pool_size) {
+          return vk_pool_size.type ==
+                 vk_descriptor_set_layout_binding.descriptorType;
+        });
+    if (itr == descriptor_set_layout.vk_pool_sizes.end())
+      descriptor_set_layout.vk_pool_sizes.push_back(
+          {.type = vk_descriptor_set_layout_binding.descriptorType,
+           .descriptorCount =
+               vk_descriptor_set_layout_binding.descriptorCount});
+    else
+      itr->descriptorCount += vk_descriptor_set_layout_binding.descriptorCount;
+  }
+
   handle_descriptor_set_layout_t handle =
       utils::create_and_insert_new_handle<handle_descriptor_set_layout_t>(
-          _descriptor_set_layouts, descriptor_set_layout);
+          _descriptor_set_layouts, descriptor_set_layout, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
@@ -1243,11 +2714,9 @@ handle_descriptor_set_layout_t context_t::create_descriptor_set_layout(
         VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT;
     vk_debug_utils_object_name_info.objectHandle = reinterpret_cast<uint64_t &>(
         descriptor_set_layout.vk_descriptor_set_layout);
-    vk_debug_utils_object_name_info.pObjectName =
-        descriptor_set_layout.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created descriptor set layout {}",
-                  descriptor_set_layout.config.debug_name);
+    horizon_trace("created descriptor set layout {}", config.debug_name);
   } else {
     horizon_trace("created descriptor set layout");
   }
@@ -1257,11 +2726,14 @@ handle_descriptor_set_layout_t context_t::create_descriptor_set_layout(
 void context_t::destroy_descriptor_set_layout(
     handle_descriptor_set_layout_t handle) {
   horizon_profile();
-  internal::descriptor_set_layout_t &descriptor_set_layout =
+  VkDescriptorSetLayout vk_descriptor_set_layout =
       utils::assert_and_get_data<internal::descriptor_set_layout_t>(
           handle, _descriptor_set_layouts);
-  vkDestroyDescriptorSetLayout(_vkb_device, descriptor_set_layout, nullptr);
   _descriptor_set_layouts.erase(handle);
+  defer_destruction([this, vk_descriptor_set_layout]() {
+    vkDestroyDescriptorSetLayout(_vkb_device, vk_descriptor_set_layout,
+                                 nullptr);
+  });
 }
 
 internal::descriptor_set_layout_t &context_t::get_descriptor_set_layout(
@@ -1271,10 +2743,27 @@ internal::descriptor_set_layout_t &context_t::get_descriptor_set_layout(
       handle, _descriptor_set_layouts);
 }
 
+const config_descriptor_set_layout_t &
+context_t::get_descriptor_set_layout_config(
+    handle_descriptor_set_layout_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_descriptor_set_layout_t>(
+      handle, _descriptor_set_layouts);
+}
+
 handle_descriptor_set_t context_t::allocate_descriptor_set(
     const config_descriptor_set_t &config) {
   horizon_profile();
-  internal::descriptor_set_t descriptor_set{.config = config};
+  return allocate_descriptor_set(config, *_descriptor_allocator);
+}
+
+handle_descriptor_set_t context_t::allocate_descriptor_set(
+    const config_descriptor_set_t &config,
+    descriptor_allocator_t        &descriptor_allocator) {
+  horizon_profile();
+  internal::descriptor_set_t descriptor_set{
+      .handle_descriptor_set_layout = config.handle_descriptor_set_layout,
+      .p_descriptor_allocator       = &descriptor_allocator};
 
   internal::descriptor_set_layout_t &descriptor_set_layout =
       utils::assert_and_get_data<internal::descriptor_set_layout_t>(
@@ -1282,14 +2771,15 @@ handle_descriptor_set_t context_t::allocate_descriptor_set(
 
   VkDescriptorSetAllocateInfo vk_descriptor_set_allocate_info{
       .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
-  vk_descriptor_set_allocate_info.descriptorPool     = _vk_descriptor_pool;
   vk_descriptor_set_allocate_info.descriptorSetCount = 1;
   vk_descriptor_set_allocate_info.pSetLayouts =
       &descriptor_set_layout.vk_descriptor_set_layout;
 
   uint32_t descriptor_count = std::min(
       size_t(1),
-      descriptor_set_layout.config.vk_descriptor_set_layout_bindings.size());
+      utils::assert_and_get_config<config_descriptor_set_layout_t>(
+          config.handle_descriptor_set_layout, _descriptor_set_layouts)
+          .vk_descriptor_set_layout_bindings.size());
 
   VkDescriptorSetVariableDescriptorCountAllocateInfo
       vk_descriptor_set_variable_descriptor_count_allocate_info{
@@ -1301,25 +2791,22 @@ handle_descriptor_set_t context_t::allocate_descriptor_set(
   vk_descriptor_set_allocate_info.pNext =
       &vk_descriptor_set_variable_descriptor_count_allocate_info;
 
-  VkResult vk_result =
-      vkAllocateDescriptorSets(_vkb_device, &vk_descriptor_set_allocate_info,
-                               &descriptor_set.vk_descriptor_set);
-  check(vk_result == VK_SUCCESS, "Failed to allocate descriptor set");
+  descriptor_set.vk_descriptor_set = descriptor_allocator.allocate(
+      vk_descriptor_set_allocate_info, descriptor_set_layout.vk_pool_sizes,
+      &descriptor_set.vk_descriptor_pool);
 
   handle_descriptor_set_t handle =
       utils::create_and_insert_new_handle<handle_descriptor_set_t>(
-          _descriptor_sets, descriptor_set);
+          _descriptor_sets, descriptor_set, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_DESCRIPTOR_SET;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(descriptor_set.vk_descriptor_set);
-    vk_debug_utils_object_name_info.pObjectName =
-        descriptor_set.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("allocated descriptor set {}",
-                  descriptor_set.config.debug_name);
+    horizon_trace("allocated descriptor set {}", config.debug_name);
   } else {
     horizon_trace("allocated descriptor set");
   }
@@ -1328,13 +2815,46 @@ handle_descriptor_set_t context_t::allocate_descriptor_set(
 
 void context_t::free_descriptor_set(handle_descriptor_set_t handle) {
   horizon_profile();
-  internal::descriptor_set_t &descriptor_set =
-      utils::assert_and_get_data<internal::descriptor_set_t>(handle,
-                                                             _descriptor_sets);
-  VkResult vk_result = vkFreeDescriptorSets(_vkb_device, _vk_descriptor_pool, 1,
-                                            &descriptor_set.vk_descriptor_set);
-  check(vk_result == VK_SUCCESS, "Failed to free descriptor set");
-  _descriptor_sets.erase(handle);
+  internal::descriptor_set_t descriptor_set =
+      utils::assert_and_get_data<internal::descriptor_set_t>(handle,
+                                                             _descriptor_sets);
+  check(descriptor_set.p_descriptor_allocator == _descriptor_allocator.get(),
+        "descriptor set {} belongs to an external allocator", handle);
+  _descriptor_sets.erase(handle);
+  forget_descriptor_buffer_writes(handle);
+  defer_destruction([this, descriptor_set]() {
+    _descriptor_allocator->free(descriptor_set.vk_descriptor_pool,
+                                descriptor_set.vk_descriptor_set);
+  });
+}
+
+void context_t::destroy_descriptor_pool(VkDescriptorPool vk_descriptor_pool) {
+  horizon_profile();
+  defer_destruction([this, vk_descriptor_pool]() {
+    vkDestroyDescriptorPool(_vkb_device, vk_descriptor_pool, nullptr);
+  });
+}
+
+void context_t::forget_descriptor_sets(
+    std::span<const handle_descriptor_set_t> handles) {
+  horizon_profile();
+  for (handle_descriptor_set_t handle : handles) {
+    check(_descriptor_sets.contains(handle), "invalid descriptor set {}",
+          handle);
+    _descriptor_sets.erase(handle);
+    forget_descriptor_buffer_writes(handle);
+  }
+}
+
+void context_t::forget_descriptor_buffer_writes(
+    handle_descriptor_set_t handle) {
+  horizon_profile();
+  std::scoped_lock lock{_defragmentation_mutex};
+  auto             itr =
+      _descriptor_buffer_writes.lower_bound(std::make_tuple(handle, 0u, 0u));
+  while (itr != _descriptor_buffer_writes.end() &&
+         std::get<0>(itr->first) == handle)
+    itr = _descriptor_buffer_writes.erase(itr);
 }
 
 update_descriptor_set_t context_t::update_descriptor_set(
@@ -1350,10 +2870,17 @@ internal::descriptor_set_t &context_t::get_descriptor_set(
       handle, _descriptor_sets);
 }
 
+const config_descriptor_set_t &context_t::get_descriptor_set_config(
+    handle_descriptor_set_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_descriptor_set_t>(
+      handle, _descriptor_sets);
+}
+
 handle_pipeline_layout_t context_t::create_pipeline_layout(
     const config_pipeline_layout_t &config) {
   horizon_profile();
-  internal::pipeline_layout_t pipeline_layout{.config = config};
+  internal::pipeline_layout_t pipeline_layout{};
   VkDescriptorSetLayout      *vk_descriptor_set_layouts =
       reinterpret_cast<VkDescriptorSetLayout *>(
           alloca(config.handle_descriptor_set_layouts.size() *
@@ -1382,18 +2909,16 @@ handle_pipeline_layout_t context_t::create_pipeline_layout(
   }
   handle_pipeline_layout_t handle =
       utils::create_and_insert_new_handle<handle_pipeline_layout_t>(
-          _pipeline_layouts, pipeline_layout);
+          _pipeline_layouts, pipeline_layout, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_PIPELINE_LAYOUT;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(pipeline_layout.vk_pipeline_layout);
-    vk_debug_utils_object_name_info.pObjectName =
-        pipeline_layout.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created pipeline layout {}",
-                  pipeline_layout.config.debug_name);
+    horizon_trace("created pipeline layout {}", config.debug_name);
   } else {
     horizon_trace("created pipeline layout");
   }
@@ -1402,259 +2927,101 @@ handle_pipeline_layout_t context_t::create_pipeline_layout(
 
 void context_t::destroy_pipeline_layout(handle_pipeline_layout_t handle) {
   horizon_profile();
-  internal::pipeline_layout_t &pipeline_layout =
+  VkPipelineLayout vk_pipeline_layout =
       utils::assert_and_get_data<internal::pipeline_layout_t>(
           handle, _pipeline_layouts);
-  vkDestroyPipelineLayout(_vkb_device, pipeline_layout, nullptr);
   _pipeline_layouts.erase(handle);
+  defer_destruction([this, vk_pipeline_layout]() {
+    vkDestroyPipelineLayout(_vkb_device, vk_pipeline_layout, nullptr);
+  });
 }
 
-handle_shader_t context_t::create_shader(const config_shader_t &config) {
+internal::pipeline_layout_t &context_t::get_pipeline_layout(
+    handle_pipeline_layout_t handle) {
   horizon_profile();
+  return utils::assert_and_get_data<internal::pipeline_layout_t>(
+      handle, _pipeline_layouts);
+}
 
-  VkShaderModuleCreateInfo vk_shader_module_create_info{
-      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-  std::vector<uint32_t> spirv_shader_module_code{};
-
-  Slang::ComPtr<slang::ICompileRequest>       compileRequest;
-  Slang::ComPtr<slang::IBlob>                 spirvCode;
-  Slang::ComPtr<slang::IComponentType>        composedProgram;
-  std::vector<slang::IComponentType *>        componentTypes;
-  Slang::ComPtr<slang::IEntryPoint>           entryPoint;
-  slang::IModule                             *slangModule = nullptr;
-  static Slang::ComPtr<slang::IGlobalSession> slangGlobalSession;
-  static bool                                 once_slang = []() {
-    check(slang::createGlobalSession(slangGlobalSession.writeRef()) == 0,
-                                          "failed to create global session");
-    return true;
-  }();
-
-  std::string code = config.is_code ? config.code_or_path
-                                    : core::read_file(config.code_or_path);
-  std::string path = config.is_code ? "" : config.code_or_path;
-
-  // slangGlobalSession->createCompileRequest(compileRequest.writeRef());
-  // compileRequest->setCodeGenTarget(SlangCompileTarget::SLANG_SPIRV);
-  // const int translationUnitIndex =
-  // compileRequest->addTranslationUnit(SlangSourceLanguage::SLANG_SOURCE_LANGUAGE_SLANG,
-  // nullptr);
-  // compileRequest->addTranslationUnitSourceString(translationUnitIndex,
-  // path.c_str(), code.c_str());
-  // compileRequest->setMatrixLayoutMode(SLANG_MATRIX_LAYOUT_COLUMN_MAJOR);
-  // compileRequest->setTargetFlags(0,
-  // SLANG_TARGET_FLAG_GENERATE_SPIRV_DIRECTLY |
-  // SLANG_TARGET_FLAG_GENERATE_WHOLE_PROGRAM);
-  // compileRequest->setTargetForceGLSLScalarBufferLayout(0, true);
-  // compileRequest->setDiagnosticCallback(utils::diagnostic_callback_slang,
-  // this);
-  // compileRequest->setOptimizationLevel(SLANG_OPTIMIZATION_LEVEL_NONE);
-  // compileRequest->setDebugInfoLevel(SLANG_DEBUG_INFO_LEVEL_MAXIMAL);
-  // auto compileArguments = std::to_array<const char*>({
-  //     "-warnings-disable", "39001", // Disables descriptor binding aliasing
-  //     warning
-  //     "-fvk-use-entrypoint-name",
-  //     "-O0"
-  // });
-  // if
-  // (SLANG_FAILED(compileRequest->processCommandLineArguments(compileArguments.data(),
-  // (int)compileArguments.size()))) {
-  //     horizon_error("{}", compileRequest->getDiagnosticOutput());
-  //     std::terminate();
-  // }
-
-  // if (SLANG_FAILED(compileRequest->compile())) {
-  //     horizon_error("{}", "somthing fucked up");
-  //     std::terminate();
-  // }
-
-  // size_t codeSize;
-  // const void* code = compileRequest->getCompileRequestCode(&codeSize);
-
-  // vk_shader_module_create_info.codeSize = codeSize;
-  // vk_shader_module_create_info.pCode = static_cast<const uint32_t *>(code);
-
-  // // auto reflection = compileRequest->getReflection();
-  // // uint32_t parameter_count = spReflection_GetParameterCount(reflection);
-  // // for (uint32_t i = 0; i < parameter_count; i++) {
-  // //     SlangReflectionParameter *param =
-  // spReflection_GetParameterByIndex(reflection, i);
-  // //     uint32_t index = spReflectionParameter_GetBindingIndex(param);
-  // //     uint32_t space = spReflectionParameter_GetBindingSpace(param);
-  // //     horizon_info("{} {}", index, space);
-  // // }
-
-  static std::vector<slang::CompilerOptionEntry> compiler_options;
-  Slang::ComPtr<slang::ISession>                 session;
-  slang::SessionDesc                             sessionDesc = {};
-  slang::TargetDesc                              targetDesc  = {};
-  targetDesc.format                                          = SLANG_SPIRV;
-  targetDesc.profile = slangGlobalSession->findProfile("spirv_1_5");
-  targetDesc.flags   = SLANG_TARGET_FLAG_GENERATE_SPIRV_DIRECTLY;
-  targetDesc.forceGLSLScalarBufferLayout = true;
-
-  slang::CompilerOptionValue compiler_value{};
-  slang::CompilerOptionEntry compiler_option{};
-
-  // compiler_value.intValue0 = 1;
-  // compiler_value.kind = slang::CompilerOptionValueKind::Int;
-  // compiler_option = {
-  //     .name = slang::CompilerOptionName::EmitSpirvDirectly,
-  //     .value = compiler_value,
-  // };
-  // compiler_options.push_back(compiler_option);
-
-  compiler_option.name = slang::CompilerOptionName::Optimization;
-  compiler_value.intValue0 =
-      SlangOptimizationLevel::SLANG_OPTIMIZATION_LEVEL_NONE;
-  compiler_option.value = compiler_value;
-  compiler_options.push_back(compiler_option);
-
-  compiler_option.name = slang::CompilerOptionName::DebugInformation;
-  compiler_value.intValue0 =
-      SlangDebugInfoLevel::SLANG_DEBUG_INFO_LEVEL_MAXIMAL;
-  compiler_option.value = compiler_value;
-  compiler_options.push_back(compiler_option);
-
-  compiler_option.name     = slang::CompilerOptionName::GLSLForceScalarLayout;
-  compiler_value.kind      = slang::CompilerOptionValueKind::Int;
-  compiler_value.intValue0 = 1;
-  compiler_option.value    = compiler_value;
-  compiler_options.push_back(compiler_option);
-
-  // targetDesc.compilerOptionEntries = compiler_options.data();
-  // targetDesc.compilerOptionEntryCount = compiler_options.size();
-
-  sessionDesc.allowGLSLSyntax = true;
-  sessionDesc.targets         = &targetDesc;
-  sessionDesc.targetCount     = 1;
-
-  sessionDesc.compilerOptionEntryCount = compiler_options.size();
-  sessionDesc.compilerOptionEntries    = compiler_options.data();
-  // sessionDesc.defaultMatrixLayoutMode =
-  // SlangMatrixLayoutMode::SLANG_MATRIX_LAYOUT_COLUMN_MAJOR;
-
-  const char *search_paths[]  = {"../../assets/shaders/includes"};
-  sessionDesc.searchPaths     = search_paths;
-  sessionDesc.searchPathCount = 1;
-  check(slangGlobalSession->createSession(sessionDesc, session.writeRef()) == 0,
-        "failed to create session");
-
-  // SlangCompileRequest *slangRequest;
-  // session->createCompileRequest(&slangRequest);
-  // spSetDebugInfoLevel(slangRequest,
-  // SlangDebugInfoLevel::SLANG_DEBUG_INFO_LEVEL_MAXIMAL);
-  // spSetDebugInfoFormat(slangRequest,
-  // SlangDebugInfoFormat::SLANG_DEBUG_INFO_FORMAT_DEFAULT); int
-  // translationUnitIndex = spAddTranslationUnit(slangRequest,
-  // SLANG_SOURCE_LANGUAGE_SLANG, nullptr);
-  // spAddTranslationUnitSourceString(slangRequest, translationUnitIndex,
-  // path.c_str(), code.c_str()); const SlangResult compileRes =
-  // spCompile(slangRequest); if(auto diagnostics =
-  // spGetDiagnosticOutput(slangRequest)) {
-  //     horizon_error("{}", diagnostics);
-  // }
-  // if(SLANG_FAILED(compileRes)) {
-  //     spDestroyCompileRequest(slangRequest);
-  //     throw std::runtime_error("");
-  // }
-  {
-    Slang::ComPtr<slang::IBlob> diagnosticBlob;
-    slangModule = session->loadModuleFromSourceString(
-        config.name.c_str(), path.c_str(), code.c_str(),
-        diagnosticBlob.writeRef());
-    utils::diagnose_if_needed(diagnosticBlob);
-    check(slangModule, "Failed to create module");
-  }
-
-  Slang::ComPtr<slang::IBlob> diagnosticBlob;
-  switch (config.type) {
-    case shader_type_t::e_vertex:
-      // slangModule->findEntryPointByName("vertex_main",
-      // entryPoint.writeRef());
-      slangModule->findAndCheckEntryPoint(
-          "vertex_main", SlangStage::SLANG_STAGE_VERTEX, entryPoint.writeRef(),
-          diagnosticBlob.writeRef());
-      break;
-    case shader_type_t::e_fragment:
-      // slangModule->findEntryPointByName("fragment_main",
-      // entryPoint.writeRef());
-      slangModule->findAndCheckEntryPoint(
-          "fragment_main", SlangStage::SLANG_STAGE_FRAGMENT,
-          entryPoint.writeRef(), diagnosticBlob.writeRef());
-      break;
-    case shader_type_t::e_compute:
-      // slangModule->findEntryPointByName("compute_main",
-      // entryPoint.writeRef());
-      slangModule->findAndCheckEntryPoint(
-          "compute_main", SlangStage::SLANG_STAGE_COMPUTE,
-          entryPoint.writeRef(), diagnosticBlob.writeRef());
-      break;
-    default:
-      horizon_error("unknown shader type");
-      std::terminate();
-  }
-  utils::diagnose_if_needed(diagnosticBlob);
-  check(entryPoint, "failed to find entrypoint in {}", path);
+const config_pipeline_layout_t &context_t::get_pipeline_layout_config(
+    handle_pipeline_layout_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_pipeline_layout_t>(
+      handle, _pipeline_layouts);
+}
 
-  componentTypes.push_back(slangModule);
-  componentTypes.push_back(entryPoint);
+handle_shader_t context_t::create_shader(const config_shader_t &config) {
+  horizon_profile();
+  return build_shader(config, _shader_compiler->compile(config));
+}
 
-  {
-    Slang::ComPtr<slang::IBlob> diagnosticsBlob;
-    SlangResult                 result = session->createCompositeComponentType(
-        componentTypes.data(), componentTypes.size(),
-        composedProgram.writeRef(), diagnosticsBlob.writeRef());
-    utils::diagnose_if_needed(diagnosticsBlob);
-    check(result == 0, "Failed to created composed program or something");
+std::vector<handle_shader_t> context_t::create_shader_program(
+    const config_shader_program_t &config) {
+  horizon_profile();
+  std::vector<compiled_shader_t> compiled_shaders =
+      _shader_compiler->compile_program(config);
+  std::vector<handle_shader_t> handles;
+  for (uint32_t i = 0; i < config.types.size(); i++) {
+    config_shader_t shader_config{
+        .code_or_path = config.code_or_path,
+        .is_code      = config.is_code,
+        .name         = config.name,
+        .type         = config.types[i],
+        .language     = config.language,
+        .debug_name   = config.debug_name,
+    };
+    handles.push_back(build_shader(shader_config, compiled_shaders[i]));
   }
+  return handles;
+}
 
-  {
-    Slang::ComPtr<slang::IBlob> diagnosticsBlob;
-    SlangResult                 result = composedProgram->getEntryPointCode(
-        0, 0, spirvCode.writeRef(), diagnosticsBlob.writeRef());
-    utils::diagnose_if_needed(diagnosticsBlob);
-    check(result == 0, "Failed to get spirv code");
-  }
+core::ticket_t<handle_shader_t> context_t::create_shader_async(
+    const config_shader_t &config) {
+  horizon_profile();
+  return _thread_pool->submit(
+      [this, config]() { return create_shader(config); });
+}
 
-  slang::ProgramLayout *program_layout;
-  {
-    Slang::ComPtr<slang::IBlob> diagnosticsBlob;
-    program_layout = composedProgram->getLayout(0, diagnosticsBlob.writeRef());
-    utils::diagnose_if_needed(diagnosticsBlob);
-    check(program_layout, "Failed to get program layout");
-  }
+core::ticket_t<std::vector<handle_shader_t>>
+context_t::create_shader_program_async(const config_shader_program_t &config) {
+  horizon_profile();
+  return _thread_pool->submit(
+      [this, config]() { return create_shader_program(config); });
+}
 
-  uint32_t parameter_count = program_layout->getParameterCount();
-  for (uint32_t i = 0; i < parameter_count; i++) {
-    slang::VariableLayoutReflection *parameter =
-        program_layout->getParameterByIndex(i);
-    unsigned index = parameter->getBindingIndex();
-    horizon_trace("{} {}", parameter->getName(), index);
+handle_shader_t context_t::build_shader(
+    const config_shader_t &config, const compiled_shader_t &compiled_shader) {
+  horizon_profile();
+  for (const shader_parameter_t &parameter :
+       compiled_shader.reflection.parameters) {
+    horizon_trace("{} {}", parameter.name, parameter.binding);
   }
 
-  vk_shader_module_create_info.codeSize = spirvCode->getBufferSize();
-  vk_shader_module_create_info.pCode =
-      static_cast<const uint32_t *>(spirvCode->getBufferPointer());
-
   if (!config.is_code) horizon_trace("reading file {}", config.code_or_path);
 
-  internal::shader_t shader{.config = config};
+  VkShaderModuleCreateInfo vk_shader_module_create_info{
+      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+  vk_shader_module_create_info.codeSize =
+      compiled_shader.spirv.size() * sizeof(uint32_t);
+  vk_shader_module_create_info.pCode = compiled_shader.spirv.data();
+
+  internal::shader_t shader{.reflection = compiled_shader.reflection};
   VkResult           vk_result = vkCreateShaderModule(
       _vkb_device, &vk_shader_module_create_info, nullptr, &shader.vk_shader);
   check(vk_result == VK_SUCCESS, "Failed to create shader");
 
   handle_shader_t handle =
-      utils::create_and_insert_new_handle<handle_shader_t>(_shaders, shader);
+      utils::create_and_insert_new_handle<handle_shader_t>(
+          _shaders, shader, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_SHADER_MODULE;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(shader.vk_shader);
-    vk_debug_utils_object_name_info.pObjectName =
-        shader.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created shader {}", shader.config.debug_name);
+    horizon_trace("created shader {}", config.debug_name);
   } else {
     horizon_trace("created shader");
   }
@@ -1669,12 +3036,139 @@ void context_t::destroy_shader(handle_shader_t handle) {
   _shaders.erase(handle);
 }
 
+internal::shader_t &context_t::get_shader(handle_shader_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::shader_t>(handle, _shaders);
+}
+
+const config_shader_t &context_t::get_shader_config(handle_shader_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_shader_t>(handle, _shaders);
+}
+
+const shader_reflection_t &context_t::get_shader_reflection(
+    handle_shader_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::shader_t>(handle, _shaders)
+      .reflection;
+}
+
+shader_layout_t context_t::get_shader_layout(
+    std::span<const handle_shader_t> handles) {
+  horizon_profile();
+  // space -> binding, ordered so equal layouts produce equal configs
+  std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> spaces;
+  std::set<uint32_t>  runtime_sized_spaces;
+  VkPushConstantRange vk_push_constant_range{};
+  for (handle_shader_t handle : handles) {
+    const shader_reflection_t &reflection = get_shader_reflection(handle);
+    if (reflection.push_constant_size) {
+      vk_push_constant_range.stageFlags |= reflection.vk_shader_stage;
+      vk_push_constant_range.size =
+          std::max(vk_push_constant_range.size, reflection.push_constant_size);
+    }
+    for (const shader_parameter_t &parameter : reflection.parameters) {
+      uint32_t count = parameter.count;
+      if (count == 0) {
+        count = utils::runtime_sized_descriptor_count;
+        runtime_sized_spaces.insert(parameter.space);
+      }
+      auto [itr, inserted] = spaces[parameter.space].try_emplace(
+          parameter.binding,
+          VkDescriptorSetLayoutBinding{
+              .binding         = parameter.binding,
+              .descriptorType  = parameter.vk_descriptor_type,
+              .descriptorCount = count,
+          });
+      VkDescriptorSetLayoutBinding &vk_binding = itr->second;
+      check(vk_binding.descriptorType == parameter.vk_descriptor_type,
+            "{} at set {} binding {} is declared with conflicting types",
+            parameter.name, parameter.space, parameter.binding);
+      vk_binding.descriptorCount = std::max(vk_binding.descriptorCount, count);
+      vk_binding.stageFlags |= reflection.vk_shader_stage;
+    }
+  }
+
+  shader_layout_t          shader_layout{};
+  config_pipeline_layout_t config_pipeline_layout{};
+  uint32_t space_count = spaces.empty() ? 0 : spaces.rbegin()->first + 1;
+  for (uint32_t space = 0; space < space_count; space++) {
+    config_descriptor_set_layout_t config{};
+    // only runtime sized arrays need partially bound descriptors
+    config.use_bindless = runtime_sized_spaces.contains(space);
+    for (auto &[binding, vk_binding] : spaces[space])
+      config.vk_descriptor_set_layout_bindings.push_back(vk_binding);
+    handle_descriptor_set_layout_t handle =
+        get_derived_descriptor_set_layout(config);
+    shader_layout.handle_descriptor_set_layouts.push_back(handle);
+    config_pipeline_layout.add_descriptor_set_layout(handle);
+  }
+  if (vk_push_constant_range.size)
+    config_pipeline_layout.vk_push_constant_ranges.push_back(
+        vk_push_constant_range);
+  shader_layout.handle_pipeline_layout =
+      get_derived_pipeline_layout(config_pipeline_layout);
+  return shader_layout;
+}
+
+handle_descriptor_set_layout_t context_t::get_derived_descriptor_set_layout(
+    const config_descriptor_set_layout_t &config) {
+  horizon_profile();
+  const std::vector<VkDescriptorSetLayoutBinding> &vk_bindings =
+      config.vk_descriptor_set_layout_bindings;
+  uint64_t key = core::hash_bytes(&config.use_bindless, sizeof(bool));
+  key          = core::hash_bytes(vk_bindings.data(),
+                                  vk_bindings.size() *
+                                      sizeof(VkDescriptorSetLayoutBinding),
+                                  key);
+  std::scoped_lock lock{_derived_layouts_mutex};
+  auto [begin, end] = _derived_descriptor_set_layouts.equal_range(key);
+  for (auto itr = begin; itr != end; ++itr)
+    if (utils::equal_derived_configs(itr->second.first, config))
+      return itr->second.second;
+  handle_descriptor_set_layout_t handle = create_descriptor_set_layout(config);
+  _derived_descriptor_set_layouts.emplace(key, std::make_pair(config, handle));
+  return handle;
+}
+
+handle_pipeline_layout_t context_t::get_derived_pipeline_layout(
+    const config_pipeline_layout_t &config) {
+  horizon_profile();
+  uint64_t key = core::hash_bytes(config.handle_descriptor_set_layouts.data(),
+                                  config.handle_descriptor_set_layouts.size() *
+                                      sizeof(handle_descriptor_set_layout_t));
+  key          = core::hash_bytes(config.vk_push_constant_ranges.data(),
+                                  config.vk_push_constant_ranges.size() *
+                                      sizeof(VkPushConstantRange),
+                                  key);
+  std::scoped_lock lock{_derived_layouts_mutex};
+  auto [begin, end] = _derived_pipeline_layouts.equal_range(key);
+  for (auto itr = begin; itr != end; ++itr)
+    if (utils::equal_derived_configs(itr->second.first, config))
+      return itr->second.second;
+  handle_pipeline_layout_t handle = create_pipeline_layout(config);
+  _derived_pipeline_layouts.emplace(key, std::make_pair(config, handle));
+  return handle;
+}
+
+void context_t::set_shader_cache_directory(const std::filesystem::path &path) {
+  horizon_profile();
+  _shader_compiler->set_cache_directory(path);
+}
+
+shader_cache_stats_t context_t::get_shader_cache_stats() {
+  horizon_profile();
+  return _shader_compiler->stats();
+}
+
 handle_pipeline_t context_t::create_compute_pipeline(
     const config_pipeline_t &config) {
   horizon_profile();
   internal::pipeline_t pipeline{
       .vk_pipeline_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE,
-      .config                 = config};
+      .vk_pipeline_layout =
+          utils::assert_and_get_data<internal::pipeline_layout_t>(
+              config.handle_pipeline_layout, _pipeline_layouts)};
 
   assert(config.handle_shaders.size() > 0);
 
@@ -1694,24 +3188,23 @@ handle_pipeline_t context_t::create_compute_pipeline(
   vk_compute_pipeline_create_info.stage = vk_pipeline_shader_stage_create_info;
   {
     VkResult vk_result = vkCreateComputePipelines(
-        _vkb_device, VK_NULL_HANDLE, 1, &vk_compute_pipeline_create_info,
+        _vkb_device, _vk_pipeline_cache, 1, &vk_compute_pipeline_create_info,
         nullptr, &pipeline.vk_pipeline);
     check(vk_result == VK_SUCCESS, "Failed to create compute pipeline");
   }
 
   handle_pipeline_t handle =
-      utils::create_and_insert_new_handle<handle_pipeline_t>(_pipelines,
-                                                             pipeline);
+      utils::create_and_insert_new_handle<handle_pipeline_t>(
+          _pipelines, pipeline, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_PIPELINE;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(pipeline.vk_pipeline);
-    vk_debug_utils_object_name_info.pObjectName =
-        pipeline.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created compute pipeline {}", pipeline.config.debug_name);
+    horizon_trace("created compute pipeline {}", config.debug_name);
   } else {
     horizon_trace("created compute pipeline");
   }
@@ -1727,7 +3220,9 @@ handle_pipeline_t context_t::create_graphics_pipeline(
 
   internal::pipeline_t pipeline{
       .vk_pipeline_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS,
-      .config                 = config};
+      .vk_pipeline_layout =
+          utils::assert_and_get_data<internal::pipeline_layout_t>(
+              config.handle_pipeline_layout, _pipeline_layouts)};
 
   VkPipelineDynamicStateCreateInfo vk_dynamic_state{
       .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
@@ -1778,13 +3273,15 @@ handle_pipeline_t context_t::create_graphics_pipeline(
   for (auto &handle_shader : config.handle_shaders) {
     internal::shader_t &shader =
         utils::assert_and_get_data<internal::shader_t>(handle_shader, _shaders);
+    config_shader_t &config_shader =
+        utils::assert_and_get_config<config_shader_t>(handle_shader, _shaders);
 
     VkPipelineShaderStageCreateInfo vk_pipeline_shader_stage_create_info{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
-    if (shader.config.language == shader_language_t::e_glsl) {
+    if (config_shader.language == shader_language_t::e_glsl) {
       vk_pipeline_shader_stage_create_info.pName = "main";
-    } else if (shader.config.language == shader_language_t::e_slang) {
-      switch (shader.config.type) {
+    } else if (config_shader.language == shader_language_t::e_slang) {
+      switch (config_shader.type) {
         case shader_type_t::e_vertex:
           vk_pipeline_shader_stage_create_info.pName = "main";
           break;
@@ -1799,7 +3296,7 @@ handle_pipeline_t context_t::create_graphics_pipeline(
           std::terminate();
       }
     }
-    switch (shader.config.type) {
+    switch (config_shader.type) {
       case shader_type_t::e_fragment:
         vk_pipeline_shader_stage_create_info.stage =
             VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -1866,41 +3363,109 @@ handle_pipeline_t context_t::create_graphics_pipeline(
   vk_pipeline_info.subpass    = 0;
   vk_pipeline_info.pNext      = &vk_pipeline_rendering_create;
 
-  VkResult vk_result = vkCreateGraphicsPipelines(_vkb_device, VK_NULL_HANDLE, 1,
-                                                 &vk_pipeline_info, nullptr,
-                                                 &pipeline.vk_pipeline);
+  VkResult vk_result = vkCreateGraphicsPipelines(
+      _vkb_device, _vk_pipeline_cache, 1, &vk_pipeline_info, nullptr,
+      &pipeline.vk_pipeline);
   check(vk_result == VK_SUCCESS, "Failed to create graphics pipeline");
 
   handle_pipeline_t handle =
-      utils::create_and_insert_new_handle<handle_pipeline_t>(_pipelines,
-                                                             pipeline);
+      utils::create_and_insert_new_handle<handle_pipeline_t>(
+          _pipelines, pipeline, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_PIPELINE;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(pipeline.vk_pipeline);
-    vk_debug_utils_object_name_info.pObjectName =
-        pipeline.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created graphics pipeline {}", pipeline.config.debug_name);
+    horizon_trace("created graphics pipeline {}", config.debug_name);
   } else {
     horizon_trace("created graphics pipeline");
   }
   return handle;
 }
 
+std::vector<handle_pipeline_t> context_t::create_compute_pipelines(
+    std::span<const config_pipeline_t> configs) {
+  horizon_profile();
+  return create_pipelines(configs, &context_t::create_compute_pipeline);
+}
+
+std::vector<handle_pipeline_t> context_t::create_graphics_pipelines(
+    std::span<const config_pipeline_t> configs) {
+  horizon_profile();
+  return create_pipelines(configs, &context_t::create_graphics_pipeline);
+}
+
+std::vector<handle_pipeline_t> context_t::create_pipelines(
+    std::span<const config_pipeline_t> configs,
+    handle_pipeline_t (context_t::*create)(const config_pipeline_t &)) {
+  horizon_profile();
+  std::vector<handle_pipeline_t> handles(configs.size());
+  // workers pull the next config off a shared counter, pipelines vary wildly
+  // in compile time so a static split would leave threads idle
+  std::atomic<size_t> next = 0;
+  auto                drain = [&]() {
+    for (size_t i = next++; i < configs.size(); i = next++)
+      handles[i] = (this->*create)(configs[i]);
+  };
+
+  // the calling thread drains too, so it takes the place of one job. a
+  // thread pool job drains alone, waiting on jobs queued behind it could
+  // leave every worker blocked
+  size_t job_count =
+      std::min<size_t>(configs.size(), _thread_pool->thread_count());
+  if (job_count > 0) job_count--;
+  if (_thread_pool->is_worker_thread()) job_count = 0;
+  std::vector<core::ticket_t<void>> tickets;
+  for (size_t i = 0; i < job_count; i++)
+    tickets.push_back(_thread_pool->submit(drain));
+  drain();
+  for (core::ticket_t<void> &ticket : tickets) ticket.wait();
+  horizon_trace("created {} pipelines on {} threads", configs.size(),
+                job_count + 1);
+  return handles;
+}
+
+core::ticket_t<handle_pipeline_t> context_t::create_compute_pipeline_async(
+    const config_pipeline_t &config) {
+  horizon_profile();
+  return _thread_pool->submit(
+      [this, config]() { return create_compute_pipeline(config); });
+}
+
+core::ticket_t<handle_pipeline_t> context_t::create_graphics_pipeline_async(
+    const config_pipeline_t &config) {
+  horizon_profile();
+  return _thread_pool->submit(
+      [this, config]() { return create_graphics_pipeline(config); });
+}
+
 void context_t::destroy_pipeline(handle_pipeline_t handle) {
   horizon_profile();
-  internal::pipeline_t &pipeline =
+  VkPipeline vk_pipeline =
       utils::assert_and_get_data<internal::pipeline_t>(handle, _pipelines);
-  vkDestroyPipeline(_vkb_device, pipeline, nullptr);
   _pipelines.erase(handle);
+  defer_destruction([this, vk_pipeline]() {
+    vkDestroyPipeline(_vkb_device, vk_pipeline, nullptr);
+  });
+}
+
+internal::pipeline_t &context_t::get_pipeline(handle_pipeline_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::pipeline_t>(handle, _pipelines);
+}
+
+const config_pipeline_t &context_t::get_pipeline_config(
+    handle_pipeline_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_pipeline_t>(handle, _pipelines);
 }
 
 handle_fence_t context_t::create_fence(const config_fence_t &config) {
   horizon_profile();
-  internal::fence_t fence{.config = config};
+  internal::fence_t fence{};
   VkFenceCreateInfo vk_fence_create_info{
       .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
   vk_fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
@@ -1908,17 +3473,17 @@ handle_fence_t context_t::create_fence(const config_fence_t &config) {
                                              nullptr, &fence.vk_fence);
   check(vk_result == VK_SUCCESS, "Failed to create fence");
   handle_fence_t handle =
-      utils::create_and_insert_new_handle<handle_fence_t>(_fences, fence);
+      utils::create_and_insert_new_handle<handle_fence_t>(
+          _fences, fence, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_FENCE;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(fence.vk_fence);
-    vk_debug_utils_object_name_info.pObjectName =
-        fence.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created fence {}", fence.config.debug_name);
+    horizon_trace("created fence {}", config.debug_name);
   } else {
     horizon_trace("created fence");
   }
@@ -1927,10 +3492,21 @@ handle_fence_t context_t::create_fence(const config_fence_t &config) {
 
 void context_t::destroy_fence(handle_fence_t handle) {
   horizon_profile();
-  internal::fence_t &fence =
+  VkFence vk_fence =
       utils::assert_and_get_data<internal::fence_t>(handle, _fences);
-  vkDestroyFence(_vkb_device, fence, nullptr);
   _fences.erase(handle);
+  defer_destruction(
+      [this, vk_fence]() { vkDestroyFence(_vkb_device, vk_fence, nullptr); });
+}
+
+internal::fence_t &context_t::get_fence(handle_fence_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::fence_t>(handle, _fences);
+}
+
+const config_fence_t &context_t::get_fence_config(handle_fence_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_fence_t>(handle, _fences);
 }
 
 void context_t::wait_fence(handle_fence_t handle) {
@@ -1940,6 +3516,9 @@ void context_t::wait_fence(handle_fence_t handle) {
   VkResult vk_result =
       vkWaitForFences(_vkb_device, 1, &fence.vk_fence, true, UINT64_MAX);
   check(vk_result == VK_SUCCESS, "Failed to wait for fence");
+  // the fence only covers its own vkQueueSubmit2 call, later calls sharing
+  // the serial may still run, so the completed serial is left to the queue
+  // timelines
 }
 
 void context_t::reset_fence(handle_fence_t handle) {
@@ -1953,25 +3532,30 @@ void context_t::reset_fence(handle_fence_t handle) {
 handle_semaphore_t context_t::create_semaphore(
     const config_semaphore_t &config) {
   horizon_profile();
-  internal::semaphore_t semaphore{.config = config};
+  internal::semaphore_t     semaphore{};
+  VkSemaphoreTypeCreateInfo vk_semaphore_type_create_info{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+  vk_semaphore_type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  vk_semaphore_type_create_info.initialValue  = config.initial_value;
   VkSemaphoreCreateInfo vk_semaphore_create_info{
       .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+  if (config.is_timeline)
+    vk_semaphore_create_info.pNext = &vk_semaphore_type_create_info;
   VkResult vk_result = vkCreateSemaphore(_vkb_device, &vk_semaphore_create_info,
                                          nullptr, &semaphore.vk_semaphore);
   check(vk_result == VK_SUCCESS, "Failed to create semaphore");
   handle_semaphore_t handle =
-      utils::create_and_insert_new_handle<handle_semaphore_t>(_semaphores,
-                                                              semaphore);
+      utils::create_and_insert_new_handle<handle_semaphore_t>(
+          _semaphores, semaphore, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_SEMAPHORE;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(semaphore.vk_semaphore);
-    vk_debug_utils_object_name_info.pObjectName =
-        semaphore.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created semaphore {}", semaphore.config.debug_name);
+    horizon_trace("created semaphore {}", config.debug_name);
   } else {
     horizon_trace("created semaphore");
   }
@@ -1980,38 +3564,101 @@ handle_semaphore_t context_t::create_semaphore(
 
 void context_t::destroy_semaphore(handle_semaphore_t handle) {
   horizon_profile();
-  internal::semaphore_t &semaphore =
+  VkSemaphore vk_semaphore =
       utils::assert_and_get_data<internal::semaphore_t>(handle, _semaphores);
-  vkDestroySemaphore(_vkb_device, semaphore, nullptr);
   _semaphores.erase(handle);
+  defer_destruction([this, vk_semaphore]() {
+    vkDestroySemaphore(_vkb_device, vk_semaphore, nullptr);
+  });
+}
+
+internal::semaphore_t &context_t::get_semaphore(handle_semaphore_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::semaphore_t>(handle, _semaphores);
+}
+
+const config_semaphore_t &context_t::get_semaphore_config(
+    handle_semaphore_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_semaphore_t>(handle, _semaphores);
+}
+
+handle_semaphore_t context_t::create_timeline_semaphore(
+    uint64_t initial_value, const std::string &debug_name) {
+  horizon_profile();
+  return create_semaphore({.is_timeline   = true,
+                           .initial_value = initial_value,
+                           .debug_name    = debug_name});
+}
+
+uint64_t context_t::get_semaphore_value(handle_semaphore_t handle) {
+  horizon_profile();
+  check(get_semaphore_config(handle).is_timeline,
+        "semaphore is not a timeline semaphore");
+  uint64_t value;
+  VkResult vk_result =
+      vkGetSemaphoreCounterValue(_vkb_device, get_semaphore(handle), &value);
+  check(vk_result == VK_SUCCESS, "Failed to get semaphore value");
+  return value;
+}
+
+void context_t::signal_semaphore(handle_semaphore_t handle, uint64_t value) {
+  horizon_profile();
+  check(get_semaphore_config(handle).is_timeline,
+        "semaphore is not a timeline semaphore");
+  VkSemaphoreSignalInfo vk_semaphore_signal_info{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO};
+  vk_semaphore_signal_info.semaphore = get_semaphore(handle);
+  vk_semaphore_signal_info.value     = value;
+  VkResult vk_result =
+      vkSignalSemaphore(_vkb_device, &vk_semaphore_signal_info);
+  check(vk_result == VK_SUCCESS, "Failed to signal semaphore");
+}
+
+bool context_t::wait_semaphore(handle_semaphore_t handle, uint64_t value,
+                               uint64_t timeout) {
+  horizon_profile();
+  check(get_semaphore_config(handle).is_timeline,
+        "semaphore is not a timeline semaphore");
+  VkSemaphore         vk_semaphore = get_semaphore(handle);
+  VkSemaphoreWaitInfo vk_semaphore_wait_info{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+  vk_semaphore_wait_info.semaphoreCount = 1;
+  vk_semaphore_wait_info.pSemaphores    = &vk_semaphore;
+  vk_semaphore_wait_info.pValues        = &value;
+  VkResult vk_result =
+      vkWaitSemaphores(_vkb_device, &vk_semaphore_wait_info, timeout);
+  if (vk_result == VK_TIMEOUT) return false;
+  check(vk_result == VK_SUCCESS, "Failed to wait for semaphore");
+  return true;
 }
 
 handle_command_pool_t context_t::create_command_pool(
     const config_command_pool_t &config) {
   horizon_profile();
-  internal::command_pool_t command_pool{.config = config};
+  internal::command_pool_t command_pool{.queue_type = config.queue_type};
   VkCommandPoolCreateInfo  vk_command_pool_create_info{
        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
   vk_command_pool_create_info.flags =
       VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-  vk_command_pool_create_info.queueFamilyIndex = _graphics_queue.vk_index;
+  vk_command_pool_create_info.queueFamilyIndex =
+      queue(config.queue_type).vk_index;
   VkResult vk_result =
       vkCreateCommandPool(_vkb_device, &vk_command_pool_create_info, nullptr,
                           &command_pool.vk_command_pool);
   check(vk_result == VK_SUCCESS, "Failed to create command pool");
   handle_command_pool_t handle =
-      utils::create_and_insert_new_handle<handle_command_pool_t>(_command_pools,
-                                                                 command_pool);
+      utils::create_and_insert_new_handle<handle_command_pool_t>(
+          _command_pools, command_pool, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_COMMAND_POOL;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(command_pool.vk_command_pool);
-    vk_debug_utils_object_name_info.pObjectName =
-        command_pool.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created command pool {}", command_pool.config.debug_name);
+    horizon_trace("created command pool {}", config.debug_name);
   } else {
     horizon_trace("created command pool");
   }
@@ -2020,42 +3667,128 @@ handle_command_pool_t context_t::create_command_pool(
 
 void context_t::destroy_command_pool(handle_command_pool_t handle) {
   horizon_profile();
-  internal::command_pool_t &command_pool =
+  VkCommandPool vk_command_pool =
       utils::assert_and_get_data<internal::command_pool_t>(handle,
                                                            _command_pools);
-  vkDestroyCommandPool(_vkb_device, command_pool, nullptr);
   _command_pools.erase(handle);
+  defer_destruction([this, vk_command_pool]() {
+    vkDestroyCommandPool(_vkb_device, vk_command_pool, nullptr);
+  });
+}
+
+internal::command_pool_t &context_t::get_command_pool(
+    handle_command_pool_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::command_pool_t>(handle,
+                                                              _command_pools);
+}
+
+const config_command_pool_t &context_t::get_command_pool_config(
+    handle_command_pool_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_command_pool_t>(handle,
+                                                             _command_pools);
+}
+
+handle_command_pool_t context_t::get_thread_command_pool(
+    queue_type_t queue_type) {
+  horizon_profile();
+  std::scoped_lock       lock{_thread_command_pools_mutex};
+  handle_command_pool_t &handle =
+      _thread_command_pools[std::this_thread::get_id()]
+                           [static_cast<uint32_t>(queue_type)];
+  if (handle == core::null_handle)
+    handle = create_command_pool({.queue_type = queue_type});
+  return handle;
+}
+
+handle_commandbuffer_t context_t::acquire_commandbuffer(
+    queue_type_t queue_type, VkCommandBufferLevel vk_level) {
+  horizon_profile();
+  uint32_t ring_index = 2 * static_cast<uint32_t>(queue_type) +
+                        (vk_level == VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+  commandbuffer_ring_t *p_ring;
+  {
+    std::scoped_lock lock{_thread_command_pools_mutex};
+    p_ring = &_commandbuffer_rings[std::this_thread::get_id()][ring_index];
+  }
+  // only the owning thread ever touches its ring
+  commandbuffer_ring_t &ring = *p_ring;
+  if (ring.empty() ||
+      ring.back().used == utils::commandbuffers_per_ring_slot) {
+    if (!ring.empty() && is_ring_slot_retired(ring.front())) {
+      commandbuffer_ring_slot_t slot = std::move(ring.front());
+      ring.pop_front();
+      VkResult vk_result = vkResetCommandPool(
+          _vkb_device,
+          utils::assert_and_get_data<internal::command_pool_t>(
+              slot.handle_command_pool, _command_pools),
+          0);
+      check(vk_result == VK_SUCCESS, "Failed to reset command pool");
+      slot.used = 0;
+      ring.push_back(std::move(slot));
+    } else {
+      ring.push_back({.handle_command_pool = create_command_pool(
+                          {.queue_type = queue_type})});
+    }
+  }
+  commandbuffer_ring_slot_t &slot = ring.back();
+  if (slot.used == slot.handle_commandbuffers.size())
+    slot.handle_commandbuffers.push_back(allocate_commandbuffer(
+        {.handle_command_pool = slot.handle_command_pool,
+         .vk_level            = vk_level}));
+  handle_commandbuffer_t handle = slot.handle_commandbuffers[slot.used++];
+  utils::assert_and_get_data<internal::commandbuffer_t>(handle,
+                                                        _commandbuffers)
+      .submit_serial = 0;
+  return handle;
+}
+
+bool context_t::is_ring_slot_retired(const commandbuffer_ring_slot_t &slot) {
+  horizon_profile();
+  uint64_t serial = completed_serial();
+  // submit writes the submit serials under the queue mutex
+  std::scoped_lock lock{_queue_mutex};
+  return std::all_of(
+      slot.handle_commandbuffers.begin(),
+      slot.handle_commandbuffers.begin() + slot.used,
+      [&](handle_commandbuffer_t handle) {
+        uint64_t submit_serial =
+            utils::assert_and_get_data<internal::commandbuffer_t>(
+                handle, _commandbuffers)
+                .submit_serial;
+        return submit_serial != 0 && submit_serial <= serial;
+      });
 }
 
 handle_commandbuffer_t context_t::allocate_commandbuffer(
     const config_commandbuffer_t &config) {
   horizon_profile();
-  internal::commandbuffer_t   commandbuffer{.config = config};
+  internal::commandbuffer_t commandbuffer{
+      .handle_command_pool = config.handle_command_pool};
   VkCommandBufferAllocateInfo vk_commandbuffer_allocate_info{
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
   vk_commandbuffer_allocate_info.commandBufferCount = 1;
   vk_commandbuffer_allocate_info.commandPool =
       utils::assert_and_get_data<internal::command_pool_t>(
           config.handle_command_pool, _command_pools);
-  vk_commandbuffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  vk_commandbuffer_allocate_info.level = config.vk_level;
   VkResult vk_result =
       vkAllocateCommandBuffers(_vkb_device, &vk_commandbuffer_allocate_info,
                                &commandbuffer.vk_commandbuffer);
   check(vk_result == VK_SUCCESS, "Failed to allocate commandbuffer");
   handle_commandbuffer_t handle =
       utils::create_and_insert_new_handle<handle_commandbuffer_t>(
-          _commandbuffers, commandbuffer);
+          _commandbuffers, commandbuffer, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_COMMAND_BUFFER;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t>(commandbuffer.vk_commandbuffer);
-    vk_debug_utils_object_name_info.pObjectName =
-        commandbuffer.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("allocated commandbuffer {}",
-                  commandbuffer.config.debug_name);
+    horizon_trace("allocated commandbuffer {}", config.debug_name);
   } else {
     horizon_trace("allocated commandbuffer");
   }
@@ -2067,12 +3800,17 @@ void context_t::free_commandbuffer(handle_commandbuffer_t handle) {
   internal::commandbuffer_t &commandbuffer =
       utils::assert_and_get_data<internal::commandbuffer_t>(handle,
                                                             _commandbuffers);
-  vkFreeCommandBuffers(
-      _vkb_device,
+  VkCommandBuffer vk_commandbuffer = commandbuffer.vk_commandbuffer;
+  VkCommandPool   vk_command_pool =
       utils::assert_and_get_data<internal::command_pool_t>(
-          commandbuffer.config.handle_command_pool, _command_pools),
-      1, &commandbuffer.vk_commandbuffer);
+          commandbuffer.handle_command_pool, _command_pools);
+  close_commandbuffer(commandbuffer);
   _commandbuffers.erase(handle);
+  // queued before any destroy_command_pool of the owning pool, so the pool
+  // is still alive when this runs
+  defer_destruction([this, vk_command_pool, vk_commandbuffer]() {
+    vkFreeCommandBuffers(_vkb_device, vk_command_pool, 1, &vk_commandbuffer);
+  });
 }
 
 void context_t::begin_commandbuffer(handle_commandbuffer_t handle,
@@ -2081,6 +3819,8 @@ void context_t::begin_commandbuffer(handle_commandbuffer_t handle,
   internal::commandbuffer_t &commandbuffer =
       utils::assert_and_get_data<internal::commandbuffer_t>(handle,
                                                             _commandbuffers);
+  commandbuffer.handle_secondary_commandbuffers.clear();
+  open_commandbuffer(commandbuffer);
   VkCommandBufferBeginInfo vk_commandbuffer_begin_info{
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
   vk_commandbuffer_begin_info.flags =
@@ -2090,6 +3830,64 @@ void context_t::begin_commandbuffer(handle_commandbuffer_t handle,
   check(vk_result == VK_SUCCESS, "Failed to begin commandbuffer");
 }
 
+void context_t::begin_secondary_commandbuffer(
+    handle_commandbuffer_t         handle,
+    const rendering_inheritance_t &rendering_inheritance, bool single_use) {
+  horizon_profile();
+  internal::commandbuffer_t &commandbuffer =
+      utils::assert_and_get_data<internal::commandbuffer_t>(handle,
+                                                            _commandbuffers);
+  VkCommandBufferInheritanceRenderingInfo
+      vk_commandbuffer_inheritance_rendering_info{
+          .sType =
+              VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+  vk_commandbuffer_inheritance_rendering_info.colorAttachmentCount =
+      rendering_inheritance.vk_color_formats.size();
+  vk_commandbuffer_inheritance_rendering_info.pColorAttachmentFormats =
+      rendering_inheritance.vk_color_formats.data();
+  vk_commandbuffer_inheritance_rendering_info.depthAttachmentFormat =
+      rendering_inheritance.vk_depth_format;
+  vk_commandbuffer_inheritance_rendering_info.stencilAttachmentFormat =
+      rendering_inheritance.vk_stencil_format;
+  vk_commandbuffer_inheritance_rendering_info.rasterizationSamples =
+      rendering_inheritance.vk_samples;
+  VkCommandBufferInheritanceInfo vk_commandbuffer_inheritance_info{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+  vk_commandbuffer_inheritance_info.pNext =
+      &vk_commandbuffer_inheritance_rendering_info;
+  VkCommandBufferBeginInfo vk_commandbuffer_begin_info{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  vk_commandbuffer_begin_info.flags =
+      VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+      (single_use ? VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT : 0);
+  vk_commandbuffer_begin_info.pInheritanceInfo =
+      &vk_commandbuffer_inheritance_info;
+  open_commandbuffer(commandbuffer);
+  VkResult vk_result =
+      vkBeginCommandBuffer(commandbuffer, &vk_commandbuffer_begin_info);
+  check(vk_result == VK_SUCCESS, "Failed to begin secondary commandbuffer");
+}
+
+void context_t::open_commandbuffer(internal::commandbuffer_t &commandbuffer) {
+  horizon_profile();
+  std::scoped_lock lock{_retirement_mutex};
+  // beginning again implicitly resets, the earlier recording is gone
+  if (commandbuffer.begin_ticket != 0)
+    _open_commandbuffer_tickets.erase(
+        _open_commandbuffer_tickets.find(commandbuffer.begin_ticket));
+  commandbuffer.begin_ticket = _next_ticket++;
+  _open_commandbuffer_tickets.insert(commandbuffer.begin_ticket);
+}
+
+void context_t::close_commandbuffer(internal::commandbuffer_t &commandbuffer) {
+  horizon_profile();
+  std::scoped_lock lock{_retirement_mutex};
+  if (commandbuffer.begin_ticket == 0) return;
+  _open_commandbuffer_tickets.erase(
+      _open_commandbuffer_tickets.find(commandbuffer.begin_ticket));
+  commandbuffer.begin_ticket = 0;
+}
+
 void context_t::end_commandbuffer(handle_commandbuffer_t handle) {
   horizon_profile();
   internal::commandbuffer_t &commandbuffer =
@@ -2099,45 +3897,240 @@ void context_t::end_commandbuffer(handle_commandbuffer_t handle) {
   check(vk_result == VK_SUCCESS, "Failed to end commandbuffer");
 }
 
-void context_t::submit_commandbuffer(
+uint64_t context_t::submit(const submit_info_t &info) {
+  horizon_profile();
+  return submit(std::span<const submit_info_t>{&info, 1});
+}
+
+uint64_t context_t::submit(std::span<const submit_info_t> infos) {
+  horizon_profile();
+  if (infos.empty()) return _submitted_serial.load();
+
+  struct batch_t {
+    std::vector<internal::commandbuffer_t *> p_commandbuffers;
+    std::vector<VkCommandBufferSubmitInfo>   vk_commandbuffer_submit_infos;
+    std::vector<VkSemaphoreSubmitInfo>       vk_wait_semaphore_submit_infos;
+    std::vector<VkSemaphoreSubmitInfo>       vk_signal_semaphore_submit_infos;
+    internal::fence_t                       *p_fence = nullptr;
+    queue_type_t                             queue_type;
+    uint32_t                                 queue_timeline_index;
+  };
+  auto to_vk_semaphore_submit_info =
+      [this](const semaphore_submit_info_t &semaphore_submit_info) {
+        return VkSemaphoreSubmitInfo{
+            .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = utils::assert_and_get_data<internal::semaphore_t>(
+                semaphore_submit_info.handle_semaphore, _semaphores),
+            .value     = semaphore_submit_info.value,
+            .stageMask = semaphore_submit_info.vk_pipeline_stages,
+        };
+      };
+
+  std::vector<batch_t> batches(infos.size());
+  for (size_t i = 0; i < infos.size(); i++) {
+    const submit_info_t        &info = infos[i];
+    batch_t                    &batch = batches[i];
+    std::optional<queue_type_t> queue_type;
+    for (handle_commandbuffer_t handle : info.handle_commandbuffers) {
+      internal::commandbuffer_t &commandbuffer =
+          utils::assert_and_get_data<internal::commandbuffer_t>(
+              handle, _commandbuffers);
+      queue_type_t commandbuffer_queue_type =
+          utils::assert_and_get_data<internal::command_pool_t>(
+              commandbuffer.handle_command_pool, _command_pools)
+              .queue_type;
+      check(!queue_type || *queue_type == commandbuffer_queue_type,
+            "command buffers of one submission must target the same queue");
+      queue_type = commandbuffer_queue_type;
+      batch.p_commandbuffers.push_back(&commandbuffer);
+      for (handle_commandbuffer_t handle_secondary_commandbuffer :
+           commandbuffer.handle_secondary_commandbuffers)
+        batch.p_commandbuffers.push_back(
+            &utils::assert_and_get_data<internal::commandbuffer_t>(
+                handle_secondary_commandbuffer, _commandbuffers));
+      batch.vk_commandbuffer_submit_infos.push_back(
+          {.sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+           .commandBuffer = commandbuffer});
+    }
+    batch.queue_type = queue_type.value_or(queue_type_t::e_graphics);
+    batch.queue_timeline_index =
+        _queue_timeline_indices[static_cast<uint32_t>(batch.queue_type)];
+    for (const semaphore_submit_info_t &wait_semaphore : info.wait_semaphores)
+      batch.vk_wait_semaphore_submit_infos.push_back(
+          to_vk_semaphore_submit_info(wait_semaphore));
+    for (const semaphore_submit_info_t &signal_semaphore :
+         info.signal_semaphores)
+      batch.vk_signal_semaphore_submit_infos.push_back(
+          to_vk_semaphore_submit_info(signal_semaphore));
+    if (info.handle_fence != core::null_handle)
+      batch.p_fence = &utils::assert_and_get_data<internal::fence_t>(
+          info.handle_fence, _fences);
+  }
+
+  // the last batch for each queue signals that queue's timeline, which
+  // covers every earlier batch on the queue
+  std::vector<uint32_t> queue_timeline_indices;
+  std::vector<size_t>   last_batches(_queue_timelines.size());
+  for (size_t i = 0; i < batches.size(); i++) {
+    uint32_t queue_timeline_index = batches[i].queue_timeline_index;
+    if (std::find(queue_timeline_indices.begin(), queue_timeline_indices.end(),
+                  queue_timeline_index) == queue_timeline_indices.end())
+      queue_timeline_indices.push_back(queue_timeline_index);
+    last_batches[queue_timeline_index] = i;
+  }
+  for (uint32_t queue_timeline_index : queue_timeline_indices)
+    batches[last_batches[queue_timeline_index]]
+        .vk_signal_semaphore_submit_infos.push_back({
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore =
+                _queue_timelines[queue_timeline_index].vk_semaphore,
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        });
+
+  std::vector<VkSubmitInfo2> vk_submit_infos(batches.size());
+  for (size_t i = 0; i < batches.size(); i++) {
+    batch_t       &batch          = batches[i];
+    VkSubmitInfo2 &vk_submit_info = vk_submit_infos[i];
+    vk_submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    vk_submit_info.waitSemaphoreInfoCount =
+        batch.vk_wait_semaphore_submit_infos.size();
+    vk_submit_info.pWaitSemaphoreInfos =
+        batch.vk_wait_semaphore_submit_infos.data();
+    vk_submit_info.commandBufferInfoCount =
+        batch.vk_commandbuffer_submit_infos.size();
+    vk_submit_info.pCommandBufferInfos =
+        batch.vk_commandbuffer_submit_infos.data();
+    vk_submit_info.signalSemaphoreInfoCount =
+        batch.vk_signal_semaphore_submit_infos.size();
+    vk_submit_info.pSignalSemaphoreInfos =
+        batch.vk_signal_semaphore_submit_infos.data();
+  }
+
+  VkResult vk_result = VK_SUCCESS;
+  uint64_t serial;
+  {
+    std::scoped_lock lock{_queue_mutex};
+    // serials must reach the timelines in submission order, so the value is
+    // only picked once the queues are held
+    serial = _submitted_serial.load() + 1;
+    for (uint32_t queue_timeline_index : queue_timeline_indices)
+      batches[last_batches[queue_timeline_index]]
+          .vk_signal_semaphore_submit_infos.back()
+          .value = serial;
+
+    // infos go out in the caller's order, one vkQueueSubmit2 per run of
+    // infos on the same queue, split after every batch carrying a fence
+    // since a call only takes one. regrouping across queues could submit a
+    // binary semaphore wait ahead of its signal
+    size_t first = 0;
+    for (size_t i = 0; i < batches.size() && vk_result == VK_SUCCESS; i++) {
+      if (i + 1 < batches.size() && !batches[i].p_fence &&
+          batches[i + 1].queue_timeline_index ==
+              batches[i].queue_timeline_index)
+        continue;
+      vk_result = vkQueueSubmit2(
+          queue(batches[i].queue_type), i + 1 - first, &vk_submit_infos[first],
+          batches[i].p_fence ? batches[i].p_fence->vk_fence : VK_NULL_HANDLE);
+      first = i + 1;
+    }
+    if (vk_result == VK_SUCCESS) {
+      // the timelines first, completed_serial reads the submitted serial
+      // before them and must not see it ahead of the queue it went to
+      for (uint32_t queue_timeline_index : queue_timeline_indices)
+        _queue_timelines[queue_timeline_index].last_serial = serial;
+      _submitted_serial = serial;
+      for (batch_t &batch : batches) {
+        if (batch.p_fence) batch.p_fence->submit_serial = serial;
+        for (internal::commandbuffer_t *p_commandbuffer :
+             batch.p_commandbuffers)
+          p_commandbuffer->submit_serial = serial;
+      }
+    }
+  }
+  check(vk_result == VK_SUCCESS, "Failed to submit commandbuffers");
+  // closed only now that their serial is published, so a stamp taken while
+  // they were in flight to the queue cannot miss them
+  for (batch_t &batch : batches)
+    for (internal::commandbuffer_t *p_commandbuffer : batch.p_commandbuffers)
+      close_commandbuffer(*p_commandbuffer);
+  stamp_retirement_tickets();
+  return serial;
+}
+
+core::ticket_t<uint64_t> context_t::submit_async(submit_info_t info) {
+  horizon_profile();
+  std::promise<uint64_t>   promise;
+  core::ticket_t<uint64_t> ticket = promise.get_future().share();
+  if (!_submission_thread_alive) {
+    promise.set_value(submit(info));
+    return ticket;
+  }
+  _pending_submissions.push({std::move(info), std::move(promise)});
+  _submission_signal.fetch_add(1);
+  _submission_signal.notify_one();
+  return ticket;
+}
+
+void context_t::start_submission_thread() {
+  horizon_profile();
+  if (_submission_thread_alive) return;
+  _submission_thread_stop  = false;
+  _submission_thread_alive = true;
+  _submission_thread       = std::thread([this]() { submission_thread(); });
+}
+
+void context_t::stop_submission_thread() {
+  horizon_profile();
+  if (!_submission_thread_alive) return;
+  _submission_thread_stop = true;
+  _submission_signal.fetch_add(1);
+  _submission_signal.notify_one();
+  _submission_thread.join();
+  _submission_thread_alive = false;
+}
+
+void context_t::submission_thread() {
+  horizon_profile();
+  while (true) {
+    // read the signal before draining, a push that lands after the drain
+    // bumps it and the wait below returns immediately
+    uint64_t signal = _submission_signal.load();
+    std::vector<pending_submission_t> pending_submissions =
+        _pending_submissions.pop_all();
+    if (pending_submissions.empty()) {
+      if (_submission_thread_stop) return;
+      _submission_signal.wait(signal);
+      continue;
+    }
+    std::vector<submit_info_t> infos;
+    infos.reserve(pending_submissions.size());
+    for (pending_submission_t &pending_submission : pending_submissions)
+      infos.push_back(std::move(pending_submission.info));
+    uint64_t serial = submit(infos);
+    for (pending_submission_t &pending_submission : pending_submissions)
+      pending_submission.promise.set_value(serial);
+  }
+}
+
+uint64_t context_t::submit_commandbuffer(
     handle_commandbuffer_t                   handle,
     const std::vector<handle_semaphore_t>   &wait_semaphore_handles,
     const std::vector<VkPipelineStageFlags> &vk_pipeline_stages,
     const std::vector<handle_semaphore_t>   &signal_semaphore_handles,
     handle_fence_t                           handle_fence) {
   horizon_profile();
-  internal::commandbuffer_t &commandbuffer =
-      utils::assert_and_get_data<internal::commandbuffer_t>(handle,
-                                                            _commandbuffers);
-  VkSemaphore *p_vk_wait_semaphores = reinterpret_cast<VkSemaphore *>(
-      alloca(wait_semaphore_handles.size() * sizeof(VkSemaphore)));
-  VkSemaphore *p_vk_signal_semaphores = reinterpret_cast<VkSemaphore *>(
-      alloca(signal_semaphore_handles.size() * sizeof(VkSemaphore)));
-  for (size_t i = 0; i < wait_semaphore_handles.size(); i++) {
-    p_vk_wait_semaphores[i] = utils::assert_and_get_data<internal::semaphore_t>(
-        wait_semaphore_handles[i], _semaphores);
-  }
-  for (size_t i = 0; i < signal_semaphore_handles.size(); i++) {
-    p_vk_signal_semaphores[i] =
-        utils::assert_and_get_data<internal::semaphore_t>(
-            signal_semaphore_handles[i], _semaphores);
-  }
-  internal::fence_t &fence =
-      utils::assert_and_get_data<internal::fence_t>(handle_fence, _fences);
   assert(vk_pipeline_stages.size() == wait_semaphore_handles.size());
-
-  VkSubmitInfo vk_submit_info{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
-  vk_submit_info.waitSemaphoreCount   = wait_semaphore_handles.size();
-  vk_submit_info.pWaitSemaphores      = p_vk_wait_semaphores;
-  vk_submit_info.signalSemaphoreCount = signal_semaphore_handles.size();
-  vk_submit_info.pSignalSemaphores    = p_vk_signal_semaphores;
-  vk_submit_info.pWaitDstStageMask    = vk_pipeline_stages.data();
-  vk_submit_info.commandBufferCount   = 1;
-  vk_submit_info.pCommandBuffers      = &commandbuffer.vk_commandbuffer;
-
-  VkResult vk_result =
-      vkQueueSubmit(_graphics_queue.vk_queue, 1, &vk_submit_info, fence);
-  check(vk_result == VK_SUCCESS, "Failed to submit commandbuffer");
+  submit_info_t submit_info{.handle_commandbuffers = {handle},
+                            .handle_fence          = handle_fence};
+  // the legacy stage bits share their values with VkPipelineStageFlags2
+  for (size_t i = 0; i < wait_semaphore_handles.size(); i++)
+    submit_info.wait_semaphores.push_back(
+        {.handle_semaphore   = wait_semaphore_handles[i],
+         .vk_pipeline_stages = vk_pipeline_stages[i]});
+  for (handle_semaphore_t signal_semaphore_handle : signal_semaphore_handles)
+    submit_info.signal_semaphores.push_back(
+        {.handle_semaphore = signal_semaphore_handle});
+  return submit(submit_info);
 }
 
 internal::commandbuffer_t &context_t::get_commandbuffer(
@@ -2147,9 +4140,16 @@ internal::commandbuffer_t &context_t::get_commandbuffer(
                                                                _commandbuffers);
 }
 
+const config_commandbuffer_t &context_t::get_commandbuffer_config(
+    handle_commandbuffer_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_commandbuffer_t>(handle,
+                                                              _commandbuffers);
+}
+
 handle_timer_t context_t::create_timer(const config_timer_t &config) {
   horizon_profile();
-  internal::timer_t     timer{.config = config};
+  internal::timer_t     timer{};
   VkQueryPoolCreateInfo vk_query_pool_create_info{
       .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
   vk_query_pool_create_info.queryCount = 2;
@@ -2158,17 +4158,17 @@ handle_timer_t context_t::create_timer(const config_timer_t &config) {
       _vkb_device, &vk_query_pool_create_info, nullptr, &timer.vk_query_pool);
   check(vk_result == VK_SUCCESS, "Failed to create query pool");
   handle_timer_t handle =
-      utils::create_and_insert_new_handle<handle_timer_t>(_timers, timer);
+      utils::create_and_insert_new_handle<handle_timer_t>(
+          _timers, timer, config);
   if (config.debug_name != "") {
     VkDebugUtilsObjectNameInfoEXT vk_debug_utils_object_name_info{
         VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
     vk_debug_utils_object_name_info.objectType = VK_OBJECT_TYPE_QUERY_POOL;
     vk_debug_utils_object_name_info.objectHandle =
         reinterpret_cast<uint64_t &>(timer.vk_query_pool);
-    vk_debug_utils_object_name_info.pObjectName =
-        timer.config.debug_name.data();
+    vk_debug_utils_object_name_info.pObjectName = config.debug_name.data();
     vkSetDebugUtilsObjectNameEXT(_vkb_device, &vk_debug_utils_object_name_info);
-    horizon_trace("created timer {}", timer.config.debug_name);
+    horizon_trace("created timer {}", config.debug_name);
   } else {
     horizon_trace("created timer");
   }
@@ -2177,10 +4177,12 @@ handle_timer_t context_t::create_timer(const config_timer_t &config) {
 
 void context_t::destroy_timer(handle_timer_t handle) {
   horizon_profile();
-  internal::timer_t &timer =
+  VkQueryPool vk_query_pool =
       utils::assert_and_get_data<internal::timer_t>(handle, _timers);
-  vkDestroyQueryPool(_vkb_device, timer, nullptr);
   _timers.erase(handle);
+  defer_destruction([this, vk_query_pool]() {
+    vkDestroyQueryPool(_vkb_device, vk_query_pool, nullptr);
+  });
 }
 
 std::optional<float> context_t::timer_get_time(handle_timer_t handle) {
@@ -2211,6 +4213,11 @@ internal::timer_t &context_t::get_timer(handle_timer_t handle) {
   return utils::assert_and_get_data<internal::timer_t>(handle, _timers);
 }
 
+const config_timer_t &context_t::get_timer_config(handle_timer_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_config<config_timer_t>(handle, _timers);
+}
+
 void context_t::cmd_bind_pipeline(handle_commandbuffer_t handle_commandbuffer,
                                   handle_pipeline_t      handle_pipeline) {
   horizon_profile();
@@ -2226,7 +4233,8 @@ void context_t::cmd_bind_pipeline(handle_commandbuffer_t handle_commandbuffer,
 void context_t::cmd_bind_descriptor_sets(
     handle_commandbuffer_t handle_commandbuffer,
     handle_pipeline_t handle_pipeline, uint32_t vk_first_set,
-    const std::vector<handle_descriptor_set_t> &handle_descriptor_sets) {
+    const std::vector<handle_descriptor_set_t> &handle_descriptor_sets,
+    const std::vector<uint32_t>                &vk_dynamic_offsets) {
   horizon_profile();
   internal::commandbuffer_t &commandbuffer =
       utils::assert_and_get_data<internal::commandbuffer_t>(
@@ -2234,9 +4242,6 @@ void context_t::cmd_bind_descriptor_sets(
   internal::pipeline_t &pipeline =
       utils::assert_and_get_data<internal::pipeline_t>(handle_pipeline,
                                                        _pipelines);
-  internal::pipeline_layout_t &pipeline_layout =
-      utils::assert_and_get_data<internal::pipeline_layout_t>(
-          pipeline.config.handle_pipeline_layout, _pipeline_layouts);
   VkDescriptorSet *vk_descriptor_sets = reinterpret_cast<VkDescriptorSet *>(
       alloca(handle_descriptor_sets.size() * sizeof(VkDescriptorSet)));
   for (size_t i = 0; i < handle_descriptor_sets.size(); i++) {
@@ -2245,9 +4250,9 @@ void context_t::cmd_bind_descriptor_sets(
             handle_descriptor_sets[i], _descriptor_sets);
   }
   vkCmdBindDescriptorSets(commandbuffer, pipeline.vk_pipeline_bind_point,
-                          pipeline_layout, vk_first_set,
-                          handle_descriptor_sets.size(), vk_descriptor_sets, 0,
-                          nullptr);
+                          pipeline.vk_pipeline_layout, vk_first_set,
+                          handle_descriptor_sets.size(), vk_descriptor_sets,
+                          vk_dynamic_offsets.size(), vk_dynamic_offsets.data());
 }
 
 void context_t::cmd_push_constants(handle_commandbuffer_t handle_commandbuffer,
@@ -2262,11 +4267,8 @@ void context_t::cmd_push_constants(handle_commandbuffer_t handle_commandbuffer,
   internal::pipeline_t &pipeline =
       utils::assert_and_get_data<internal::pipeline_t>(handle_pipeline,
                                                        _pipelines);
-  internal::pipeline_layout_t &pipeline_layout =
-      utils::assert_and_get_data<internal::pipeline_layout_t>(
-          pipeline.config.handle_pipeline_layout, _pipeline_layouts);
-  vkCmdPushConstants(commandbuffer, pipeline_layout, vk_shader_stages,
-                     vk_offset, vk_size, vk_data);
+  vkCmdPushConstants(commandbuffer, pipeline.vk_pipeline_layout,
+                     vk_shader_stages, vk_offset, vk_size, vk_data);
 }
 
 void context_t::cmd_dispatch(handle_commandbuffer_t handle_commandbuffer,
@@ -2308,7 +4310,8 @@ void context_t::cmd_begin_rendering(
     handle_commandbuffer_t                       handle_commandbuffer,
     const std::vector<rendering_attachment_t>   &color_rendering_attachments,
     const std::optional<rendering_attachment_t> &depth_rendering_attachment,
-    const VkRect2D &vk_render_area, uint32_t vk_layer_count) {
+    const VkRect2D &vk_render_area, uint32_t vk_layer_count,
+    VkRenderingFlags vk_rendering_flags) {
   horizon_profile();
   internal::commandbuffer_t &commandbuffer =
       utils::assert_and_get_data<internal::commandbuffer_t>(
@@ -2349,6 +4352,7 @@ void context_t::cmd_begin_rendering(
             depth_rendering_attachment.value().handle_image_view, _image_views);
     vk_rendering_info.pDepthAttachment = &vk_depth_rendering_attachment;
   }
+  vk_rendering_info.flags                = vk_rendering_flags;
   vk_rendering_info.renderArea           = vk_render_area;
   vk_rendering_info.layerCount           = vk_layer_count;
   vk_rendering_info.colorAttachmentCount = color_rendering_attachments.size();
@@ -2364,6 +4368,28 @@ void context_t::cmd_end_rendering(handle_commandbuffer_t handle_commandbuffer) {
   vkCmdEndRendering(commandbuffer);
 }
 
+void context_t::cmd_execute_commands(
+    handle_commandbuffer_t handle_commandbuffer,
+    const std::vector<handle_commandbuffer_t>
+        &handle_secondary_commandbuffers) {
+  horizon_profile();
+  internal::commandbuffer_t &commandbuffer =
+      utils::assert_and_get_data<internal::commandbuffer_t>(
+          handle_commandbuffer, _commandbuffers);
+  VkCommandBuffer *p_vk_commandbuffers = reinterpret_cast<VkCommandBuffer *>(
+      alloca(handle_secondary_commandbuffers.size() * sizeof(VkCommandBuffer)));
+  for (size_t i = 0; i < handle_secondary_commandbuffers.size(); i++)
+    p_vk_commandbuffers[i] =
+        utils::assert_and_get_data<internal::commandbuffer_t>(
+            handle_secondary_commandbuffers[i], _commandbuffers);
+  commandbuffer.handle_secondary_commandbuffers.insert(
+      commandbuffer.handle_secondary_commandbuffers.end(),
+      handle_secondary_commandbuffers.begin(),
+      handle_secondary_commandbuffers.end());
+  vkCmdExecuteCommands(commandbuffer, handle_secondary_commandbuffers.size(),
+                       p_vk_commandbuffers);
+}
+
 void context_t::cmd_draw(handle_commandbuffer_t handle_commandbuffer,
                          uint32_t vk_vertex_count, uint32_t vk_instance_count,
                          uint32_t vk_first_vertex, uint32_t vk_first_instance) {
@@ -2409,6 +4435,26 @@ void context_t::cmd_blit_image(handle_commandbuffer_t handle_commandbuffer,
                  vk_image_blits.data(), vk_filter);
 }
 
+void context_t::cmd_copy_image(
+    handle_commandbuffer_t handle_commandbuffer,
+    handle_image_t         src_image_handle,
+    VkImageLayout          vk_src_image_layout,
+    handle_image_t         dst_image_handle,
+    VkImageLayout          vk_dst_image_layout,
+    const std::vector<VkImageCopy> &vk_image_copies) {
+  horizon_profile();
+  internal::commandbuffer_t &commandbuffer =
+      utils::assert_and_get_data<internal::commandbuffer_t>(
+          handle_commandbuffer, _commandbuffers);
+  internal::image_t &src_image =
+      utils::assert_and_get_data<internal::image_t>(src_image_handle, _images);
+  internal::image_t &dst_image =
+      utils::assert_and_get_data<internal::image_t>(dst_image_handle, _images);
+  vkCmdCopyImage(commandbuffer, src_image, vk_src_image_layout, dst_image,
+                 vk_dst_image_layout, vk_image_copies.size(),
+                 vk_image_copies.data());
+}
+
 void context_t::cmd_pipeline_barrier(
     handle_commandbuffer_t                    handle_commandbuffer,
     VkPipelineStageFlags                      vk_src_pipeline_stage_flags,
@@ -2432,9 +4478,10 @@ void context_t::cmd_image_memory_barrier(
     handle_commandbuffer_t handle_commandbuffer, handle_image_t handle_image,
     VkImageLayout vk_old_image_layout, VkImageLayout vk_new_image_layout,
     VkAccessFlags vk_src_access_mask, VkAccessFlags vk_dst_access_mask,
-    VkPipelineStageFlags          vk_src_pipeline_stage,
-    VkPipelineStageFlags          vk_dst_pipeline_stage,
-    const image_resource_range_t &image_resource_range) {
+    VkPipelineStageFlags              vk_src_pipeline_stage,
+    VkPipelineStageFlags              vk_dst_pipeline_stage,
+    const image_resource_range_t     &image_resource_range,
+    const queue_ownership_transfer_t &queue_ownership_transfer) {
   horizon_profile();
   internal::commandbuffer_t &commandbuffer =
       utils::assert_and_get_data<internal::commandbuffer_t>(
@@ -2445,11 +4492,11 @@ void context_t::cmd_image_memory_barrier(
       .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
   vk_image_memory_barrier.oldLayout           = vk_old_image_layout;
   vk_image_memory_barrier.newLayout           = vk_new_image_layout;
-  vk_image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  vk_image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  std::tie(vk_image_memory_barrier.srcQueueFamilyIndex,
+           vk_image_memory_barrier.dstQueueFamilyIndex) =
+      queue_family_indices(queue_ownership_transfer);
   vk_image_memory_barrier.image               = image;
-  vk_image_memory_barrier.subresourceRange.aspectMask =
-      utils::get_image_aspect(image.config.vk_format);
+  vk_image_memory_barrier.subresourceRange.aspectMask = image.vk_image_aspect;
   vk_image_memory_barrier.subresourceRange.baseMipLevel =
       image_resource_range.base_mip_level;
   vk_image_memory_barrier.subresourceRange.levelCount =
@@ -2468,9 +4515,10 @@ void context_t::cmd_image_memory_barrier(
 void context_t::cmd_buffer_memory_barrier(
     handle_commandbuffer_t handle_commandbuffer, handle_buffer_t handle_buffer,
     VkAccessFlags vk_src_access_mask, VkAccessFlags vk_dst_access_mask,
-    VkPipelineStageFlags           vk_src_pipeline_stage,
-    VkPipelineStageFlags           vk_dst_pipeline_stage,
-    const buffer_resource_range_t &buffer_resource_range) {
+    VkPipelineStageFlags              vk_src_pipeline_stage,
+    VkPipelineStageFlags              vk_dst_pipeline_stage,
+    const buffer_resource_range_t    &buffer_resource_range,
+    const queue_ownership_transfer_t &queue_ownership_transfer) {
   horizon_profile();
   internal::commandbuffer_t &commandbuffer =
       utils::assert_and_get_data<internal::commandbuffer_t>(
@@ -2482,8 +4530,9 @@ void context_t::cmd_buffer_memory_barrier(
   vk_buffer_memory_barrier.srcAccessMask       = vk_src_access_mask;
   vk_buffer_memory_barrier.dstAccessMask       = vk_dst_access_mask;
   vk_buffer_memory_barrier.buffer              = buffer;
-  vk_buffer_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  vk_buffer_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  std::tie(vk_buffer_memory_barrier.srcQueueFamilyIndex,
+           vk_buffer_memory_barrier.dstQueueFamilyIndex) =
+      queue_family_indices(queue_ownership_transfer);
   vk_buffer_memory_barrier.size                = buffer_resource_range.size;
   vk_buffer_memory_barrier.offset              = buffer_resource_range.offset;
   vkCmdPipelineBarrier(commandbuffer, vk_src_pipeline_stage,
@@ -2596,6 +4645,41 @@ internal::queue_t &context_t::graphics_queue() { return _graphics_queue; }
 
 internal::queue_t &context_t::present_queue() { return _present_queue; }
 
-VkDescriptorPool &context_t::descriptor_pool() { return _vk_descriptor_pool; }
+internal::queue_t &context_t::compute_queue() { return _compute_queue; }
+
+internal::queue_t &context_t::transfer_queue() { return _transfer_queue; }
+
+std::pair<uint32_t, uint32_t> context_t::queue_family_indices(
+    const queue_ownership_transfer_t &queue_ownership_transfer) {
+  uint32_t src_index = queue(queue_ownership_transfer.src_queue_type).vk_index;
+  uint32_t dst_index = queue(queue_ownership_transfer.dst_queue_type).vk_index;
+  if (src_index == dst_index)
+    return {VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED};
+  return {src_index, dst_index};
+}
+
+internal::queue_t &context_t::queue(queue_type_t queue_type) {
+  switch (queue_type) {
+    case queue_type_t::e_graphics:
+      return _graphics_queue;
+    case queue_type_t::e_compute:
+      return _compute_queue;
+    case queue_type_t::e_transfer:
+      return _transfer_queue;
+    default:
+      horizon_error("unknown queue type");
+      std::terminate();
+  }
+}
+
+VkDescriptorPool &context_t::imgui_descriptor_pool() {
+  return _vk_imgui_descriptor_pool;
+}
+
+std::mutex &context_t::queue_mutex() { return _queue_mutex; }
+
+VkPipelineCache &context_t::pipeline_cache() { return _vk_pipeline_cache; }
+
+core::thread_pool_t &context_t::thread_pool() { return *_thread_pool; }
 
 }  // namespace gfx
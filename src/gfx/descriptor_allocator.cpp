@@ -0,0 +1,156 @@
+#include "horizon/gfx/descriptor_allocator.hpp"
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+#include "horizon/gfx/context.hpp"
+
+#include <algorithm>
+
+namespace gfx {
+
+descriptor_allocator_t::descriptor_allocator_t(
+    context_t &context, VkDescriptorPoolCreateFlags vk_descriptor_pool_flags,
+    uint32_t sets_per_pool, const std::vector<descriptor_pool_ratio_t> &ratios)
+    : _context(context),
+      _vk_device(context.device()),
+      _vk_descriptor_pool_flags(vk_descriptor_pool_flags),
+      _ratios(ratios),
+      _sets_per_pool(sets_per_pool) {
+  horizon_profile();
+}
+
+descriptor_allocator_t::~descriptor_allocator_t() {
+  horizon_profile();
+  for (VkDescriptorPool vk_descriptor_pool : _ready_pools)
+    _context.destroy_descriptor_pool(vk_descriptor_pool);
+  for (VkDescriptorPool vk_descriptor_pool : _full_pools)
+    _context.destroy_descriptor_pool(vk_descriptor_pool);
+}
+
+VkDescriptorSet descriptor_allocator_t::allocate(
+    VkDescriptorSetAllocateInfo           vk_descriptor_set_allocate_info,
+    std::span<const VkDescriptorPoolSize> vk_set_pool_sizes,
+    VkDescriptorPool                      *p_vk_descriptor_pool) {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  VkDescriptorSet  vk_descriptor_set;
+  // a set bigger than a pool is sized for failing says nothing about whether
+  // the pool still has room for ordinary sets, so it never retires a pool
+  bool             oversized = !fits_pool(vk_set_pool_sizes);
+  for (size_t i = _ready_pools.size(); i-- > 0;) {
+    VkDescriptorPool vk_descriptor_pool = _ready_pools[i];
+    vk_descriptor_set_allocate_info.descriptorPool = vk_descriptor_pool;
+    VkResult vk_result =
+        vkAllocateDescriptorSets(_vk_device, &vk_descriptor_set_allocate_info,
+                                 &vk_descriptor_set);
+    if (vk_result == VK_SUCCESS) {
+      if (p_vk_descriptor_pool) *p_vk_descriptor_pool = vk_descriptor_pool;
+      return vk_descriptor_set;
+    }
+    check(vk_result == VK_ERROR_OUT_OF_POOL_MEMORY ||
+              vk_result == VK_ERROR_FRAGMENTED_POOL,
+          "Failed to allocate descriptor set");
+    if (oversized) continue;
+    _full_pools.push_back(vk_descriptor_pool);
+    _ready_pools.erase(_ready_pools.begin() + i);
+  }
+  VkDescriptorPool vk_descriptor_pool = create_pool(vk_set_pool_sizes);
+  // an oversized set's pool goes to the front so ordinary sets keep filling
+  // the newest right sized pool, and it does not grow the next pool
+  if (oversized) {
+    _ready_pools.insert(_ready_pools.begin(), vk_descriptor_pool);
+  } else {
+    _ready_pools.push_back(vk_descriptor_pool);
+    _sets_per_pool =
+        std::min(_sets_per_pool + std::max(_sets_per_pool / 2, 1u),
+                 max_sets_per_pool);
+  }
+  vk_descriptor_set_allocate_info.descriptorPool = vk_descriptor_pool;
+  VkResult vk_result = vkAllocateDescriptorSets(
+      _vk_device, &vk_descriptor_set_allocate_info, &vk_descriptor_set);
+  check(vk_result == VK_SUCCESS, "Failed to allocate descriptor set");
+  if (p_vk_descriptor_pool) *p_vk_descriptor_pool = vk_descriptor_pool;
+  return vk_descriptor_set;
+}
+
+void descriptor_allocator_t::free(VkDescriptorPool vk_descriptor_pool,
+                                  VkDescriptorSet  vk_descriptor_set) {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  VkResult         vk_result = vkFreeDescriptorSets(
+      _vk_device, vk_descriptor_pool, 1, &vk_descriptor_set);
+  check(vk_result == VK_SUCCESS, "Failed to free descriptor set");
+  // the freed set made room, so the pool is worth trying again
+  auto itr = std::find(_full_pools.begin(), _full_pools.end(),
+                       vk_descriptor_pool);
+  if (itr != _full_pools.end()) {
+    _full_pools.erase(itr);
+    _ready_pools.insert(_ready_pools.begin(), vk_descriptor_pool);
+  }
+}
+
+void descriptor_allocator_t::reset() {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  for (VkDescriptorPool vk_descriptor_pool : _ready_pools)
+    vkResetDescriptorPool(_vk_device, vk_descriptor_pool, 0);
+  for (VkDescriptorPool vk_descriptor_pool : _full_pools) {
+    vkResetDescriptorPool(_vk_device, vk_descriptor_pool, 0);
+    _ready_pools.push_back(vk_descriptor_pool);
+  }
+  _full_pools.clear();
+}
+
+VkDescriptorPool descriptor_allocator_t::create_pool(
+    std::span<const VkDescriptorPoolSize> vk_set_pool_sizes) {
+  horizon_profile();
+  std::vector<VkDescriptorPoolSize> vk_pool_sizes;
+  for (const descriptor_pool_ratio_t &ratio : _ratios)
+    vk_pool_sizes.push_back(
+        {.type            = ratio.vk_descriptor_type,
+         .descriptorCount = std::max(
+             1u, static_cast<uint32_t>(ratio.ratio * _sets_per_pool))});
+  for (const VkDescriptorPoolSize &vk_set_pool_size : vk_set_pool_sizes) {
+    auto itr = std::find_if(vk_pool_sizes.begin(), vk_pool_sizes.end(),
+                            [&](const VkDescriptorPoolSize &vk_pool_size) {
+                              return vk_pool_size.type == vk_set_pool_size.type;
+                            });
+    if (itr == vk_pool_sizes.end())
+      vk_pool_sizes.push_back(vk_set_pool_size);
+    else
+      itr->descriptorCount =
+          std::max(itr->descriptorCount, vk_set_pool_size.descriptorCount);
+  }
+
+  VkDescriptorPoolCreateInfo vk_descriptor_pool_create_info{
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+  vk_descriptor_pool_create_info.flags         = _vk_descriptor_pool_flags;
+  vk_descriptor_pool_create_info.maxSets       = _sets_per_pool;
+  vk_descriptor_pool_create_info.poolSizeCount = vk_pool_sizes.size();
+  vk_descriptor_pool_create_info.pPoolSizes    = vk_pool_sizes.data();
+  VkDescriptorPool vk_descriptor_pool;
+  VkResult         vk_result =
+      vkCreateDescriptorPool(_vk_device, &vk_descriptor_pool_create_info,
+                             nullptr, &vk_descriptor_pool);
+  check(vk_result == VK_SUCCESS, "Failed to create descriptor pool");
+  horizon_trace("created descriptor pool for {} sets", _sets_per_pool);
+  return vk_descriptor_pool;
+}
+
+bool descriptor_allocator_t::fits_pool(
+    std::span<const VkDescriptorPoolSize> vk_set_pool_sizes) const {
+  for (const VkDescriptorPoolSize &vk_set_pool_size : vk_set_pool_sizes) {
+    auto itr = std::find_if(_ratios.begin(), _ratios.end(),
+                            [&](const descriptor_pool_ratio_t &ratio) {
+                              return ratio.vk_descriptor_type ==
+                                     vk_set_pool_size.type;
+                            });
+    if (itr == _ratios.end()) return false;
+    if (vk_set_pool_size.descriptorCount >
+        std::max(1u, static_cast<uint32_t>(itr->ratio * _sets_per_pool)))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace gfx
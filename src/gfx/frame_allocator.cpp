@@ -0,0 +1,65 @@
+#include "horizon/gfx/frame_allocator.hpp"
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+
+#include <algorithm>
+
+namespace gfx {
+
+frame_allocator_t::frame_allocator_t(context_t &context, uint32_t frame_count,
+                                     VkDeviceSize vk_size_per_frame)
+    : _context(context) {
+  horizon_profile();
+  const VkPhysicalDeviceLimits &vk_limits =
+      _context.physical_device().properties.limits;
+  _vk_alignment = std::max(vk_limits.minUniformBufferOffsetAlignment,
+                           vk_limits.minStorageBufferOffsetAlignment);
+  // slices start aligned so offsets into any of them are too
+  _vk_size_per_frame = (vk_size_per_frame + _vk_alignment - 1) /
+                       _vk_alignment * _vk_alignment;
+  config_buffer_t config_buffer{};
+  config_buffer.vk_size = _vk_size_per_frame * frame_count;
+  config_buffer.vk_buffer_usage_flags =
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  config_buffer.vma_allocation_create_flags =
+      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+  config_buffer.debug_name = "frame allocator";
+  _handle_buffer           = _context.create_buffer(config_buffer);
+  _p_data = reinterpret_cast<uint8_t *>(_context.map_buffer(_handle_buffer));
+  _vk_device_address = _context.get_buffer_device_address(_handle_buffer);
+  begin_frame(0);
+}
+
+frame_allocator_t::~frame_allocator_t() {
+  horizon_profile();
+  _context.destroy_buffer(_handle_buffer);
+}
+
+void frame_allocator_t::begin_frame(uint32_t frame) {
+  horizon_profile();
+  _offset = frame * _vk_size_per_frame;
+  _end    = _offset + _vk_size_per_frame;
+}
+
+frame_allocation_t frame_allocator_t::allocate(VkDeviceSize vk_size,
+                                               VkDeviceSize vk_alignment) {
+  horizon_profile();
+  if (vk_alignment == 0) vk_alignment = _vk_alignment;
+  VkDeviceSize offset = _offset.load();
+  VkDeviceSize aligned_offset;
+  do {
+    aligned_offset =
+        (offset + vk_alignment - 1) / vk_alignment * vk_alignment;
+  } while (!_offset.compare_exchange_weak(offset, aligned_offset + vk_size));
+  check(aligned_offset + vk_size <= _end,
+        "frame allocator ran out of space, {} bytes per frame",
+        _vk_size_per_frame);
+  return {.p_data            = _p_data + aligned_offset,
+          .vk_device_address = _vk_device_address + aligned_offset,
+          .vk_offset         = static_cast<uint32_t>(aligned_offset)};
+}
+
+handle_buffer_t frame_allocator_t::buffer() { return _handle_buffer; }
+
+}  // namespace gfx
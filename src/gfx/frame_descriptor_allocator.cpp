@@ -0,0 +1,48 @@
+#include "horizon/gfx/frame_descriptor_allocator.hpp"
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+
+namespace gfx {
+
+frame_descriptor_allocator_t::frame_descriptor_allocator_t(
+    context_t &context, uint32_t frame_count, uint32_t sets_per_pool)
+    : _context(context) {
+  horizon_profile();
+  _frames.resize(frame_count);
+  // no free bit, the pools are only ever reset as a whole
+  for (frame_t &frame : _frames)
+    frame.descriptor_allocator = std::make_unique<descriptor_allocator_t>(
+        _context, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT,
+        sets_per_pool);
+}
+
+frame_descriptor_allocator_t::~frame_descriptor_allocator_t() {
+  horizon_profile();
+  // the sets go away with the pools, which are destroyed deferred
+  for (frame_t &frame : _frames)
+    _context.forget_descriptor_sets(frame.handle_descriptor_sets);
+}
+
+void frame_descriptor_allocator_t::begin_frame(uint32_t frame) {
+  horizon_profile();
+  check(frame < _frames.size(), "frame {} is out of range", frame);
+  std::scoped_lock lock{_mutex};
+  _current_frame = frame;
+  _context.forget_descriptor_sets(_frames[frame].handle_descriptor_sets);
+  _frames[frame].handle_descriptor_sets.clear();
+  _frames[frame].descriptor_allocator->reset();
+}
+
+handle_descriptor_set_t frame_descriptor_allocator_t::allocate(
+    const config_descriptor_set_t &config) {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  frame_t                &frame  = _frames[_current_frame];
+  handle_descriptor_set_t handle =
+      _context.allocate_descriptor_set(config, *frame.descriptor_allocator);
+  frame.handle_descriptor_sets.push_back(handle);
+  return handle;
+}
+
+}  // namespace gfx
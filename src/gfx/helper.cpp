@@ -37,8 +37,10 @@ handle_commandbuffer_t
 begin_single_use_commandbuffer(context_t &context,
                                handle_command_pool_t command_pool) {
   horizon_profile();
-  handle_commandbuffer_t cbuf =
-      context.allocate_commandbuffer({.handle_command_pool = command_pool});
+  // the pool only picks the queue, the command buffer comes from the calling
+  // thread's ring so uploads in a loop allocate nothing
+  handle_commandbuffer_t cbuf = context.acquire_commandbuffer(
+      context.get_command_pool_config(command_pool).queue_type);
   context.begin_commandbuffer(cbuf, true);
   return cbuf;
 }
@@ -46,13 +48,37 @@ begin_single_use_commandbuffer(context_t &context,
 void end_single_use_command_buffer(context_t &context,
                                    handle_commandbuffer_t handle) {
   horizon_profile();
-  handle_fence_t fence = context.create_fence({});
   context.end_commandbuffer(handle);
-  context.reset_fence(fence);
-  context.submit_commandbuffer(handle, {}, {}, {}, fence);
-  context.wait_fence(fence);
-  context.destroy_fence(fence);
-  context.free_commandbuffer(handle);
+  context.wait_serial(context.submit({.handle_commandbuffers = {handle}}));
+}
+
+std::vector<handle_commandbuffer_t> record_secondary_commandbuffers(
+    context_t &context, const rendering_inheritance_t &rendering_inheritance,
+    size_t count,
+    const std::function<void(handle_commandbuffer_t, size_t, size_t)> &record,
+    uint32_t worker_count) {
+  horizon_profile();
+  if (worker_count == 0)
+    worker_count = context.thread_pool().thread_count();
+  std::vector<core::ticket_t<handle_commandbuffer_t>> tickets;
+  for (uint32_t i = 0; i < worker_count; i++) {
+    size_t begin = count * i / worker_count;
+    size_t end = count * (i + 1) / worker_count;
+    if (begin == end)
+      continue;
+    tickets.push_back(context.thread_pool().submit([&, begin, end]() {
+      handle_commandbuffer_t cbuf = context.acquire_commandbuffer(
+          queue_type_t::e_graphics, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+      context.begin_secondary_commandbuffer(cbuf, rendering_inheritance, true);
+      record(cbuf, begin, end);
+      context.end_commandbuffer(cbuf);
+      return cbuf;
+    }));
+  }
+  std::vector<handle_commandbuffer_t> cbufs;
+  for (core::ticket_t<handle_commandbuffer_t> &ticket : tickets)
+    cbufs.push_back(ticket.get());
+  return cbufs;
 }
 
 VkImageAspectFlags image_aspect_from_format(VkFormat vk_format) {
@@ -76,6 +102,7 @@ void cmd_transition_image_layout(context_t &context,
                                  uint32_t base_mip_level,
                                  uint32_t level_count) {
   internal::image_t &image = context.get_image(handle);
+  const config_image_t &config_image = context.get_image_config(handle);
 
   VkImageMemoryBarrier vk_image_memory_barrier{};
   vk_image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -85,11 +112,11 @@ void cmd_transition_image_layout(context_t &context,
   vk_image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   vk_image_memory_barrier.image = image;
   vk_image_memory_barrier.subresourceRange.aspectMask =
-      image_aspect_from_format(image.config.vk_format);
+      image_aspect_from_format(config_image.vk_format);
   vk_image_memory_barrier.subresourceRange.baseMipLevel = base_mip_level;
   if (level_count == vk_auto_mips)
     vk_image_memory_barrier.subresourceRange.levelCount =
-        image.config.vk_mips - base_mip_level;
+        config_image.vk_mips - base_mip_level;
   else
     vk_image_memory_barrier.subresourceRange.levelCount = level_count;
   vk_image_memory_barrier.subresourceRange.baseArrayLayer = 0;
@@ -211,7 +238,8 @@ void cmd_generate_image_mip_maps(context_t &context,
                                  VkFilter vk_filter) {
   horizon_profile();
   internal::image_t &image = context.get_image(handle);
-  check(image.config.vk_mips != 1,
+  const config_image_t &config_image = context.get_image_config(handle);
+  check(config_image.vk_mips != 1,
         "cannot generate mip maps for image!"); // maybe dont fail if cannot
                                                 // generate ?
 
@@ -231,11 +259,11 @@ void cmd_generate_image_mip_maps(context_t &context,
   vk_image_memory_barrier.subresourceRange.baseArrayLayer = 0;
   vk_image_memory_barrier.subresourceRange.layerCount = 1;
 
-  uint32_t mip_width = image.config.vk_width;
-  uint32_t mip_height = image.config.vk_height;
-  uint32_t mip_depth = image.config.vk_depth;
+  uint32_t mip_width = config_image.vk_width;
+  uint32_t mip_height = config_image.vk_height;
+  uint32_t mip_depth = config_image.vk_depth;
 
-  for (size_t i = 1; i < image.config.vk_mips; i++) {
+  for (size_t i = 1; i < config_image.vk_mips; i++) {
     vk_image_memory_barrier.subresourceRange.baseMipLevel = i - 1;
     vk_image_memory_barrier.oldLayout = vk_old_layout;
     vk_image_memory_barrier.newLayout =
@@ -304,7 +332,7 @@ void cmd_generate_image_mip_maps(context_t &context,
   }
 
   vk_image_memory_barrier.subresourceRange.baseMipLevel =
-      image.config.vk_mips - 1;
+      config_image.vk_mips - 1;
   vk_image_memory_barrier.oldLayout = vk_old_layout;
   vk_image_memory_barrier.newLayout = vk_new_layout;
   vk_image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
@@ -316,9 +344,11 @@ void cmd_generate_image_mip_maps(context_t &context,
                                {vk_image_memory_barrier});
 }
 
-handle_image_t load_image_from_path_instant(
-    context_t &context, handle_command_pool_t handle_command_pool,
-    const std::filesystem::path &path, VkFormat vk_format) {
+handle_image_t load_image_from_path(context_t &context,
+                                    staging_ring_t &staging_ring,
+                                    const std::filesystem::path &path,
+                                    VkFormat vk_format) {
+  horizon_profile();
   int width, height, channels;
   stbi_set_flip_vertically_on_load(true);
   stbi_uc *pixels = stbi_load(path.string().c_str(), &width, &height, &channels,
@@ -329,17 +359,6 @@ handle_image_t load_image_from_path_instant(
   horizon_trace("{} image loaded, width: {} height: {} device memory: {}",
                 path.string(), width, height, vk_image_size);
 
-  config_buffer_t config_staging_buffer{};
-  config_staging_buffer.vk_size = vk_image_size;
-  config_staging_buffer.vk_buffer_usage_flags =
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-  config_staging_buffer.vma_allocation_create_flags =
-      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-  handle_buffer_t staging_buffer = context.create_buffer(config_staging_buffer);
-  std::memcpy(context.map_buffer(staging_buffer), pixels, vk_image_size);
-
-  stbi_image_free(pixels);
-
   config_image_t config_image{};
   config_image.vk_width = width;
   config_image.vk_height = height;
@@ -350,69 +369,23 @@ handle_image_t load_image_from_path_instant(
                           VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
                           VK_IMAGE_USAGE_SAMPLED_BIT;
   handle_image_t image = context.create_image(config_image);
+  staging_ring.upload_image(image, pixels, vk_image_size);
 
-  handle_commandbuffer_t cbuf =
-      begin_single_use_commandbuffer(context, handle_command_pool);
-  cmd_transition_image_layout(context, cbuf, image, VK_IMAGE_LAYOUT_UNDEFINED,
-                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  context.cmd_copy_buffer_to_image(
-      cbuf, staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      {
-          .bufferOffset = 0,
-          .bufferRowLength = 0,
-          .bufferImageHeight = 0,
-          .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                               .mipLevel = 0,
-                               .baseArrayLayer = 0,
-                               .layerCount = 1},
-          .imageOffset = {0, 0, 0},
-          .imageExtent = {static_cast<uint32_t>(width),
-                          static_cast<uint32_t>(height), 1u},
-      });
-
-  internal::image_t &internal_image = context.get_image(image);
-  if (internal_image.config.vk_mips != 1)
-    cmd_generate_image_mip_maps(
-        context, cbuf, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FILTER_LINEAR);
-  else
-    cmd_transition_image_layout(context, cbuf, image,
-                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-  end_single_use_command_buffer(context, cbuf);
-
-  context.destroy_buffer(staging_buffer);
+  stbi_image_free(pixels);
 
   return image;
 }
 
 handle_buffer_t create_buffer_staged(context_t &context,
-                                     handle_command_pool_t handle_command_pool,
+                                     staging_ring_t &staging_ring,
                                      config_buffer_t config, const void *data,
                                      size_t size) {
+  horizon_profile();
   horizon_assert(size <= config.vk_size, "copying more than allocated");
 
   config.vk_buffer_usage_flags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
   handle_buffer_t buffer = context.create_buffer(config);
-
-  config_buffer_t config_staging_buffer{};
-  config_staging_buffer.vk_size = config.vk_size;
-  config_staging_buffer.vma_allocation_create_flags =
-      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-  config_staging_buffer.vk_buffer_usage_flags =
-      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-  handle_buffer_t staging_buffer = context.create_buffer(config_staging_buffer);
-
-  std::memcpy(context.map_buffer(staging_buffer), data, size);
-
-  handle_commandbuffer_t cbuf =
-      begin_single_use_commandbuffer(context, handle_command_pool);
-  context.cmd_copy_buffer(
-      cbuf, staging_buffer, buffer,
-      {.vk_src_offset = 0, .vk_dst_offset = 0, .vk_size = size});
-  end_single_use_command_buffer(context, cbuf);
-
-  context.destroy_buffer(staging_buffer);
+  staging_ring.upload_buffer(buffer, data, size);
 
   return buffer;
 }
@@ -449,7 +422,7 @@ void imgui_init(core::window_t &window, context_t &context,
   initInfo.Queue = context.graphics_queue();
 
   initInfo.PipelineCache = VK_NULL_HANDLE;
-  initInfo.DescriptorPool = context.descriptor_pool();
+  initInfo.DescriptorPool = context.imgui_descriptor_pool();
 
   initInfo.Allocator = VK_NULL_HANDLE;
   initInfo.MinImageCount = 2;
@@ -516,6 +489,19 @@ gfx::handle_shader_t create_slang_shader(context_t &context,
   return context.create_shader(cs);
 }
 
+std::vector<gfx::handle_shader_t>
+create_slang_shader_program(context_t &context,
+                            const std::filesystem::path &file_path,
+                            const std::vector<shader_type_t> &types) {
+  config_shader_program_t csp{};
+  csp.code_or_path = file_path.string();
+  csp.is_code = false;
+  csp.name = file_path.filename().string();
+  csp.types = types;
+  csp.language = shader_language_t::e_slang;
+  return context.create_shader_program(csp);
+}
+
 } // namespace helper
 
 } // namespace gfx
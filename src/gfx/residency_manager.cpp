@@ -0,0 +1,389 @@
+#include "horizon/gfx/residency_manager.hpp"
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+#include "horizon/gfx/helper.hpp"
+
+#include <algorithm>
+
+namespace gfx {
+
+static uint32_t mip_extent(uint32_t extent, uint32_t mip) {
+  return std::max(extent >> mip, 1u);
+}
+
+residency_manager_t::residency_manager_t(
+    context_t &context, staging_ring_t &staging_ring,
+    const config_residency_manager_t &config)
+    : _context(context), _staging_ring(staging_ring), _config(config) {
+  horizon_profile();
+  if (!_context.has_memory_budget())
+    horizon_warn(
+        "VK_EXT_memory_budget is not available, residency follows vma's "
+        "estimated budgets");
+}
+
+residency_manager_t::~residency_manager_t() {
+  horizon_profile();
+  // load functions may reference what the app destroys after the manager
+  for (auto [handle, texture] : _textures)
+    if (texture.load_ticket.valid()) texture.load_ticket.wait();
+  // pending copies may still read retired images
+  _staging_ring.flush();
+  for (retired_image_t &retired_image : _retired_images) {
+    _context.destroy_image_view(retired_image.handle_image_view);
+    _context.destroy_image(retired_image.handle_image);
+  }
+  for (auto [handle, texture] : _textures) {
+    if (texture.handle_image == core::null_handle) continue;
+    _context.destroy_image_view(texture.handle_image_view);
+    _context.destroy_image(texture.handle_image);
+  }
+}
+
+handle_resident_texture_t residency_manager_t::create_texture(
+    const config_resident_texture_t &config) {
+  horizon_profile();
+  check(config.load, "resident texture {} has no load function",
+        config.config_image.debug_name);
+  config_resident_texture_t config_texture = config;
+  // copy sources when mips are dropped and copy destinations on load
+  config_texture.config_image.vk_usage |=
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  internal::resident_texture_t texture{};
+  texture.priority        = config.priority;
+  texture.last_used_frame = _frame;
+  handle_resident_texture_t handle =
+      utils::create_and_insert_new_handle<handle_resident_texture_t>(
+          _textures, texture, config_texture);
+  upload(handle, config.load());
+  return handle;
+}
+
+void residency_manager_t::destroy_texture(handle_resident_texture_t handle) {
+  horizon_profile();
+  retire_image(
+      utils::assert_and_get_data<internal::resident_texture_t>(handle,
+                                                                _textures));
+  _textures.erase(handle);
+  std::erase(_changed, handle);
+}
+
+void residency_manager_t::touch(handle_resident_texture_t handle) {
+  horizon_profile();
+  utils::assert_and_get_data<internal::resident_texture_t>(handle, _textures)
+      .last_used_frame = _frame;
+}
+
+void residency_manager_t::set_priority(handle_resident_texture_t handle,
+                                       uint32_t                  priority) {
+  horizon_profile();
+  utils::assert_and_get_data<internal::resident_texture_t>(handle, _textures)
+      .priority = priority;
+}
+
+handle_image_view_t residency_manager_t::image_view(
+    handle_resident_texture_t handle) {
+  horizon_profile();
+  internal::resident_texture_t &texture =
+      utils::assert_and_get_data<internal::resident_texture_t>(handle,
+                                                                _textures);
+  if (texture.handle_image_view == core::null_handle)
+    return _config.fallback_image_view;
+  return texture.handle_image_view;
+}
+
+uint32_t residency_manager_t::dropped_mips(handle_resident_texture_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::resident_texture_t>(handle,
+                                                                   _textures)
+      .dropped_mips;
+}
+
+bool residency_manager_t::is_evicted(handle_resident_texture_t handle) {
+  horizon_profile();
+  return utils::assert_and_get_data<internal::resident_texture_t>(handle,
+                                                                   _textures)
+             .handle_image == core::null_handle;
+}
+
+const std::vector<handle_resident_texture_t> &residency_manager_t::update() {
+  horizon_profile();
+  _changed.clear();
+  _frame++;
+  _context.refresh_memory_budget(static_cast<uint32_t>(_frame));
+  finish_loads();
+
+  // images retired by the last update are destroyed once the ring commands
+  // reading them went out, their memory comes back when that completed
+  uint64_t flushed_batch = _staging_ring.pending_batch() - 1;
+  std::erase_if(_retired_images, [&](const retired_image_t &retired_image) {
+    if (retired_image.batch > flushed_batch) return false;
+    _context.destroy_image_view(retired_image.handle_image_view);
+    _context.destroy_image(retired_image.handle_image);
+    // the image is destroyed under the same ticket rule
+    _pending_releases.push_back(
+        {.ticket         = _context.retirement_ticket(),
+         .vk_memory_heap = retired_image.vk_memory_heap,
+         .vk_size        = retired_image.vk_size});
+    return true;
+  });
+  std::erase_if(_pending_releases,
+                [&](const pending_release_t &pending_release) {
+                  return _context.is_retired(pending_release.ticket);
+                });
+
+  memory_stats_t            memory_stats = _context.get_memory_stats();
+  std::vector<VkDeviceSize> releasing(memory_stats.heaps.size(), 0);
+  for (const retired_image_t &retired_image : _retired_images)
+    releasing[retired_image.vk_memory_heap] += retired_image.vk_size;
+  for (const pending_release_t &pending_release : _pending_releases)
+    releasing[pending_release.vk_memory_heap] += pending_release.vk_size;
+  // restores still loading already have their room taken
+  std::vector<VkDeviceSize> loading(memory_stats.heaps.size(), 0);
+  for (auto [handle, texture] : _textures)
+    if (texture.load_ticket.valid())
+      loading[texture.vk_memory_heap] +=
+          texture.vk_full_size -
+          (texture.handle_image != core::null_handle ? texture.vk_size : 0);
+
+  for (uint32_t heap = 0; heap < memory_stats.heaps.size(); heap++) {
+    const memory_heap_stats_t &heap_stats = memory_stats.heaps[heap];
+    VkDeviceSize               usage =
+        heap_stats.usage - std::min(heap_stats.usage, releasing[heap]) +
+        loading[heap];
+    VkDeviceSize limit = static_cast<VkDeviceSize>(
+        static_cast<double>(heap_stats.budget) * _config.budget_fraction);
+    VkDeviceSize restore_limit = static_cast<VkDeviceSize>(
+        static_cast<double>(heap_stats.budget) * _config.restore_fraction);
+    if (usage > limit)
+      degrade(heap, usage - limit);
+    else if (usage < restore_limit)
+      restore(heap, restore_limit - usage);
+  }
+  return _changed;
+}
+
+void residency_manager_t::degrade(uint32_t     vk_memory_heap,
+                                  VkDeviceSize vk_excess) {
+  horizon_profile();
+  std::vector<handle_resident_texture_t> candidates;
+  for (auto [handle, texture] : _textures)
+    if (texture.handle_image != core::null_handle &&
+        texture.vk_memory_heap == vk_memory_heap)
+      candidates.push_back(handle);
+  std::sort(candidates.begin(), candidates.end(),
+            [&](handle_resident_texture_t a, handle_resident_texture_t b) {
+              internal::resident_texture_t &texture_a = _textures.get(a);
+              internal::resident_texture_t &texture_b = _textures.get(b);
+              if (texture_a.priority != texture_b.priority)
+                return texture_a.priority < texture_b.priority;
+              return texture_a.last_used_frame < texture_b.last_used_frame;
+            });
+
+  VkDeviceSize freed = 0;
+  // lose quality everywhere before anything disappears
+  for (handle_resident_texture_t handle : candidates) {
+    if (freed >= vk_excess) break;
+    internal::resident_texture_t &texture = _textures.get(handle);
+    uint32_t dropped = max_dropped_mips(handle);
+    if (dropped <= texture.dropped_mips) continue;
+    // a restore still loading would undo the drop, its result is discarded
+    texture.load_ticket = {};
+    freed += drop_mips(handle, dropped);
+  }
+  for (handle_resident_texture_t handle : candidates) {
+    if (freed >= vk_excess) break;
+    internal::resident_texture_t &texture = _textures.get(handle);
+    if (_frame - texture.last_used_frame < _config.eviction_idle_frames)
+      continue;
+    texture.load_ticket = {};
+    freed += texture.vk_size;
+    retire_image(texture);
+    texture.dropped_mips = texture.mips;
+    _changed.push_back(handle);
+  }
+  if (freed < vk_excess)
+    horizon_warn("heap {} stays {} bytes over its residency budget",
+                 vk_memory_heap, vk_excess - freed);
+}
+
+void residency_manager_t::restore(uint32_t     vk_memory_heap,
+                                  VkDeviceSize vk_room) {
+  horizon_profile();
+  std::vector<handle_resident_texture_t> candidates;
+  for (auto [handle, texture] : _textures)
+    // touched during the previous frame
+    if (texture.dropped_mips != 0 && !texture.load_ticket.valid() &&
+        texture.vk_memory_heap == vk_memory_heap &&
+        _frame - texture.last_used_frame <= 1)
+      candidates.push_back(handle);
+  std::sort(candidates.begin(), candidates.end(),
+            [&](handle_resident_texture_t a, handle_resident_texture_t b) {
+              internal::resident_texture_t &texture_a = _textures.get(a);
+              internal::resident_texture_t &texture_b = _textures.get(b);
+              if (texture_a.priority != texture_b.priority)
+                return texture_a.priority > texture_b.priority;
+              return texture_a.dropped_mips > texture_b.dropped_mips;
+            });
+
+  uint32_t restores = 0;
+  for (handle_resident_texture_t handle : candidates) {
+    if (restores == _config.max_restores_per_update) break;
+    internal::resident_texture_t &texture = _textures.get(handle);
+    VkDeviceSize                  growth =
+        texture.vk_full_size -
+        (texture.handle_image != core::null_handle ? texture.vk_size : 0);
+    if (growth > vk_room) continue;
+    vk_room -= growth;
+    load(handle);
+    restores++;
+  }
+}
+
+VkDeviceSize residency_manager_t::drop_mips(handle_resident_texture_t handle,
+                                            uint32_t dropped_mips) {
+  horizon_profile();
+  internal::resident_texture_t &texture = _textures.get(handle);
+  const config_image_t &config_full =
+      _textures.get_cold(handle).config_image;
+  config_image_t config_image = config_full;
+  config_image.vk_width       = mip_extent(config_full.vk_width, dropped_mips);
+  config_image.vk_height      = mip_extent(config_full.vk_height, dropped_mips);
+  if (config_full.vk_type == VK_IMAGE_TYPE_3D)
+    config_image.vk_depth = mip_extent(config_full.vk_depth, dropped_mips);
+  config_image.vk_mips = texture.mips - dropped_mips;
+  handle_image_t handle_image = _context.create_image(config_image);
+
+  // the remaining mips are copied over as they are. copies rather than
+  // blits, streamed textures are mostly block compressed, which cannot be
+  // blitted. every extent reaches the edge of its mip on both sides, which
+  // is all compressed copies ask of extents that are not whole blocks
+  VkImageAspectFlags vk_image_aspect =
+      helper::image_aspect_from_format(config_image.vk_format);
+  uint32_t                 src_mip_offset = dropped_mips - texture.dropped_mips;
+  std::vector<VkImageCopy> vk_image_copies;
+  for (uint32_t mip = 0; mip < config_image.vk_mips; mip++) {
+    VkImageCopy vk_image_copy{};
+    vk_image_copy.srcSubresource = {.aspectMask     = vk_image_aspect,
+                                    .mipLevel       = mip + src_mip_offset,
+                                    .baseArrayLayer = 0,
+                                    .layerCount     = 1};
+    vk_image_copy.dstSubresource = {.aspectMask     = vk_image_aspect,
+                                    .mipLevel       = mip,
+                                    .baseArrayLayer = 0,
+                                    .layerCount     = 1};
+    vk_image_copy.extent         = {mip_extent(config_image.vk_width, mip),
+                                    mip_extent(config_image.vk_height, mip),
+                                    mip_extent(config_image.vk_depth, mip)};
+    vk_image_copies.push_back(vk_image_copy);
+  }
+  handle_commandbuffer_t cbuf = _staging_ring.commandbuffer();
+  // retired right after, moving it would be wasted work
+  _context.set_image_movable(texture.handle_image, false);
+  helper::cmd_transition_image_layout(
+      _context, cbuf, texture.handle_image,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+  helper::cmd_transition_image_layout(_context, cbuf, handle_image,
+                                      VK_IMAGE_LAYOUT_UNDEFINED,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  _context.cmd_copy_image(cbuf, texture.handle_image,
+                          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, handle_image,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          vk_image_copies);
+  // descriptors keep sampling the old image until the new view is written
+  helper::cmd_transition_image_layout(
+      _context, cbuf, texture.handle_image,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  helper::cmd_transition_image_layout(
+      _context, cbuf, handle_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  VkDeviceSize vk_old_size = texture.vk_size;
+  replace_image(handle, handle_image, dropped_mips);
+  horizon_trace("dropped {} mips of {}", dropped_mips,
+                config_full.debug_name);
+  return vk_old_size - std::min(vk_old_size, texture.vk_size);
+}
+
+void residency_manager_t::load(handle_resident_texture_t handle) {
+  horizon_profile();
+  // the job keeps its own copy, the texture may be destroyed meanwhile
+  _textures.get(handle).load_ticket = _context.thread_pool().submit(
+      [load = _textures.get_cold(handle).load]() { return load(); });
+}
+
+void residency_manager_t::finish_loads() {
+  horizon_profile();
+  std::vector<handle_resident_texture_t> loaded;
+  for (auto [handle, texture] : _textures)
+    if (core::is_ready(texture.load_ticket)) loaded.push_back(handle);
+  for (handle_resident_texture_t handle : loaded) {
+    internal::resident_texture_t &texture = _textures.get(handle);
+    std::vector<uint8_t>          data    = texture.load_ticket.get();
+    texture.load_ticket                   = {};
+    upload(handle, data);
+  }
+}
+
+void residency_manager_t::upload(handle_resident_texture_t   handle,
+                                 const std::vector<uint8_t> &data) {
+  horizon_profile();
+  config_resident_texture_t &config_texture = _textures.get_cold(handle);
+  handle_image_t             handle_image =
+      _context.create_image(config_texture.config_image);
+  _staging_ring.upload_image(handle_image, data.data(), data.size(),
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  internal::resident_texture_t &texture = _textures.get(handle);
+  texture.mips = _context.get_image_config(handle_image).vk_mips;
+  replace_image(handle, handle_image, 0);
+  texture.vk_full_size = texture.vk_size;
+}
+
+void residency_manager_t::replace_image(handle_resident_texture_t handle,
+                                        handle_image_t handle_image,
+                                        uint32_t       dropped_mips) {
+  horizon_profile();
+  internal::resident_texture_t &texture = _textures.get(handle);
+  retire_image(texture);
+  const internal::image_t &image = _context.get_image(handle_image);
+  texture.handle_image           = handle_image;
+  texture.handle_image_view =
+      _context.create_image_view({.handle_image = handle_image});
+  texture.dropped_mips = dropped_mips;
+  texture.vk_size      = image.vk_allocation_size;
+  texture.vk_memory_heap =
+      _context.physical_device()
+          .memory_properties.memoryTypes[image.vk_memory_type]
+          .heapIndex;
+  _changed.push_back(handle);
+}
+
+void residency_manager_t::retire_image(internal::resident_texture_t &texture) {
+  horizon_profile();
+  if (texture.handle_image == core::null_handle) return;
+  _retired_images.push_back({.batch             = _staging_ring.pending_batch(),
+                             .handle_image      = texture.handle_image,
+                             .handle_image_view = texture.handle_image_view,
+                             .vk_memory_heap    = texture.vk_memory_heap,
+                             .vk_size           = texture.vk_size});
+  texture.handle_image      = core::null_handle;
+  texture.handle_image_view = core::null_handle;
+}
+
+uint32_t residency_manager_t::max_dropped_mips(
+    handle_resident_texture_t handle) {
+  horizon_profile();
+  const internal::resident_texture_t &texture = _textures.get(handle);
+  const config_image_t &config_image = _textures.get_cold(handle).config_image;
+  uint32_t extent = std::max(config_image.vk_width, config_image.vk_height);
+  uint32_t dropped_mips = 0;
+  while (dropped_mips + 1 < texture.mips &&
+         (extent >> (dropped_mips + 1)) >= _config.min_resident_extent)
+    dropped_mips++;
+  return dropped_mips;
+}
+
+}  // namespace gfx
@@ -0,0 +1,701 @@
+#include "horizon/gfx/shader_compiler.hpp"
+
+#include <slang-com-helper.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <thread>
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+
+namespace utils {
+
+// bump whenever the cache file layout changes
+static constexpr uint32_t shader_cache_magic   = 0x43535a48;  // HZSC
+static constexpr uint32_t shader_cache_version = 2;
+
+// every slang session is created from these, and the cache fingerprint is
+// built from the same values so the two can never disagree
+static constexpr const char *slang_profile  = "spirv_1_5";
+static constexpr const char *search_paths[] = {"../../assets/shaders/includes"};
+static constexpr SlangCompileTarget slang_target = SLANG_SPIRV;
+static constexpr SlangTargetFlags   slang_target_flags =
+    SLANG_TARGET_FLAG_GENERATE_SPIRV_DIRECTLY;
+static constexpr bool force_glsl_scalar_buffer_layout = true;
+static constexpr bool allow_glsl_syntax               = true;
+// a session never evicts a module, so it is recreated once it holds this many
+static constexpr size_t max_session_modules = 64;
+
+static std::vector<slang::CompilerOptionEntry> compiler_options() {
+  auto option = [](slang::CompilerOptionName name, int32_t value) {
+    slang::CompilerOptionEntry compiler_option{};
+    compiler_option.name            = name;
+    compiler_option.value.kind      = slang::CompilerOptionValueKind::Int;
+    compiler_option.value.intValue0 = value;
+    return compiler_option;
+  };
+  return {
+      option(slang::CompilerOptionName::Optimization,
+             SlangOptimizationLevel::SLANG_OPTIMIZATION_LEVEL_NONE),
+      option(slang::CompilerOptionName::DebugInformation,
+             SlangDebugInfoLevel::SLANG_DEBUG_INFO_LEVEL_MAXIMAL),
+      option(slang::CompilerOptionName::GLSLForceScalarLayout, 1),
+  };
+}
+
+static void diagnose_if_needed(slang::IBlob *diagnostics_blob) {
+  if (diagnostics_blob) {
+    horizon_error("{}", reinterpret_cast<const char *>(
+                            diagnostics_blob->getBufferPointer()));
+  }
+}
+
+// everything besides the source that changes the generated spirv, including
+// the slang build so a compiler upgrade never serves stale code
+static std::string compiler_fingerprint() {
+  std::string fingerprint = std::format(
+      "{} {} {} {} {} {}", spGetBuildTagString(), slang_profile,
+      static_cast<int>(slang_target), slang_target_flags,
+      force_glsl_scalar_buffer_layout, allow_glsl_syntax);
+  for (const slang::CompilerOptionEntry &compiler_option : compiler_options()) {
+    const slang::CompilerOptionValue &value = compiler_option.value;
+    fingerprint += std::format(
+        " {}:{}:{}:{}:{}:{}", static_cast<int>(compiler_option.name),
+        static_cast<int>(value.kind), value.intValue0, value.intValue1,
+        value.stringValue0 ? value.stringValue0 : "",
+        value.stringValue1 ? value.stringValue1 : "");
+  }
+  for (const char *search_path : search_paths) {
+    fingerprint += " ";
+    fingerprint += search_path;
+  }
+  return fingerprint;
+}
+
+static const char *entry_point_name(gfx::shader_type_t type) {
+  switch (type) {
+    case gfx::shader_type_t::e_vertex:
+      return "vertex_main";
+    case gfx::shader_type_t::e_fragment:
+      return "fragment_main";
+    case gfx::shader_type_t::e_compute:
+      return "compute_main";
+    default:
+      horizon_error("unknown shader type");
+      std::terminate();
+  }
+}
+
+static SlangStage slang_stage(gfx::shader_type_t type) {
+  switch (type) {
+    case gfx::shader_type_t::e_vertex:
+      return SlangStage::SLANG_STAGE_VERTEX;
+    case gfx::shader_type_t::e_fragment:
+      return SlangStage::SLANG_STAGE_FRAGMENT;
+    case gfx::shader_type_t::e_compute:
+      return SlangStage::SLANG_STAGE_COMPUTE;
+    default:
+      horizon_error("unknown shader type");
+      std::terminate();
+  }
+}
+
+static VkShaderStageFlagBits vk_shader_stage(gfx::shader_type_t type) {
+  switch (type) {
+    case gfx::shader_type_t::e_vertex:
+      return VK_SHADER_STAGE_VERTEX_BIT;
+    case gfx::shader_type_t::e_fragment:
+      return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case gfx::shader_type_t::e_compute:
+      return VK_SHADER_STAGE_COMPUTE_BIT;
+    default:
+      horizon_error("unknown shader type");
+      std::terminate();
+  }
+}
+
+static std::optional<VkDescriptorType> descriptor_type(
+    slang::BindingType binding_type) {
+  switch (binding_type) {
+    case slang::BindingType::Sampler:
+      return VK_DESCRIPTOR_TYPE_SAMPLER;
+    case slang::BindingType::CombinedTextureSampler:
+      return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    case slang::BindingType::Texture:
+      return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    case slang::BindingType::MutableTexture:
+      return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    case slang::BindingType::TypedBuffer:
+      return VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+    case slang::BindingType::MutableTypedBuffer:
+      return VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+    case slang::BindingType::RawBuffer:
+    case slang::BindingType::MutableRawBuffer:
+      return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    case slang::BindingType::ConstantBuffer:
+      return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    case slang::BindingType::InputRenderTarget:
+      return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    case slang::BindingType::RayTracingAccelerationStructure:
+      return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+    default:
+      return std::nullopt;
+  }
+}
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+  return core::timer::duration_t(std::chrono::high_resolution_clock::now() -
+                                 start)
+      .count();
+}
+
+}  // namespace utils
+
+namespace gfx {
+
+shader_compiler_t::shader_compiler_t() { horizon_profile(); }
+
+void shader_compiler_t::set_cache_directory(const std::filesystem::path &path) {
+  horizon_profile();
+  std::error_code error_code;
+  std::filesystem::create_directories(path, error_code);
+  std::scoped_lock lock{_mutex};
+  if (error_code) {
+    horizon_warn("Failed to create shader cache directory {}: {}",
+                 path.string(), error_code.message());
+    _cache_directory.clear();
+    return;
+  }
+  _cache_directory = path;
+  horizon_trace("shader cache directory set to {}", path.string());
+}
+
+compiled_shader_t shader_compiler_t::compile(const config_shader_t &config) {
+  horizon_profile();
+  return compile_program({
+                             .code_or_path = config.code_or_path,
+                             .is_code      = config.is_code,
+                             .name         = config.name,
+                             .types        = {config.type},
+                             .language     = config.language,
+                             .debug_name   = config.debug_name,
+                         })
+      .front();
+}
+
+std::vector<compiled_shader_t> shader_compiler_t::compile_program(
+    const config_shader_program_t &config) {
+  horizon_profile();
+  auto start = std::chrono::high_resolution_clock::now();
+
+  std::string code = config.is_code ? config.code_or_path
+                                    : core::read_file(config.code_or_path);
+  std::string path = config.is_code ? "" : config.code_or_path;
+
+  std::vector<compiled_shader_t> compiled_shaders(config.types.size());
+  std::vector<uint64_t>          source_keys(config.types.size());
+  std::vector<uint32_t>          missing;
+  for (uint32_t i = 0; i < config.types.size(); i++) {
+    source_keys[i] = source_key(config.name, code, config.types[i]);
+    std::optional<compiled_shader_t> compiled_shader = lookup(source_keys[i]);
+    if (compiled_shader)
+      compiled_shaders[i] = std::move(*compiled_shader);
+    else
+      missing.push_back(i);
+  }
+  if (missing.empty()) {
+    std::scoped_lock lock{_mutex};
+    _stats.lookup_time_ms += utils::elapsed_ms(start);
+    return compiled_shaders;
+  }
+
+  // every missing entry point comes out of one module load and one
+  // composition
+  std::vector<shader_type_t> types;
+  for (uint32_t i : missing) types.push_back(config.types[i]);
+  std::vector<std::string>       dependencies;
+  std::vector<compiled_shader_t> new_compiled_shaders =
+      compile_slang(config.name, code, path, types, dependencies);
+
+  for (uint32_t i = 0; i < missing.size(); i++) {
+    uint64_t source_key  = source_keys[missing[i]];
+    uint64_t content_key = this->content_key(source_key, dependencies);
+    write_dependencies(source_key, dependencies);
+    write_compiled_shader(content_key, new_compiled_shaders[i]);
+    std::scoped_lock lock{_mutex};
+    _dependencies[source_key]      = dependencies;
+    _compiled_shaders[content_key] = new_compiled_shaders[i];
+    compiled_shaders[missing[i]]   = std::move(new_compiled_shaders[i]);
+  }
+  {
+    std::scoped_lock lock{_mutex};
+    _stats.misses += missing.size();
+    _stats.compile_time_ms += utils::elapsed_ms(start);
+  }
+  horizon_trace("shader cache miss {}, compiled {} entry points", config.name,
+                missing.size());
+  return compiled_shaders;
+}
+
+shader_cache_stats_t shader_compiler_t::stats() {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  return _stats;
+}
+
+std::optional<compiled_shader_t> shader_compiler_t::lookup(
+    uint64_t source_key) {
+  horizon_profile();
+  std::optional<std::vector<std::string>> dependencies;
+  {
+    std::scoped_lock lock{_mutex};
+    auto             itr = _dependencies.find(source_key);
+    if (itr != _dependencies.end()) dependencies = itr->second;
+  }
+  if (!dependencies) {
+    dependencies = read_dependencies(source_key);
+    if (!dependencies) return std::nullopt;
+    std::scoped_lock lock{_mutex};
+    _dependencies[source_key] = *dependencies;
+  }
+
+  uint64_t content_key = this->content_key(source_key, *dependencies);
+  {
+    std::scoped_lock lock{_mutex};
+    auto             itr = _compiled_shaders.find(content_key);
+    if (itr != _compiled_shaders.end()) {
+      _stats.memory_hits++;
+      return itr->second;
+    }
+  }
+  std::optional<compiled_shader_t> compiled_shader =
+      read_compiled_shader(content_key);
+  if (compiled_shader) {
+    std::scoped_lock lock{_mutex};
+    _compiled_shaders[content_key] = *compiled_shader;
+    _stats.disk_hits++;
+  }
+  return compiled_shader;
+}
+
+shader_compiler_t::slang_state_t &shader_compiler_t::get_thread_slang_state() {
+  horizon_profile();
+  std::scoped_lock lock{_slang_states_mutex};
+  std::unique_ptr<slang_state_t> &state =
+      _slang_states[std::this_thread::get_id()];
+  if (!state) {
+    state = std::make_unique<slang_state_t>();
+    check(slang::createGlobalSession(state->global_session.writeRef()) == 0,
+          "failed to create global session");
+    create_session(*state);
+  }
+  return *state;
+}
+
+void shader_compiler_t::create_session(slang_state_t &state) {
+  horizon_profile();
+  std::vector<slang::CompilerOptionEntry> compiler_options =
+      utils::compiler_options();
+  slang::SessionDesc sessionDesc = {};
+  slang::TargetDesc  targetDesc  = {};
+  targetDesc.format  = utils::slang_target;
+  targetDesc.profile = state.global_session->findProfile(utils::slang_profile);
+  targetDesc.flags   = utils::slang_target_flags;
+  targetDesc.forceGLSLScalarBufferLayout =
+      utils::force_glsl_scalar_buffer_layout;
+
+  sessionDesc.allowGLSLSyntax = utils::allow_glsl_syntax;
+  sessionDesc.targets         = &targetDesc;
+  sessionDesc.targetCount     = 1;
+
+  sessionDesc.compilerOptionEntryCount = compiler_options.size();
+  sessionDesc.compilerOptionEntries    = compiler_options.data();
+
+  sessionDesc.searchPaths     = utils::search_paths;
+  sessionDesc.searchPathCount = std::size(utils::search_paths);
+
+  state.session = nullptr;
+  check(state.global_session->createSession(sessionDesc,
+                                            state.session.writeRef()) == 0,
+        "failed to create session");
+  state.session_files.clear();
+  state.session_modules.clear();
+  horizon_trace("created slang session");
+}
+
+std::vector<compiled_shader_t> shader_compiler_t::compile_slang(
+    const std::string &name, const std::string &code, const std::string &path,
+    const std::vector<shader_type_t> &types,
+    std::vector<std::string>         &dependencies) {
+  horizon_profile();
+  slang_state_t &state = get_thread_slang_state();
+
+  // the session keeps every module it loaded, if an imported file changed
+  // since then the session would hand back the stale module
+  for (auto &[file, hash] : state.session_files) {
+    if (file_hash(file) != hash) {
+      horizon_trace("{} changed, recreating slang session", file);
+      create_session(state);
+      break;
+    }
+  }
+
+  Slang::ComPtr<slang::IComponentType>           composedProgram;
+  std::vector<slang::IComponentType *>           componentTypes;
+  std::vector<Slang::ComPtr<slang::IEntryPoint>> entryPoints(types.size());
+  slang::IModule                                *slangModule = nullptr;
+
+  // the module is named after its path and code, so every stage of one
+  // source shares a module and an edited source is never served the module
+  // the session loaded before the edit
+  std::string module_name = std::format(
+      "module_{:016x}", core::hash_bytes(code, core::hash_bytes(path)));
+  if (!state.session_modules.contains(module_name) &&
+      state.session_modules.size() >= utils::max_session_modules) {
+    horizon_trace("slang session holds {} modules, recreating it",
+                  state.session_modules.size());
+    create_session(state);
+  }
+  state.session_modules.insert(module_name);
+  {
+    Slang::ComPtr<slang::IBlob> diagnosticBlob;
+    slangModule = state.session->loadModuleFromSourceString(
+        module_name.c_str(), path.c_str(), code.c_str(),
+        diagnosticBlob.writeRef());
+    utils::diagnose_if_needed(diagnosticBlob);
+    check(slangModule, "Failed to create module");
+  }
+  componentTypes.push_back(slangModule);
+
+  for (uint32_t i = 0; i < types.size(); i++) {
+    Slang::ComPtr<slang::IBlob> diagnosticBlob;
+    slangModule->findAndCheckEntryPoint(
+        utils::entry_point_name(types[i]), utils::slang_stage(types[i]),
+        entryPoints[i].writeRef(), diagnosticBlob.writeRef());
+    utils::diagnose_if_needed(diagnosticBlob);
+    check(entryPoints[i], "failed to find entrypoint {} in {}",
+          utils::entry_point_name(types[i]), path);
+    componentTypes.push_back(entryPoints[i]);
+  }
+
+  {
+    Slang::ComPtr<slang::IBlob> diagnosticsBlob;
+    SlangResult result = state.session->createCompositeComponentType(
+        componentTypes.data(), componentTypes.size(),
+        composedProgram.writeRef(), diagnosticsBlob.writeRef());
+    utils::diagnose_if_needed(diagnosticsBlob);
+    check(result == 0, "Failed to created composed program or something");
+  }
+
+  slang::ProgramLayout *program_layout;
+  {
+    Slang::ComPtr<slang::IBlob> diagnosticsBlob;
+    program_layout = composedProgram->getLayout(0, diagnosticsBlob.writeRef());
+    utils::diagnose_if_needed(diagnosticsBlob);
+    check(program_layout, "Failed to get program layout");
+  }
+
+  // the program layout is shared by every entry point, which parameters an
+  // entry point actually touches is filtered per entry point below
+  std::vector<shader_parameter_t> parameters;
+  uint32_t                        push_constant_size = 0;
+  uint32_t parameter_count = program_layout->getParameterCount();
+  for (uint32_t i = 0; i < parameter_count; i++) {
+    slang::VariableLayoutReflection *parameter =
+        program_layout->getParameterByIndex(i);
+    slang::TypeLayoutReflection *type_layout = parameter->getTypeLayout();
+    if (parameter->getCategory() ==
+        slang::ParameterCategory::PushConstantBuffer) {
+      push_constant_size = std::max<uint32_t>(
+          push_constant_size, type_layout->getElementTypeLayout()->getSize());
+      continue;
+    }
+    std::optional<VkDescriptorType> vk_descriptor_type;
+    if (parameter->getCategory() ==
+            slang::ParameterCategory::DescriptorTableSlot &&
+        type_layout->getBindingRangeCount() == 1)
+      vk_descriptor_type =
+          utils::descriptor_type(type_layout->getBindingRangeType(0));
+    if (!vk_descriptor_type) {
+      horizon_warn("{} in {} does not map to a single descriptor, skipping",
+                   parameter->getName(), name);
+      continue;
+    }
+    SlangInt binding_count = type_layout->getBindingRangeBindingCount(0);
+    uint32_t count =
+        static_cast<SlangUInt>(binding_count) == SLANG_UNBOUNDED_SIZE
+            ? 0
+            : static_cast<uint32_t>(binding_count);
+    parameters.push_back({
+        .name               = parameter->getName(),
+        .binding            = parameter->getBindingIndex(),
+        .space              = parameter->getBindingSpace(),
+        .vk_descriptor_type = *vk_descriptor_type,
+        .count              = count,
+    });
+  }
+
+  std::vector<compiled_shader_t> compiled_shaders(types.size());
+  for (uint32_t i = 0; i < types.size(); i++) {
+    Slang::ComPtr<slang::IBlob> spirvCode;
+    {
+      Slang::ComPtr<slang::IBlob> diagnosticsBlob;
+      SlangResult                 result = composedProgram->getEntryPointCode(
+          i, 0, spirvCode.writeRef(), diagnosticsBlob.writeRef());
+      utils::diagnose_if_needed(diagnosticsBlob);
+      check(result == 0, "Failed to get spirv code");
+    }
+    compiled_shader_t &compiled_shader = compiled_shaders[i];
+    compiled_shader.spirv.resize(spirvCode->getBufferSize() /
+                                 sizeof(uint32_t));
+    std::memcpy(compiled_shader.spirv.data(), spirvCode->getBufferPointer(),
+                compiled_shader.spirv.size() * sizeof(uint32_t));
+
+    Slang::ComPtr<slang::IMetadata> metadata;
+    {
+      Slang::ComPtr<slang::IBlob> diagnosticsBlob;
+      composedProgram->getEntryPointMetadata(i, 0, metadata.writeRef(),
+                                             diagnosticsBlob.writeRef());
+      utils::diagnose_if_needed(diagnosticsBlob);
+    }
+    shader_reflection_t &reflection = compiled_shader.reflection;
+    reflection.vk_shader_stage      = utils::vk_shader_stage(types[i]);
+    reflection.push_constant_size   = push_constant_size;
+    for (const shader_parameter_t &parameter : parameters) {
+      bool used = true;
+      if (metadata)
+        metadata->isParameterLocationUsed(
+            SLANG_PARAMETER_CATEGORY_DESCRIPTOR_TABLE_SLOT, parameter.space,
+            parameter.binding, used);
+      if (used) reflection.parameters.push_back(parameter);
+    }
+  }
+
+  // the module itself is already covered by the source hash
+  for (int32_t i = 0; i < slangModule->getDependencyFileCount(); i++) {
+    std::string dependency = slangModule->getDependencyFilePath(i);
+    if (dependency.empty() || dependency == path) continue;
+    dependencies.push_back(dependency);
+    if (std::optional<uint64_t> hash = file_hash(dependency))
+      state.session_files[dependency] = *hash;
+  }
+
+  return compiled_shaders;
+}
+
+uint64_t shader_compiler_t::source_key(const std::string &name,
+                                       const std::string &code,
+                                       shader_type_t      type) {
+  horizon_profile();
+  static const uint64_t fingerprint_key =
+      core::hash_bytes(utils::compiler_fingerprint());
+  uint64_t key = core::hash_bytes(code, fingerprint_key);
+  key          = core::hash_bytes(name, key);
+  return core::hash_bytes(&type, sizeof(type), key);
+}
+
+uint64_t shader_compiler_t::content_key(
+    uint64_t source_key, const std::vector<std::string> &dependencies) {
+  horizon_profile();
+  uint64_t key = source_key;
+  for (const std::string &dependency : dependencies) {
+    key = core::hash_bytes(dependency, key);
+    if (std::optional<uint64_t> hash = file_hash(dependency))
+      key = core::hash_bytes(&*hash, sizeof(*hash), key);
+  }
+  return key;
+}
+
+std::optional<uint64_t> shader_compiler_t::file_hash(const std::string &path) {
+  horizon_profile();
+  std::error_code                 error_code;
+  std::filesystem::file_time_type write_time =
+      std::filesystem::last_write_time(path, error_code);
+  if (error_code) return std::nullopt;
+  uintmax_t size = std::filesystem::file_size(path, error_code);
+  if (error_code) return std::nullopt;
+  {
+    std::scoped_lock lock{_file_hashes_mutex};
+    auto             itr = _file_hashes.find(path);
+    if (itr != _file_hashes.end() && itr->second.write_time == write_time &&
+        itr->second.size == size)
+      return itr->second.hash;
+  }
+  uint64_t         hash = core::hash_bytes(core::read_file(path));
+  std::scoped_lock lock{_file_hashes_mutex};
+  _file_hashes[path] = {.write_time = write_time, .size = size, .hash = hash};
+  return hash;
+}
+
+std::filesystem::path shader_compiler_t::dependencies_path(
+    uint64_t source_key) {
+  return _cache_directory / std::format("{:016x}.deps", source_key);
+}
+
+std::filesystem::path shader_compiler_t::compiled_shader_path(
+    uint64_t content_key) {
+  return _cache_directory / std::format("{:016x}.spv", content_key);
+}
+
+std::optional<std::vector<std::string>> shader_compiler_t::read_dependencies(
+    uint64_t source_key) {
+  horizon_profile();
+  std::filesystem::path path;
+  {
+    std::scoped_lock lock{_mutex};
+    if (_cache_directory.empty()) return std::nullopt;
+    path = dependencies_path(source_key);
+  }
+  if (!std::filesystem::exists(path)) return std::nullopt;
+
+  core::binary_reader_t reader{path};
+  uint32_t              magic, version, count;
+  reader.read(magic);
+  reader.read(version);
+  reader.read(count);
+  // a truncated or corrupt entry is a miss, sizes that do not fit into the
+  // rest of the file are never allocated
+  if (!reader.good() || magic != utils::shader_cache_magic ||
+      version != utils::shader_cache_version ||
+      count > reader.remaining() / sizeof(uint32_t))
+    return std::nullopt;
+  std::vector<std::string> dependencies(count);
+  for (std::string &dependency : dependencies) {
+    uint32_t size;
+    reader.read(size);
+    if (!reader.good() || size > reader.remaining()) return std::nullopt;
+    dependency.resize(size);
+    reader.read_bytes(dependency.data(), size);
+  }
+  if (!reader.good()) return std::nullopt;
+  return dependencies;
+}
+
+void shader_compiler_t::write_dependencies(
+    uint64_t source_key, const std::vector<std::string> &dependencies) {
+  horizon_profile();
+  std::filesystem::path path;
+  {
+    std::scoped_lock lock{_mutex};
+    if (_cache_directory.empty()) return;
+    path = dependencies_path(source_key);
+  }
+  std::filesystem::path temp_path = path;
+  temp_path += std::format(".{}.tmp", std::hash<std::thread::id>{}(
+                                          std::this_thread::get_id()));
+  {
+    core::binary_writer_t writer{temp_path};
+    writer.write(utils::shader_cache_magic);
+    writer.write(utils::shader_cache_version);
+    writer.write(static_cast<uint32_t>(dependencies.size()));
+    for (const std::string &dependency : dependencies) {
+      writer.write(static_cast<uint32_t>(dependency.size()));
+      writer.write_bytes(dependency.data(), dependency.size());
+    }
+  }
+  std::error_code error_code;
+  std::filesystem::rename(temp_path, path, error_code);
+  if (error_code)
+    horizon_warn("Failed to write {}: {}", path.string(), error_code.message());
+}
+
+std::optional<compiled_shader_t> shader_compiler_t::read_compiled_shader(
+    uint64_t content_key) {
+  horizon_profile();
+  std::filesystem::path path;
+  {
+    std::scoped_lock lock{_mutex};
+    if (_cache_directory.empty()) return std::nullopt;
+    path = compiled_shader_path(content_key);
+  }
+  if (!std::filesystem::exists(path)) return std::nullopt;
+
+  core::binary_reader_t reader{path};
+  uint32_t              magic, version, spirv_size, parameter_count;
+  reader.read(magic);
+  reader.read(version);
+  if (!reader.good() || magic != utils::shader_cache_magic ||
+      version != utils::shader_cache_version)
+    return std::nullopt;
+
+  // a truncated or corrupt entry is a miss, sizes that do not fit into the
+  // rest of the file are never allocated
+  compiled_shader_t compiled_shader{};
+  reader.read(spirv_size);
+  if (!reader.good() || spirv_size > reader.remaining() / sizeof(uint32_t))
+    return std::nullopt;
+  compiled_shader.spirv.resize(spirv_size);
+  reader.read_bytes(compiled_shader.spirv.data(),
+                    spirv_size * sizeof(uint32_t));
+
+  shader_reflection_t &reflection = compiled_shader.reflection;
+  reader.read(reflection.vk_shader_stage);
+  reader.read(reflection.push_constant_size);
+  reader.read(parameter_count);
+  constexpr size_t parameter_size =
+      sizeof(uint32_t) + sizeof(shader_parameter_t::binding) +
+      sizeof(shader_parameter_t::space) +
+      sizeof(shader_parameter_t::vk_descriptor_type) +
+      sizeof(shader_parameter_t::count);
+  if (!reader.good() || parameter_count > reader.remaining() / parameter_size)
+    return std::nullopt;
+  reflection.parameters.resize(parameter_count);
+  for (shader_parameter_t &parameter : reflection.parameters) {
+    uint32_t name_size;
+    reader.read(name_size);
+    if (!reader.good() || name_size > reader.remaining()) return std::nullopt;
+    parameter.name.resize(name_size);
+    reader.read_bytes(parameter.name.data(), name_size);
+    reader.read(parameter.binding);
+    reader.read(parameter.space);
+    reader.read(parameter.vk_descriptor_type);
+    reader.read(parameter.count);
+  }
+  if (!reader.good()) return std::nullopt;
+  return compiled_shader;
+}
+
+void shader_compiler_t::write_compiled_shader(
+    uint64_t content_key, const compiled_shader_t &compiled_shader) {
+  horizon_profile();
+  std::filesystem::path path;
+  {
+    std::scoped_lock lock{_mutex};
+    if (_cache_directory.empty()) return;
+    path = compiled_shader_path(content_key);
+  }
+  // unique per thread so concurrent misses on the same key never interleave,
+  // the rename makes the entry visible atomically
+  std::filesystem::path temp_path = path;
+  temp_path += std::format(".{}.tmp", std::hash<std::thread::id>{}(
+                                          std::this_thread::get_id()));
+  {
+    core::binary_writer_t writer{temp_path};
+    writer.write(utils::shader_cache_magic);
+    writer.write(utils::shader_cache_version);
+    writer.write(static_cast<uint32_t>(compiled_shader.spirv.size()));
+    writer.write_bytes(compiled_shader.spirv.data(),
+                       compiled_shader.spirv.size() * sizeof(uint32_t));
+    const shader_reflection_t &reflection = compiled_shader.reflection;
+    writer.write(reflection.vk_shader_stage);
+    writer.write(reflection.push_constant_size);
+    writer.write(static_cast<uint32_t>(reflection.parameters.size()));
+    for (const shader_parameter_t &parameter : reflection.parameters) {
+      writer.write(static_cast<uint32_t>(parameter.name.size()));
+      writer.write_bytes(parameter.name.data(), parameter.name.size());
+      writer.write(parameter.binding);
+      writer.write(parameter.space);
+      writer.write(parameter.vk_descriptor_type);
+      writer.write(parameter.count);
+    }
+  }
+  std::error_code error_code;
+  std::filesystem::rename(temp_path, path, error_code);
+  if (error_code)
+    horizon_warn("Failed to write {}: {}", path.string(), error_code.message());
+}
+
+}  // namespace gfx
@@ -0,0 +1,192 @@
+#include "horizon/gfx/staging_ring.hpp"
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+#include "horizon/gfx/helper.hpp"
+
+#include <cstring>
+#include <numeric>
+
+namespace gfx {
+
+staging_ring_t::staging_ring_t(context_t &context, VkDeviceSize vk_size,
+                               queue_type_t queue_type)
+    : _context(context), _vk_size(vk_size), _queue_type(queue_type) {
+  horizon_profile();
+  config_buffer_t config_buffer{};
+  config_buffer.vk_size               = _vk_size;
+  config_buffer.vk_buffer_usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  config_buffer.vma_allocation_create_flags =
+      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+  config_buffer.debug_name = "staging ring";
+  _handle_buffer           = _context.create_buffer(config_buffer);
+  _p_data = reinterpret_cast<uint8_t *>(_context.map_buffer(_handle_buffer));
+  _handle_timeline =
+      _context.create_timeline_semaphore(0, "staging ring timeline");
+}
+
+staging_ring_t::~staging_ring_t() {
+  horizon_profile();
+  flush();
+  // both are destroyed once the last flush completed
+  _context.destroy_buffer(_handle_buffer);
+  _context.destroy_semaphore(_handle_timeline);
+}
+
+void staging_ring_t::upload_buffer(handle_buffer_t handle_buffer,
+                                   const void *data, VkDeviceSize vk_size,
+                                   VkDeviceSize vk_dst_offset) {
+  horizon_profile();
+  staging_allocation_t allocation = stage(vk_size);
+  std::memcpy(allocation.p_data, data, vk_size);
+  _context.cmd_copy_buffer(commandbuffer(), allocation.handle_buffer,
+                           handle_buffer,
+                           {.vk_src_offset = allocation.vk_offset,
+                            .vk_dst_offset = vk_dst_offset,
+                            .vk_size       = vk_size});
+}
+
+void staging_ring_t::upload_image(handle_image_t handle_image,
+                                  const void *data, VkDeviceSize vk_size,
+                                  VkImageLayout vk_final_image_layout) {
+  horizon_profile();
+  staging_allocation_t allocation = stage_image(handle_image, vk_size);
+  std::memcpy(allocation.p_data, data, vk_size);
+  const config_image_t  &config_image = _context.get_image_config(handle_image);
+  handle_commandbuffer_t cbuf         = commandbuffer();
+  helper::cmd_transition_image_layout(_context, cbuf, handle_image,
+                                      VK_IMAGE_LAYOUT_UNDEFINED,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  _context.cmd_copy_buffer_to_image(
+      cbuf, allocation.handle_buffer, handle_image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      {
+          .bufferOffset      = allocation.vk_offset,
+          .bufferRowLength   = 0,
+          .bufferImageHeight = 0,
+          .imageSubresource  = {.aspectMask = helper::image_aspect_from_format(
+                                   config_image.vk_format),
+                                .mipLevel       = 0,
+                                .baseArrayLayer = 0,
+                                .layerCount     = 1},
+          .imageOffset       = {0, 0, 0},
+          .imageExtent       = {config_image.vk_width, config_image.vk_height,
+                                config_image.vk_depth},
+      });
+  if (config_image.vk_mips != 1)
+    helper::cmd_generate_image_mip_maps(_context, cbuf, handle_image,
+                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                        vk_final_image_layout,
+                                        VK_FILTER_LINEAR);
+  else
+    helper::cmd_transition_image_layout(_context, cbuf, handle_image,
+                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                        vk_final_image_layout);
+  // defragmentation may move it once the upload went out on the graphics
+  // queue, which its copies are ordered after
+  if (_queue_type == queue_type_t::e_graphics &&
+      vk_final_image_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+    _movable_images.push_back(handle_image);
+}
+
+uint64_t staging_ring_t::flush() {
+  horizon_profile();
+  if (_handle_commandbuffer == core::null_handle) return _serial;
+  // later submissions on the queue are in the second scope of this barrier,
+  // so they see the copies without waiting on anything
+  VkMemoryBarrier vk_memory_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  vk_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vk_memory_barrier.dstAccessMask =
+      VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+  _context.cmd_pipeline_barrier(
+      _handle_commandbuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, {vk_memory_barrier}, {}, {});
+  _context.end_commandbuffer(_handle_commandbuffer);
+  _serial = _context.submit(
+      {.handle_commandbuffers = {_handle_commandbuffer},
+       .signal_semaphores     = {{.handle_semaphore = _handle_timeline,
+                                  .value            = ++_batch}}});
+  _handle_commandbuffer = core::null_handle;
+  _regions.push_back({.end = _head, .serial = _serial});
+  // destroyed after the submission above, so they outlive its copies
+  for (handle_buffer_t handle_buffer : _dedicated_buffers)
+    _context.destroy_buffer(handle_buffer);
+  _dedicated_buffers.clear();
+  for (handle_image_t handle_image : _movable_images)
+    _context.set_image_movable(handle_image, true);
+  _movable_images.clear();
+  return _serial;
+}
+
+staging_allocation_t staging_ring_t::stage(VkDeviceSize vk_size,
+                                           VkDeviceSize vk_alignment) {
+  horizon_profile();
+  vk_alignment = std::lcm(vk_alignment, min_alignment);
+  if (vk_size > _vk_size) {
+    config_buffer_t config_buffer{};
+    config_buffer.vk_size               = vk_size;
+    config_buffer.vk_buffer_usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    config_buffer.vma_allocation_create_flags =
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+    handle_buffer_t handle_buffer = _context.create_buffer(config_buffer);
+    _dedicated_buffers.push_back(handle_buffer);
+    return {handle_buffer, 0, _context.map_buffer(handle_buffer)};
+  }
+  while (true) {
+    retire();
+    // nothing pending or in flight, start over at the front of the buffer
+    if (_head == _tail) _head = _tail = 0;
+    uint64_t offset = (_head + vk_alignment - 1) / vk_alignment * vk_alignment;
+    // slices never wrap around the end of the buffer
+    if (offset % _vk_size + vk_size > _vk_size)
+      offset += _vk_size - offset % _vk_size;
+    if (offset + vk_size - _tail <= _vk_size) {
+      _head = offset + vk_size;
+      return {_handle_buffer, offset % _vk_size, _p_data + offset % _vk_size};
+    }
+    // the ring is full, free the oldest slices, submitting the pending ones
+    // first if they are all that is left
+    if (_regions.empty()) flush();
+    _context.wait_serial(_regions.front().serial);
+  }
+}
+
+staging_allocation_t staging_ring_t::stage_image(handle_image_t handle_image,
+                                                 VkDeviceSize   vk_size) {
+  horizon_profile();
+  const config_image_t &config_image = _context.get_image_config(handle_image);
+  // the data holds one texel block per texel of the base mip. a buffer to
+  // image copy has to start at a multiple of the block size, which 16 is not
+  // for 6 or 12 byte blocks, and at a multiple of 4 on transfer queues
+  VkDeviceSize vk_texel_count = VkDeviceSize{config_image.vk_width} *
+                                config_image.vk_height * config_image.vk_depth;
+  check(vk_texel_count && vk_size % vk_texel_count == 0,
+        "upload of {} bytes does not cover the {} texels of the base mip",
+        vk_size, vk_texel_count);
+  return stage(vk_size, std::lcm(VkDeviceSize{4}, vk_size / vk_texel_count));
+}
+
+handle_commandbuffer_t staging_ring_t::commandbuffer() {
+  horizon_profile();
+  if (_handle_commandbuffer == core::null_handle) {
+    _handle_commandbuffer = _context.acquire_commandbuffer(_queue_type);
+    _context.begin_commandbuffer(_handle_commandbuffer, true);
+  }
+  return _handle_commandbuffer;
+}
+
+handle_semaphore_t staging_ring_t::timeline() { return _handle_timeline; }
+
+uint64_t staging_ring_t::pending_batch() { return _batch + 1; }
+
+void staging_ring_t::retire() {
+  horizon_profile();
+  if (_regions.empty()) return;
+  uint64_t serial = _context.completed_serial();
+  while (!_regions.empty() && _regions.front().serial <= serial) {
+    _tail = _regions.front().end;
+    _regions.pop_front();
+  }
+}
+
+}  // namespace gfx
@@ -0,0 +1,155 @@
+#include "horizon/gfx/upload_manager.hpp"
+
+#include "horizon/core/core.hpp"
+#include "horizon/core/logger.hpp"
+#include "horizon/gfx/helper.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gfx {
+
+// barriers with matching queue types are plain memory barriers, so this is
+// also correct on devices without a dedicated transfer queue
+static constexpr queue_ownership_transfer_t transfer_to_graphics{
+    .src_queue_type = queue_type_t::e_transfer,
+    .dst_queue_type = queue_type_t::e_graphics};
+
+upload_manager_t::upload_manager_t(context_t   &context,
+                                   VkDeviceSize vk_staging_size)
+    : _context(context),
+      _staging_ring(context, vk_staging_size, queue_type_t::e_transfer) {
+  horizon_profile();
+}
+
+upload_token_t upload_manager_t::upload_buffer(handle_buffer_t handle_buffer,
+                                               const void     *data,
+                                               VkDeviceSize    vk_size,
+                                               VkDeviceSize    vk_dst_offset) {
+  horizon_profile();
+  std::scoped_lock     lock{_mutex};
+  staging_allocation_t allocation = _staging_ring.stage(vk_size);
+  std::memcpy(allocation.p_data, data, vk_size);
+  handle_commandbuffer_t cbuf = _staging_ring.commandbuffer();
+  _context.cmd_copy_buffer(cbuf, allocation.handle_buffer, handle_buffer,
+                           {.vk_src_offset = allocation.vk_offset,
+                            .vk_dst_offset = vk_dst_offset,
+                            .vk_size       = vk_size});
+  buffer_resource_range_t buffer_resource_range{.size   = vk_size,
+                                                .offset = vk_dst_offset};
+  _context.cmd_buffer_memory_barrier(
+      cbuf, handle_buffer, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      buffer_resource_range, transfer_to_graphics);
+  uint64_t batch = _staging_ring.pending_batch();
+  _pending_acquires.push_back(
+      {.batch                 = batch,
+       .handle_buffer         = handle_buffer,
+       .buffer_resource_range = buffer_resource_range});
+  return {batch};
+}
+
+upload_token_t upload_manager_t::upload_image(
+    handle_image_t handle_image, const void *data, VkDeviceSize vk_size,
+    VkImageLayout vk_final_image_layout) {
+  horizon_profile();
+  std::scoped_lock     lock{_mutex};
+  staging_allocation_t allocation =
+      _staging_ring.stage_image(handle_image, vk_size);
+  std::memcpy(allocation.p_data, data, vk_size);
+  const config_image_t  &config_image = _context.get_image_config(handle_image);
+  handle_commandbuffer_t cbuf         = _staging_ring.commandbuffer();
+  // every mip goes to transfer dst, the graphics side blits the rest from
+  // the base mip
+  _context.cmd_image_memory_barrier(
+      cbuf, handle_image, VK_IMAGE_LAYOUT_UNDEFINED,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+  _context.cmd_copy_buffer_to_image(
+      cbuf, allocation.handle_buffer, handle_image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      {
+          .bufferOffset      = allocation.vk_offset,
+          .bufferRowLength   = 0,
+          .bufferImageHeight = 0,
+          .imageSubresource  = {.aspectMask = helper::image_aspect_from_format(
+                                   config_image.vk_format),
+                                .mipLevel       = 0,
+                                .baseArrayLayer = 0,
+                                .layerCount     = 1},
+          .imageOffset       = {0, 0, 0},
+          .imageExtent       = {config_image.vk_width, config_image.vk_height,
+                                config_image.vk_depth},
+      });
+  _context.cmd_image_memory_barrier(
+      cbuf, handle_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, {},
+      transfer_to_graphics);
+  uint64_t batch = _staging_ring.pending_batch();
+  _pending_acquires.push_back(
+      {.batch                 = batch,
+       .handle_image          = handle_image,
+       .vk_final_image_layout = vk_final_image_layout});
+  return {batch};
+}
+
+void upload_manager_t::flush() {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  _staging_ring.flush();
+}
+
+bool upload_manager_t::is_ready(upload_token_t token) {
+  horizon_profile();
+  return _context.get_semaphore_value(_staging_ring.timeline()) >= token.batch;
+}
+
+std::optional<semaphore_submit_info_t> upload_manager_t::acquire(
+    handle_commandbuffer_t handle_commandbuffer, upload_token_t token) {
+  horizon_profile();
+  std::scoped_lock lock{_mutex};
+  // an unflushed batch has not released anything yet
+  uint64_t flushed_batch = _staging_ring.pending_batch() - 1;
+  uint64_t batch =
+      std::min(std::max(_context.get_semaphore_value(_staging_ring.timeline()),
+                        token.batch),
+               flushed_batch);
+  uint64_t acquired_batch = 0;
+  while (!_pending_acquires.empty() &&
+         _pending_acquires.front().batch <= batch) {
+    pending_acquire_t &pending_acquire = _pending_acquires.front();
+    if (pending_acquire.handle_buffer != core::null_handle) {
+      _context.cmd_buffer_memory_barrier(
+          handle_commandbuffer, pending_acquire.handle_buffer, 0,
+          VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+          pending_acquire.buffer_resource_range, transfer_to_graphics);
+    } else {
+      _context.cmd_image_memory_barrier(
+          handle_commandbuffer, pending_acquire.handle_image,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+          VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {},
+          transfer_to_graphics);
+      if (_context.get_image_config(pending_acquire.handle_image).vk_mips != 1)
+        helper::cmd_generate_image_mip_maps(
+            _context, handle_commandbuffer, pending_acquire.handle_image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            pending_acquire.vk_final_image_layout, VK_FILTER_LINEAR);
+      else
+        helper::cmd_transition_image_layout(
+            _context, handle_commandbuffer, pending_acquire.handle_image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            pending_acquire.vk_final_image_layout);
+    }
+    acquired_batch = pending_acquire.batch;
+    _pending_acquires.pop_front();
+  }
+  if (acquired_batch == 0) return std::nullopt;
+  return semaphore_submit_info_t{.handle_semaphore = _staging_ring.timeline(),
+                                 .value            = acquired_batch};
+}
+
+}  // namespace gfx